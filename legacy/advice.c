@@ -0,0 +1,243 @@
+/* ------------------------------------------------------------------------ *
+ * The comprador's running advice.  See advice.h.
+ * ------------------------------------------------------------------------ */
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+
+#include "advice.h"
+#include "mcts.h"
+#include "policy.h"
+
+/* Five ways to load, by seven ports, at most. */
+#define PLANS (5 * 7)
+
+struct tally
+{
+    long   voyages,
+           pirates,
+           storms,
+           lost;
+    double profit;
+};
+
+struct advice
+{
+    pthread_t           thread;
+    int                 running;
+    atomic_int          stop;
+    pthread_mutex_t     lock;       /* Over tally[]. */
+
+    struct game_state   game;       /* The copy worked from. */
+    double              worth;      /* Its net worth, with the cargo. */
+    int                 what,
+                        plans,
+                        buy[PLANS],
+                        dest[PLANS];
+    struct tally        tally[PLANS];
+
+    struct rng          rng;
+    const struct policy *greedy;
+};
+
+/* Plays plan i's voyage once, into t.  0 if told to stop on the way. */
+static int voyage(struct advice *a, int i, struct tally *t)
+{
+    struct game_state g;
+    struct game_event ev;
+    struct player     p;
+    struct mcts_move  move;
+    int               met = 0,
+                      storm = 0;
+
+    game_copy(&g, &a->game);
+    game_seed(&g, rng_next(&a->rng));
+    player_init(&p, a->greedy, rng_next(&a->rng));
+
+    move.sell    = (a->what == ADVICE_PORT);
+    move.finance = MCTS_KEEP;
+    move.buy     = a->buy[i];
+    move.half    = 0;
+    move.dest    = a->dest[i];
+    mcts_apply(&g, &move);
+
+    while ((game_step(&g, &ev) != EV_PORT) && (ev.type != EV_GAME_OVER))
+    {
+        if (atomic_load_explicit(&a->stop, memory_order_relaxed))
+        {
+            return 0;
+        }
+        met   |= (ev.type == EV_PIRATES) ||
+            ((ev.type == EV_LI_YUEN_PIRATES) && (ev.n > 0));
+        storm |= (ev.type == EV_STORM);
+        player_answer(&p, &g, &ev);
+    }
+
+    t->voyages++;
+    t->pirates += met;
+    t->storms  += storm;
+    t->lost    += (g.over == GAME_SUNK) || (g.over == GAME_FOUNDERED);
+    t->profit  += game_worth(&g) - a->worth;
+
+    return 1;
+}
+
+/* Plays every plan once a round, and adds each round in, until stopped. */
+static void *work(void *arg)
+{
+    struct advice *a = arg;
+    struct tally  round[PLANS];
+    int           i,
+                  done;
+
+    while (!atomic_load_explicit(&a->stop, memory_order_relaxed))
+    {
+        for (i = 0; i < a->plans; i++)
+        {
+            round[i].voyages = round[i].pirates = 0;
+            round[i].storms  = round[i].lost = 0;
+            round[i].profit  = 0;
+        }
+        for (done = 0; done < a->plans; done++)
+        {
+            if (!voyage(a, done, &round[done]))
+            {
+                break;
+            }
+        }
+
+        pthread_mutex_lock(&a->lock);
+        for (i = 0; i < done; i++)
+        {
+            a->tally[i].voyages += round[i].voyages;
+            a->tally[i].pirates += round[i].pirates;
+            a->tally[i].storms  += round[i].storms;
+            a->tally[i].lost    += round[i].lost;
+            a->tally[i].profit  += round[i].profit;
+        }
+        pthread_mutex_unlock(&a->lock);
+    }
+
+    return NULL;
+}
+
+struct advice *advice_new(void)
+{
+    struct advice *a = calloc(1, sizeof(*a));
+
+    if (a == NULL)
+    {
+        return NULL;
+    }
+    pthread_mutex_init(&a->lock, NULL);
+    rng_seed(&a->rng, 0xad71ce);
+    a->greedy = policy_find("greedy");
+
+    return a;
+}
+
+void advice_free(struct advice *a)
+{
+    if (a != NULL)
+    {
+        advice_stop(a);
+        pthread_mutex_destroy(&a->lock);
+        free(a);
+    }
+}
+
+int advice_start(struct advice *a, const struct game_state *g, int what)
+{
+    double cash = g->cash;
+    int    item,
+           dest,
+           k;
+
+    advice_stop(a);
+
+    game_copy(&a->game, g);
+    a->worth = game_worth(g);
+    a->what  = what;
+    a->plans = 0;
+
+    /* Only the goods there will be the cash for, once the cargo is sold. */
+    for (k = 0; k < 4; k++)
+    {
+        cash += (double) g->hold_[k] * g->price[k];
+    }
+    for (item = -1; item < ((what == ADVICE_PORT) ? 4 : 0); item++)
+    {
+        if ((item >= 0) && (cash < g->price[item]))
+        {
+            continue;
+        }
+        for (dest = 1; dest <= 7; dest++)
+        {
+            if (dest != g->port)
+            {
+                a->buy[a->plans]  = item;
+                a->dest[a->plans] = dest;
+                a->plans++;
+            }
+        }
+    }
+    for (k = 0; k < a->plans; k++)
+    {
+        a->tally[k].voyages = a->tally[k].pirates = 0;
+        a->tally[k].storms  = a->tally[k].lost = 0;
+        a->tally[k].profit  = 0;
+    }
+
+    atomic_store(&a->stop, 0);
+    if (pthread_create(&a->thread, NULL, work, a) != 0)
+    {
+        return -1;
+    }
+    a->running = 1;
+
+    return 0;
+}
+
+int advice_best(struct advice *a, struct advice_plan *best)
+{
+    double profit;
+    int    found = 0,
+           i;
+
+    pthread_mutex_lock(&a->lock);
+    for (i = 0; i < a->plans; i++)
+    {
+        const struct tally *t = &a->tally[i];
+
+        if (t->voyages == 0)
+        {
+            continue;
+        }
+        profit = t->profit / t->voyages;
+        if (!found || (profit > best->profit))
+        {
+            best->buy     = a->buy[i];
+            best->dest    = a->dest[i];
+            best->voyages = t->voyages;
+            best->profit  = profit;
+            best->pirates = (double) t->pirates / t->voyages;
+            best->storm   = (double) t->storms / t->voyages;
+            best->lost    = (double) t->lost / t->voyages;
+            found = 1;
+        }
+    }
+    pthread_mutex_unlock(&a->lock);
+
+    return found;
+}
+
+void advice_stop(struct advice *a)
+{
+    if (a->running)
+    {
+        atomic_store(&a->stop, 1);
+        pthread_join(a->thread, NULL);
+        a->running = 0;
+    }
+}
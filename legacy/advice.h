@@ -0,0 +1,55 @@
+/* ------------------------------------------------------------------------ *
+ * The comprador's running advice, worked out while the player thinks.
+ *
+ * advice_start() takes a copy of a game waiting in port and plays its
+ * next voyage over and over on a thread of its own, for each plan there
+ * is: each good to fill the hold with (or none) and each port to sail for
+ * at the port menu, or just each port at quit()'s prompt, with the cargo
+ * aboard.  Each voyage is played in the engine from a copy reseeded from
+ * the advisor's own dice, so nothing is learned of the real ones, and
+ * what happens on the way is answered as greedy (policy.c) answers it.
+ *
+ * The plans are played in turn, one voyage each, and the tallies can be
+ * read at any time as they grow.  advice_stop() stops the thread before
+ * the voyage it is in is over.
+ * ------------------------------------------------------------------------ */
+
+#ifndef TAIPAN_ADVICE_H
+#define TAIPAN_ADVICE_H
+
+#include "engine.h"
+
+/* What there is to decide. */
+#define ADVICE_PORT 0  /* At the port menu: what to buy, and where to. */
+#define ADVICE_SAIL 1  /* At quit()'s prompt: where to, as loaded. */
+
+struct advice_plan
+{
+    int    buy,       /* The good to fill the hold with, or -1. */
+           dest;
+    long   voyages;   /* Played so far. */
+    double profit,    /* Net worth gained by the next port, counting the
+                       * cargo at the prices there; on average. */
+           pirates,   /* The chance of meeting pirates on the way, */
+           storm,     /* of a storm, */
+           lost;      /* and of the ship going down. */
+};
+
+struct advice;
+
+/* NULL if we are out of memory. */
+struct advice *advice_new(void);
+void          advice_free(struct advice *a);
+
+/* Starts working out the plans for g, stopping any work under way.
+ * Returns 0, or -1 if the thread could not be had. */
+int  advice_start(struct advice *a, const struct game_state *g, int what);
+
+/* The plan with the most profit so far in *best; 0 if no plan has been
+ * played yet. */
+int  advice_best(struct advice *a, struct advice_plan *best);
+
+/* Stops the work, if any is under way, and waits for it to stop. */
+void advice_stop(struct advice *a);
+
+#endif /* TAIPAN_ADVICE_H */
@@ -0,0 +1,776 @@
+/* ------------------------------------------------------------------------ *
+ * Curses, just enough of it, into a buffer.  See ansi.h.
+ *
+ * As in curses, a window holds what has been drawn on it; wnoutrefresh()
+ * copies the lines of it that have changed to what the screen is to show
+ * ("want"); and doupdate() compares that with what the terminal shows
+ * ("shown") and appends the escape sequences for the difference.
+ * ------------------------------------------------------------------------ */
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ansi.h"
+
+#define BLANK   ((chtype) ' ')
+#define BUFFER  8192   /* Output held to start with: a full screen. */
+#define SKIP    4      /* Unchanged cells we will send again rather than
+                        * move the cursor over them. */
+#define REPEAT  6      /* The fewest of a character worth a REP for. */
+
+struct ansi_window
+{
+    SCREEN        *screen;
+    chtype        cells[ANSI_LINES][ANSI_COLS];
+    unsigned char touched[ANSI_LINES];
+    int           y,
+                  x;
+    chtype        attr;
+};
+
+struct ansi_screen
+{
+    WINDOW std;
+    chtype want[ANSI_LINES][ANSI_COLS],
+           shown[ANSI_LINES][ANSI_COLS];
+    int    clear,         /* Start the next update from a cleared terminal. */
+           cursor,        /* Whether the cursor is to be seen... */
+           cursor_shown,  /* ...and whether it is. */
+           ty,            /* Where the terminal's cursor is (-1: who knows). */
+           tx;
+    chtype tattr;         /* The terminal's attributes. */
+
+    char   *out;
+    size_t len,
+           cap;
+};
+
+WINDOW        *stdscr;
+int           LINES,
+              COLS;
+static SCREEN *screen;
+
+/* ------------------------------------------------------------------------ *
+ * Output.
+ * ------------------------------------------------------------------------ */
+
+static void put(SCREEN *s, const char *buf, size_t n)
+{
+    if (s->len + n > s->cap)
+    {
+        size_t cap = s->cap * 2;
+        char   *grown;
+
+        while (cap < s->len + n)
+        {
+            cap *= 2;
+        }
+        if ((grown = realloc(s->out, cap)) == NULL)
+        {
+            /* The terminal will miss some of this frame: start the next
+             * one from scratch, so that it ends up right. */
+            s->len   = 0;
+            s->clear = 1;
+            return;
+        }
+        s->out = grown;
+        s->cap = cap;
+    }
+    memcpy(s->out + s->len, buf, n);
+    s->len += n;
+}
+
+static void puts_(SCREEN *s, const char *str)
+{
+    put(s, str, strlen(str));
+}
+
+/* Moves the cursor the shortest way we know. */
+static void go(SCREEN *s, int y, int x)
+{
+    char buf[16];
+    int  n = 0;
+
+    if ((y == s->ty) && (x == s->tx))
+    {
+        return;
+    }
+
+    if ((s->ty >= 0) && (x == 0) && ((y == s->ty) || (y == s->ty + 1)))
+    {
+        n = snprintf(buf, sizeof(buf), (y == s->ty) ? "\r" : "\r\n");
+    } else if ((y == s->ty) && (s->tx >= 0) && (x < s->tx) && (s->tx - x <= 3)) {
+        n = snprintf(buf, sizeof(buf), "%.*s", s->tx - x, "\b\b\b");
+    } else if ((y == s->ty) && (s->tx >= 0) && (x > s->tx)) {
+        n = snprintf(buf, sizeof(buf), "\33[%dC", x - s->tx);
+    } else if ((y != s->ty) && (s->tx >= 0) && (x == s->tx)) {
+        n = snprintf(buf, sizeof(buf), "\33[%dd", y + 1);
+    } else if (x == 0) {
+        n = snprintf(buf, sizeof(buf), "\r\33[%dd", y + 1);
+    } else {
+        n = snprintf(buf, sizeof(buf), "\33[%d;%dH", y + 1, x + 1);
+    }
+    put(s, buf, n);
+
+    s->ty = y;
+    s->tx = x;
+}
+
+static void set_attr(SCREEN *s, chtype attr)
+{
+    if (attr != s->tattr)
+    {
+        puts_(s, (attr & A_REVERSE) ? "\33[7m" : "\33[0m");
+        s->tattr = attr;
+    }
+}
+
+static void send_cell(SCREEN *s, int y, int x)
+{
+    chtype c = s->want[y][x];
+    char   ch = c & A_CHARTEXT;
+
+    set_attr(s, c & ~A_CHARTEXT);
+    put(s, &ch, 1);
+    s->shown[y][x] = c;
+
+    /* After the last column the terminal is waiting to wrap, and where its
+     * cursor is depends on the terminal. */
+    s->tx = (x + 1 < ANSI_COLS) ? x + 1 : -1;
+}
+
+/* Sends the cell at y, x, and as many more of it along the line as are
+ * worth it, as a repeat (ECMA-48 REP).  Returns how many cells it sent. */
+static int send_run(SCREEN *s, int y, int x)
+{
+    char buf[16];
+    int  n,
+         i;
+
+    send_cell(s, y, x);
+    for (n = 1; (x + n < ANSI_COLS) && (s->want[y][x + n] == s->want[y][x]); n++)
+    {
+        ;
+    }
+    while ((n > 1) && (s->shown[y][x + n - 1] == s->want[y][x]))
+    {
+        n--;
+    }
+    if (n <= REPEAT)
+    {
+        return 1;
+    }
+
+    put(s, buf, snprintf(buf, sizeof(buf), "\33[%db", n - 1));
+    for (i = 1; i < n; i++)
+    {
+        s->shown[y][x + i] = s->want[y][x];
+    }
+    s->tx = (x + n < ANSI_COLS) ? x + n : -1;
+
+    return n;
+}
+
+/* Whether the n cells from cells on are blank. */
+static int blank(const chtype *cells, int n)
+{
+    while (n-- > 0)
+    {
+        if (*cells++ != BLANK)
+        {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+static int update(SCREEN *s)
+{
+    int    y,
+           x,
+           i;
+
+    if (s->clear)
+    {
+        puts_(s, "\33[0m\33[H\33[2J");
+        for (y = 0; y < ANSI_LINES; y++)
+        {
+            for (x = 0; x < ANSI_COLS; x++)
+            {
+                s->shown[y][x] = BLANK;
+            }
+        }
+        s->ty    = 0;
+        s->tx    = 0;
+        s->tattr = A_NORMAL;
+        s->clear = 0;
+    }
+
+    /* Nothing wanted from some line down, where something is shown: erase
+     * it all at once. */
+    for (y = ANSI_LINES; (y > 0) && blank(s->want[y - 1], ANSI_COLS); y--)
+    {
+        ;
+    }
+    for (i = y, x = 0; i < ANSI_LINES; i++)
+    {
+        x += !blank(s->shown[i], ANSI_COLS);
+    }
+    if (x > 1)
+    {
+        go(s, y, 0);
+        set_attr(s, A_NORMAL);
+        puts_(s, "\33[J");
+        for (; y < ANSI_LINES; y++)
+        {
+            for (x = 0; x < ANSI_COLS; x++)
+            {
+                s->shown[y][x] = BLANK;
+            }
+        }
+    }
+
+    if (s->cursor != s->cursor_shown)
+    {
+        puts_(s, s->cursor ? "\33[?25h" : "\33[?25l");
+        s->cursor_shown = s->cursor;
+    }
+
+    for (y = 0; y < ANSI_LINES; y++)
+    {
+        if (memcmp(s->want[y], s->shown[y], sizeof(s->want[y])) == 0)
+        {
+            continue;
+        }
+
+        for (x = 0; x < ANSI_COLS; x++)
+        {
+            if (s->want[y][x] == s->shown[y][x])
+            {
+                continue;
+            }
+
+            /* Nothing more on this line: erase the rest of it, unless
+             * there is less there than the erasing takes. */
+            for (i = ANSI_COLS; (i > x) && (s->shown[y][i - 1] == BLANK); i--)
+            {
+                ;
+            }
+            if ((i - x > 3) && blank(s->want[y] + x, ANSI_COLS - x))
+            {
+                go(s, y, x);
+                set_attr(s, A_NORMAL);
+                puts_(s, "\33[K");
+                for (i = x; i < ANSI_COLS; i++)
+                {
+                    s->shown[y][i] = BLANK;
+                }
+                break;
+            }
+
+            /* A few cells along the line: send them again, it is shorter
+             * than moving over them. */
+            if ((s->ty == y) && (s->tx >= 0) && (s->tx < x) &&
+                    (x - s->tx <= SKIP))
+            {
+                while (s->tx < x)
+                {
+                    send_cell(s, y, s->tx);
+                }
+            }
+
+            go(s, y, x);
+            x += send_run(s, y, x) - 1;
+        }
+    }
+
+    if (s->cursor)
+    {
+        go(s, s->std.y, s->std.x);
+    }
+
+    return OK;
+}
+
+int doupdate(void)
+{
+    return update(screen);
+}
+
+void ansi_repaint(SCREEN *s)
+{
+    s->len          = 0;
+    s->clear        = 1;
+    s->cursor_shown = !s->cursor;  /* Say which it is, too. */
+    update(s);
+}
+
+char *ansi_snapshot(SCREEN *s, size_t *len)
+{
+    SCREEN *t = malloc(sizeof(*t));
+    char   *out;
+
+    if ((t == NULL) || ((out = malloc(BUFFER)) == NULL))
+    {
+        free(t);
+        return NULL;
+    }
+
+    /* Draw what s's terminal will show once it has all s has sent it... */
+    memcpy(t, s, sizeof(*t));
+    memcpy(t->want, s->shown, sizeof(t->want));
+    t->out          = out;
+    t->len          = 0;
+    t->cap          = BUFFER;
+    t->clear        = 1;
+    t->cursor       = s->cursor_shown;
+    t->cursor_shown = !t->cursor;
+    update(t);
+
+    /* ...and leave the cursor and attributes as s's will be, for what s
+     * sends next to carry on from. */
+    if ((s->ty >= 0) && (s->tx < 0))
+    {
+        go(t, s->ty, ANSI_COLS - 1);
+        send_cell(t, s->ty, ANSI_COLS - 1);
+    } else if (s->ty >= 0) {
+        go(t, s->ty, s->tx);
+    }
+    set_attr(t, s->tattr);
+
+    out  = t->clear ? NULL : t->out;  /* Unless we ran out of memory. */
+    *len = t->len;
+    if (out == NULL)
+    {
+        free(t->out);
+    }
+    free(t);
+
+    return out;
+}
+
+/* ------------------------------------------------------------------------ *
+ * Screens.
+ * ------------------------------------------------------------------------ */
+
+static void blank_window(WINDOW *w)
+{
+    int y,
+        x;
+
+    for (y = 0; y < ANSI_LINES; y++)
+    {
+        for (x = 0; x < ANSI_COLS; x++)
+        {
+            w->cells[y][x] = BLANK;
+        }
+        w->touched[y] = 1;
+    }
+    w->y = 0;
+    w->x = 0;
+}
+
+SCREEN *ansi_newterm(void)
+{
+    SCREEN *s = calloc(1, sizeof(*s));
+
+    if ((s == NULL) || ((s->out = malloc(BUFFER)) == NULL))
+    {
+        free(s);
+        return NULL;
+    }
+    s->cap = BUFFER;
+
+    s->std.screen = s;
+    blank_window(&s->std);
+    memcpy(s->want, s->std.cells, sizeof(s->want));
+
+    /* Whatever the terminal shows now, the first update clears it. */
+    s->clear        = 1;
+    s->cursor       = 1;
+    s->cursor_shown = 1;
+
+    set_term(s);
+
+    return s;
+}
+
+SCREEN *set_term(SCREEN *s)
+{
+    SCREEN *old = screen;
+
+    screen = s;
+    stdscr = &s->std;
+    LINES  = ANSI_LINES;
+    COLS   = ANSI_COLS;
+
+    return old;
+}
+
+void delscreen(SCREEN *s)
+{
+    if (screen == s)
+    {
+        screen = NULL;
+        stdscr = NULL;
+    }
+    free(s->out);
+    free(s);
+}
+
+int endwin(void)
+{
+    SCREEN *s = screen;
+
+    set_attr(s, A_NORMAL);
+    puts_(s, "\33[?25h\33[24;1H\r\n");
+    s->cursor_shown = 1;
+    s->ty = -1;
+
+    return OK;
+}
+
+const char *ansi_output(SCREEN *s, size_t *len)
+{
+    *len = s->len;
+
+    return s->out;
+}
+
+void ansi_consume(SCREEN *s, size_t n)
+{
+    memmove(s->out, s->out + n, s->len - n);
+    s->len -= n;
+}
+
+/* ------------------------------------------------------------------------ *
+ * Drawing.
+ * ------------------------------------------------------------------------ */
+
+static int wmove(WINDOW *w, int y, int x)
+{
+    if ((y < 0) || (y >= ANSI_LINES) || (x < 0) || (x >= ANSI_COLS))
+    {
+        return ERR;
+    }
+    w->y = y;
+    w->x = x;
+
+    return OK;
+}
+
+static void wclrtoeol(WINDOW *w)
+{
+    int x;
+
+    for (x = w->x; x < ANSI_COLS; x++)
+    {
+        w->cells[w->y][x] = BLANK;
+    }
+    w->touched[w->y] = 1;
+}
+
+/* One character, as curses' waddch() has it. */
+static void waddch(WINDOW *w, int c)
+{
+    c &= 0xff;
+
+    switch (c)
+    {
+        case '\n':
+            wclrtoeol(w);
+            if (w->y < ANSI_LINES - 1)
+            {
+                w->y++;
+            }
+            w->x = 0;
+            return;
+
+        case '\r':
+            w->x = 0;
+            return;
+
+        case '\b':
+            if (w->x > 0)
+            {
+                w->x--;
+            }
+            return;
+
+        case '\t':
+            do
+            {
+                waddch(w, ' ');
+            } while ((w->x % 8) != 0);
+            return;
+    }
+
+    if ((c < ' ') || (c == 127))
+    {
+        waddch(w, '^');
+        waddch(w, c ^ 0x40);
+        return;
+    }
+    if (c > 127)
+    {
+        c = '?';
+    }
+
+    w->cells[w->y][w->x] = c | w->attr;
+    w->touched[w->y] = 1;
+    if (++w->x == ANSI_COLS)
+    {
+        if (w->y < ANSI_LINES - 1)
+        {
+            w->y++;
+            w->x = 0;
+        } else {
+            w->x--;  /* No scrolling: stay in the corner. */
+        }
+    }
+}
+
+int move(int y, int x)
+{
+    return wmove(stdscr, y, x);
+}
+
+int printw(const char *fmt, ...)
+{
+    char    buf[512];
+    va_list ap;
+    int     i,
+            n;
+
+    va_start(ap, fmt);
+    n = vsnprintf(buf, sizeof(buf), fmt, ap);
+    va_end(ap);
+
+    if (n > (int) sizeof(buf) - 1)
+    {
+        n = sizeof(buf) - 1;
+    }
+    for (i = 0; i < n; i++)
+    {
+        waddch(stdscr, buf[i]);
+    }
+
+    return OK;
+}
+
+int clrtoeol(void)
+{
+    wclrtoeol(stdscr);
+
+    return OK;
+}
+
+int clrtobot(void)
+{
+    int y = stdscr->y,
+        x;
+
+    wclrtoeol(stdscr);
+    for (y++; y < ANSI_LINES; y++)
+    {
+        for (x = 0; x < ANSI_COLS; x++)
+        {
+            stdscr->cells[y][x] = BLANK;
+        }
+        stdscr->touched[y] = 1;
+    }
+
+    return OK;
+}
+
+int erase(void)
+{
+    blank_window(stdscr);
+
+    return OK;
+}
+
+int clear(void)
+{
+    erase();
+    screen->clear = 1;
+
+    return OK;
+}
+
+int attrset(int attr)
+{
+    stdscr->attr = attr & ~A_CHARTEXT;
+
+    return OK;
+}
+
+int mvaddchnstr(int y, int x, const chtype *chstr, int n)
+{
+    int i;
+
+    if (wmove(stdscr, y, x) == ERR)
+    {
+        return ERR;
+    }
+    for (i = 0; (i < n) && (x + i < ANSI_COLS) && (chstr[i] != 0); i++)
+    {
+        stdscr->cells[y][x + i] = chstr[i];
+    }
+    stdscr->touched[y] = 1;
+
+    return OK;
+}
+
+int mvinnstr(int y, int x, char *str, int n)
+{
+    int i;
+
+    if (wmove(stdscr, y, x) == ERR)
+    {
+        return ERR;
+    }
+    for (i = 0; (i < n) && (x + i < ANSI_COLS); i++)
+    {
+        str[i] = stdscr->cells[y][x + i] & A_CHARTEXT;
+    }
+    str[i] = '\0';
+
+    return i;
+}
+
+int wnoutrefresh(WINDOW *w)
+{
+    SCREEN *s;
+    int    y;
+
+    if (w == NULL)
+    {
+        return ERR;
+    }
+    s = w->screen;
+
+    for (y = 0; y < ANSI_LINES; y++)
+    {
+        if (w->touched[y])
+        {
+            memcpy(s->want[y], w->cells[y], sizeof(s->want[y]));
+            w->touched[y] = 0;
+        }
+    }
+
+    return OK;
+}
+
+int refresh(void)
+{
+    wnoutrefresh(stdscr);
+
+    return doupdate();
+}
+
+/* ------------------------------------------------------------------------ *
+ * Windows.
+ * ------------------------------------------------------------------------ */
+
+WINDOW *newwin(int lines, int cols, int y, int x)
+{
+    WINDOW *w;
+
+    /* Only the whole screen, which is all taipan.c asks for. */
+    if ((lines != 0) || (cols != 0) || (y != 0) || (x != 0) ||
+            ((w = calloc(1, sizeof(*w))) == NULL))
+    {
+        return NULL;
+    }
+    w->screen = screen;
+    blank_window(w);
+
+    return w;
+}
+
+int delwin(WINDOW *w)
+{
+    if (w == NULL)
+    {
+        return ERR;
+    }
+    free(w);
+
+    return OK;
+}
+
+int mvwhline(WINDOW *w, int y, int x, chtype ch, int n)
+{
+    int i;
+
+    if ((w == NULL) || (wmove(w, y, x) == ERR))
+    {
+        return ERR;
+    }
+    for (i = 0; (i < n) && (x + i < ANSI_COLS); i++)
+    {
+        w->cells[y][x + i] = ch | w->attr;
+    }
+    w->touched[y] = 1;
+
+    return OK;
+}
+
+int touchwin(WINDOW *w)
+{
+    if (w == NULL)
+    {
+        return ERR;
+    }
+    memset(w->touched, 1, sizeof(w->touched));
+
+    return OK;
+}
+
+/* ------------------------------------------------------------------------ *
+ * Modes.  A telnet client in character mode is in cbreak and noecho as
+ * far as we are concerned.
+ * ------------------------------------------------------------------------ */
+
+int cbreak(void)
+{
+    return OK;
+}
+
+int nocbreak(void)
+{
+    return OK;
+}
+
+int noecho(void)
+{
+    return OK;
+}
+
+int curs_set(int visibility)
+{
+    int old = screen->cursor;
+
+    screen->cursor = (visibility != 0);
+
+    return old;
+}
+
+void timeout(int delay)
+{
+    (void) delay;
+}
+
+int getch(void)
+{
+    return ERR;
+}
+
+int flushinp(void)
+{
+    return OK;
+}
@@ -0,0 +1,96 @@
+/* ------------------------------------------------------------------------ *
+ * Just enough of curses for taipan.c, drawing straight into a buffer of
+ * ANSI escape sequences.
+ *
+ * The server builds taipan.c against this instead of <curses.h> (with
+ * TAIPAN_ANSI defined).  There is no terminfo to load and nothing is
+ * written anywhere: each screen keeps what the terminal shows and what it
+ * should show, and refresh() appends the escape sequences that take one
+ * to the other to the screen's output buffer.  The caller takes the
+ * buffer whole, and can send a frame in one write().
+ *
+ * The terminal is taken to be 80 by 24 and to understand ANSI (ECMA-48)
+ * cursor movement, erasing, repeating and reverse video, as the xterm the
+ * server used to ask curses for does.  Keys do not come through here at all:
+ * getch() and friends are only stubs, to keep taipan.c's own terminal
+ * code building.
+ * ------------------------------------------------------------------------ */
+
+#ifndef TAIPAN_ANSI_H
+#define TAIPAN_ANSI_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define ANSI_LINES 24
+#define ANSI_COLS  80
+
+#define ERR        (-1)
+#define OK         0
+
+typedef uint32_t chtype;
+
+#define A_NORMAL   0x00000
+#define A_REVERSE  0x40000
+#define A_CHARTEXT 0x000ff
+
+typedef struct ansi_window WINDOW;
+typedef struct ansi_screen SCREEN;
+
+extern WINDOW *stdscr;
+extern int    LINES,
+              COLS;
+
+/* Screens. */
+SCREEN *ansi_newterm(void);
+SCREEN *set_term(SCREEN *s);
+void   delscreen(SCREEN *s);
+int    endwin(void);
+
+/* The escape sequences s has drawn and not yet been rid of, and ridding
+ * it of the first n of them. */
+const char *ansi_output(SCREEN *s, size_t *len);
+void       ansi_consume(SCREEN *s, size_t n);
+
+/* Throws away what s has drawn and not been rid of, and draws the whole
+ * screen as refresh() last left it, for a terminal showing who knows
+ * what. */
+void       ansi_repaint(SCREEN *s);
+
+/* The whole screen as it will be once all s has drawn is shown, drawn on
+ * its own, for another terminal to join s's output from there on.  The
+ * caller frees it.  NULL if we are out of memory. */
+char       *ansi_snapshot(SCREEN *s, size_t *len);
+
+/* Drawing on stdscr. */
+int    move(int y, int x);
+int    printw(const char *fmt, ...) __attribute__((format(printf, 1, 2)));
+int    clrtoeol(void);
+int    clrtobot(void);
+int    erase(void);
+int    clear(void);
+int    attrset(int attr);
+int    mvaddchnstr(int y, int x, const chtype *chstr, int n);
+int    mvinnstr(int y, int x, char *str, int n);
+int    refresh(void);
+
+/* Other windows, all of them the whole screen. */
+WINDOW *newwin(int lines, int cols, int y, int x);
+int    delwin(WINDOW *w);
+int    mvwhline(WINDOW *w, int y, int x, chtype ch, int n);
+int    touchwin(WINDOW *w);
+int    wnoutrefresh(WINDOW *w);
+int    doupdate(void);
+
+/* Terminal modes, and the cursor. */
+int    cbreak(void);
+int    nocbreak(void);
+int    noecho(void);
+int    curs_set(int visibility);
+
+/* Stubs: keys come to the server's games another way. */
+void   timeout(int delay);
+int    getch(void);
+int    flushinp(void);
+
+#endif /* TAIPAN_ANSI_H */
@@ -0,0 +1,1513 @@
+/* ------------------------------------------------------------------------ *
+ * Taipan game engine: the rules of the game, lifted out of the curses code
+ * in taipan.c.  Nothing in here draws, sleeps or reads the keyboard.
+ * ------------------------------------------------------------------------ */
+
+#include <assert.h>  /* EJB */
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "engine.h"
+
+/* Where game_step() picks up.  These run in the order main() and quit()
+ * always ran them. */
+enum
+{
+    STEP_ARRIVE,
+    STEP_LI_YUEN,
+    STEP_MCHENRY,
+    STEP_WU_WARNING,
+    STEP_WU,
+    STEP_CUTTHROATS,
+    STEP_SHIP_OR_GUN,
+    STEP_SHIP_GUN,
+    STEP_NEW_GUN,
+    STEP_SEIZURE,
+    STEP_THEFT,
+    STEP_LI_DECAY,
+    STEP_SUMMONS,
+    STEP_GOOD_PRICES,
+    STEP_ROBBERY,
+    STEP_PORT,
+    STEP_WHEEDLE,
+    STEP_WHEEDLE_CUTTHROATS,
+    STEP_PIRATES,
+    STEP_BATTLE,
+    STEP_LI_YUEN_PIRATES,
+    STEP_BATTLE_RESULT,
+    STEP_STORM,
+    STEP_GOING_DOWN,
+    STEP_SINKING,
+    STEP_STORM_SURVIVED,
+    STEP_BLOWN_OFF_COURSE,
+    STEP_MONTH,
+    STEP_MONTH_DUE,
+    STEP_ARRIVING,
+    STEP_OVER
+};
+
+/* Where battle_step() picks up. */
+enum
+{
+    BS_ROUND,
+    BS_SPAWN,
+    BS_ORDERS,
+    BS_ACT,
+    BS_SHOT,
+    BS_TARGET,
+    BS_VOLLEY_END,
+    BS_RAN_AWAY,
+    BS_CLEAR,
+    BS_ORDERS_CHANGE,
+    BS_RUN,
+    BS_ESCAPE_SOME,
+    BS_FIRE,
+    BS_GUN_HIT,
+    BS_DAMAGE,
+    BS_END
+};
+
+static int base_price[4][8] = { {1000, 11, 16, 15, 14, 12, 10, 13},
+    {100,  11, 14, 15, 16, 10, 13, 12},
+    {10,   12, 16, 10, 11, 13, 14, 15},
+    {1,    10, 11, 12, 13, 14, 15, 16} };
+
+/* Was rand()%n. */
+static int rnd(struct game_state *g, int n)
+{
+    return rng_below(&g->rng, n);
+}
+
+/* Was (float) rand() / RAND_MAX. */
+static float frand(struct game_state *g)
+{
+    return rng_float(&g->rng);
+}
+
+static int event(struct game_event *ev, int type, int n, int m, float amount)
+{
+    ev->type   = type;
+    ev->n      = n;
+    ev->m      = m;
+    ev->amount = amount;
+
+    return type;
+}
+
+void game_init(struct game_state *g)
+{
+    memset(g, 0, sizeof(*g));
+
+#ifdef DEBUG
+    g->cash     = 100000;
+    g->bank     = 1000000;
+#endif
+    g->ec       = 20;
+    g->ed       = 0.5;
+    g->capacity = 60;
+    g->month    = 1;
+    g->year     = 1860;
+    g->port     = 1;
+    g->step     = STEP_OVER;
+
+    game_seed(g, 0);
+}
+
+void game_seed(struct game_state *g, uint64_t seed)
+{
+    g->seed = seed;
+    rng_seed(&g->rng, seed);
+}
+
+/* Was cash_or_guns(). */
+void game_start(struct game_state *g, int with_cash)
+{
+    if (with_cash)
+    {
+        g->cash = 400;
+        g->debt = 5000;
+        g->hold = 60;
+        g->guns = 0;
+        g->li   = 0;
+        g->bp   = 10;
+    } else {
+        g->cash = 0;
+        g->debt = 0;
+        g->hold = 10;
+        g->guns = 5;
+        g->li   = 1;
+        g->bp   = 7;
+    }
+
+    game_set_prices(g);
+
+    g->over = GAME_RUNNING;
+    g->step = STEP_ARRIVE;
+}
+
+/* What final_stats() reset before playing again.  Debt, guns, Li Yuen and
+ * the strength of the enemy carry over, as they always have; game_start()
+ * sets the rest. */
+void game_restart(struct game_state *g)
+{
+    int i;
+
+    g->bank = 0;
+    for (i = 0; i < 4; i++)
+    {
+        g->hkw_[i]  = 0;
+        g->hold_[i] = 0;
+    }
+    g->hold     = 0;
+    g->capacity = 60;
+    g->damage   = 0;
+    g->month    = 1;
+    g->year     = 1860;
+    g->port     = 1;
+}
+
+void game_set_prices(struct game_state *g)
+{
+    int i;
+
+    for (i = 0; i < 4; i++)
+    {
+        g->price[i] = base_price[i][g->port] / 2 * (rnd(g, 3) + 1) *
+            base_price[i][0];
+    }
+}
+
+/* What set_prices() asks on average: its dice come up 2. */
+long game_mean_price(int item, int port)
+{
+    return base_price[item][port] / 2 * 2 * base_price[item][0];
+}
+
+int game_months(const struct game_state *g)
+{
+    return ((g->year - 1860) * 12) + g->month;
+}
+
+int game_status(const struct game_state *g)
+{
+    return 100 - (((float) g->damage / g->capacity) * 100);
+}
+
+int game_in_use(const struct game_state *g)
+{
+    return g->hkw_[0] + g->hkw_[1] + g->hkw_[2] + g->hkw_[3];
+}
+
+long long game_net_worth(const struct game_state *g)
+{
+    return (long long) g->cash + g->bank - g->debt;
+}
+
+/* Net worth, with the cargo aboard at the prices here. */
+double game_worth(const struct game_state *g)
+{
+    double sum = game_net_worth(g);
+    int    k;
+
+    for (k = 0; k < 4; k++)
+    {
+        sum += (double) g->hold_[k] * g->price[k];
+    }
+
+    return sum;
+}
+
+/* The final_stats() formula, without the unsigned wrap-around. */
+long long game_score(const struct game_state *g)
+{
+    return game_net_worth(g) / 100 / game_months(g);
+}
+
+static int cutthroats(struct game_state *g)
+{
+    if ((g->debt > 20000) && (g->cash > 0) && (rnd(g, 5) == 0))
+    {
+        int num = rnd(g, 3) + 1;
+
+        g->cash = 0;
+        return num;
+    }
+
+    return 0;
+}
+
+/* How many of the fleet are waiting off screen. */
+static int reserve(const struct battle *b)
+{
+    return (b->num_ships > b->num_on_screen) ?
+        b->num_ships - b->num_on_screen : 0;
+}
+
+/* Takes slot off the list of targets; its ship has sunk or gone. */
+static void unlive(struct battle *b, int slot)
+{
+    int k;
+
+    for (k = 0; k < b->num_on_screen; k++)
+    {
+        if (b->live[k] == slot)
+        {
+            b->live[k] = b->live[--b->num_on_screen];
+            break;
+        }
+    }
+    b->hp[slot] = 0;
+}
+
+/* Ships leaving the back of the fleet, from an old count of those waiting
+ * off screen to the new one. */
+static void drop_reserve(struct battle *b, int from)
+{
+    int k;
+
+    for (k = reserve(b); k < from; k++)
+    {
+        b->hp[ON_SCREEN + k] = 0;
+    }
+}
+
+/* For tools looking over a battle: see struct battle. */
+int game_fleet_reserve(const struct game_state *g)
+{
+    return reserve(&g->battle);
+}
+
+/* Hit points left in the whole enemy fleet. */
+long game_fleet_hp(const struct game_state *g)
+{
+    const struct battle *b = &g->battle;
+    const int16_t *hp = b->hp;
+    int  k,
+         n = ON_SCREEN + reserve(b);
+    long sum = 0;
+
+    for (k = 0; k < n; k++)
+    {
+        sum += hp[k];
+    }
+
+    return sum;
+}
+
+/* Everything but the enemy fleet past its last ship, which takes up most
+ * of a game and is never read: battle_begin() clears it all, and ships
+ * only ever leave the back of it. */
+void game_copy(struct game_state *to, const struct game_state *from)
+{
+    size_t head = offsetof(struct game_state, battle.hp),
+           tail = offsetof(struct game_state, seed);
+    int    n = ON_SCREEN + reserve(&from->battle);
+
+    memcpy(to, from, head);
+    memcpy(to->battle.hp, from->battle.hp, n * sizeof(from->battle.hp[0]));
+    memcpy(&to->seed, &from->seed, sizeof(*to) - tail);
+}
+
+/* Returns the ships there are to fight: no more than the hit points
+ * will hold, as the original had it. */
+static int battle_begin(struct game_state *g, int id, int num_ships)
+{
+    struct battle *b = &g->battle;
+    int k;
+
+    if (num_ships > FLEET_MAX)
+    {
+        num_ships = FLEET_MAX;
+    }
+
+    memset(b, 0, sizeof(*b));
+    b->id        = id;
+    b->num_ships = num_ships;
+    b->s0        = num_ships;
+    b->orders    = ORDERS_NONE;
+    b->ik        = 1;
+    b->step      = BS_ROUND;
+
+    /* Every ship is built now, the way they used to be built one by one on
+     * coming into view; none of them sees ec change before then. */
+    for (k = 0; k < num_ships; k++)
+    {
+        b->hp[ON_SCREEN + k] = (int)((g->ec * frand(g)) + 20);
+    }
+
+    g->booty = (game_months(g) / 4 * 1000 * num_ships) + rnd(g, 1000) + 250;
+    g->step  = STEP_BATTLE;
+
+    return num_ships;
+}
+
+static int battle_over(struct game_state *g, struct game_event *ev, int result)
+{
+    g->battle.result = result;
+    g->result        = result;
+    g->step          = (g->battle.id == GENERIC) ?
+        STEP_LI_YUEN_PIRATES : STEP_BATTLE_RESULT;
+
+    return event(ev, EV_BATTLE_OVER, result, 0, 0);
+}
+
+/* Was the body of sea_battle(). */
+static int battle_step(struct game_state *g, struct game_event *ev)
+{
+    struct battle *b = &g->battle;
+    int i;
+
+    for (;;)
+    {
+        switch (b->step)
+        {
+            case BS_ROUND:
+                if (b->num_ships <= 0)
+                {
+                    b->step = BS_END;
+                    break;
+                }
+                assert(g->capacity >= 0);  /* EJB */
+                i = game_status(g);
+                if (i <= 0)
+                {
+                    return battle_over(g, ev, BATTLE_LOST);  // Ship lost!
+                }
+                b->slot = 0;
+                b->next = BS_ORDERS;
+                b->step = BS_SPAWN;
+                return event(ev, EV_BATTLE_ROUND, i, 0, 0);
+
+            case BS_SPAWN:
+                while (b->slot < ON_SCREEN)
+                {
+                    i = b->slot++;
+                    if ((reserve(b) > 0) && (b->hp[i] == 0))
+                    {
+                        int16_t *next = &b->hp[ON_SCREEN + reserve(b) - 1];
+
+                        b->hp[i] = *next;
+                        *next = 0;
+                        b->live[b->num_on_screen++] = i;
+                        return event(ev, EV_SHIP_SPAWN, i, 0, 0);
+                    }
+                }
+                b->step = b->next;
+                break;
+
+            case BS_ORDERS:
+                b->step = BS_ACT;
+                return event(ev, EV_BATTLE_ORDERS, 0, 0, 0);
+
+            case BS_ACT:
+                b->step = BS_RUN;
+                if ((b->orders == ORDERS_FIGHT) && (g->guns > 0))
+                {
+                    b->ok   = 3;
+                    b->ik   = 1;
+                    b->sk   = 0;
+                    b->shot = 0;
+                    b->step = BS_SHOT;
+                    return event(ev, EV_VOLLEY, 0, 0, 0);
+                } else if (b->orders == ORDERS_FIGHT) {
+                    return event(ev, EV_NO_GUNS, 0, 0, 0);
+                } else if (b->orders == ORDERS_THROW) {
+                    return event(ev, EV_THROW_CARGO, 0, 0, 0);
+                }
+                break;
+
+            case BS_SHOT:
+                if (++b->shot > g->guns)
+                {
+                    b->step = BS_VOLLEY_END;
+                    break;
+                }
+                b->step = BS_TARGET;
+                if (b->num_on_screen == 0)
+                {
+                    b->slot = 0;
+                    b->next = BS_TARGET;
+                    b->step = BS_SPAWN;
+                }
+                break;
+
+            case BS_TARGET:
+            {
+                int targeted = b->live[rnd(g, b->num_on_screen)],
+                    sunk = 0;
+
+                b->hp[targeted] -= rnd(g, 30) + 10;
+
+                if (b->hp[targeted] <= 0)
+                {
+                    unlive(b, targeted);
+                    b->num_ships--;
+                    b->sk++;
+
+                    /* sink_lorcha() goes down slowly one time in 20. */
+                    sunk = (rnd(g, 20) == 0) ? 2 : 1;
+                }
+
+                b->step = (b->num_ships == 0) ? BS_VOLLEY_END : BS_SHOT;
+                return event(ev, EV_SHOT, targeted, sunk, 0);
+            }
+
+            case BS_VOLLEY_END:
+                b->step = BS_RAN_AWAY;
+                return event(ev, EV_VOLLEY_END, b->sk, 0, 0);
+
+            case BS_RAN_AWAY:
+                b->step = BS_RUN;
+                assert(b->s0 > 0); /* EJB: n%0 is NaN. */
+                if ((rnd(g, b->s0) > (b->num_ships * 0.6 / b->id)) &&
+                        (b->num_ships > 2))
+                {
+                    /* EJB: (num_ships / 3 / id) can be zero; n%0 is NaN. */
+                    int divisor = b->num_ships / 3 / b->id,
+                        ran,
+                        was = reserve(b);
+
+                    if (0 == divisor) { divisor = 1; }
+                    ran = rnd(g, divisor);
+                    if (0 == ran) { ran = 1; }
+
+                    b->num_ships -= ran;
+                    drop_reserve(b, was);
+                    b->slot = ON_SCREEN - 1;
+                    b->next = BS_RUN;
+                    b->step = BS_CLEAR;
+                    return event(ev, EV_RAN_AWAY, ran, 0, 0);
+                }
+                break;
+
+            case BS_CLEAR:
+                if (b->num_ships <= 10)
+                {
+                    while (b->slot >= 0)
+                    {
+                        i = b->slot--;
+                        if ((b->num_on_screen > b->num_ships) &&
+                                (b->hp[i] > 0))
+                        {
+                            unlive(b, i);
+                            return event(ev, EV_SHIP_CLEAR, i, 0, 0);
+                        }
+                    }
+                }
+                b->step = BS_ORDERS_CHANGE;
+                break;
+
+            case BS_ORDERS_CHANGE:
+                b->step = b->next;
+                return event(ev, EV_ORDERS_CHANGE, 0, 0, 0);
+
+            case BS_RUN:
+                b->step = BS_FIRE;
+                if ((b->orders == ORDERS_RUN) || (b->orders == ORDERS_THROW))
+                {
+                    int l, r;
+
+                    b->ok += b->ik++;
+                    assert (b->ok > 0); /* EJB: n%0 is NaN. */
+                    l = rnd(g, b->ok);
+                    r = rnd(g, b->num_ships);
+                    if (l > r)
+                    {
+                        int was = reserve(b);
+
+                        b->num_ships = 0;
+                        drop_reserve(b, was);
+                        return event(ev, EV_ESCAPE, 1, 0, 0);
+                    }
+
+                    b->step = BS_ESCAPE_SOME;
+                    return event(ev, EV_ESCAPE, 0, 0, 0);
+                }
+                break;
+
+            case BS_ESCAPE_SOME:
+                b->step = BS_FIRE;
+                if ((b->num_ships > 2) && (rnd(g, 5) == 0))
+                {
+                    /* EJB: % and / have same precedence, so this should be safe. Esp. since num_ships > 2... */
+                    int lost = (rnd(g, b->num_ships) / 2) + 1,
+                        was = reserve(b);
+
+                    b->num_ships -= lost;
+                    drop_reserve(b, was);
+                    b->slot = ON_SCREEN - 1;
+                    b->next = BS_FIRE;
+                    b->step = BS_CLEAR;
+                    return event(ev, EV_ESCAPED_SOME, lost, 0, 0);
+                }
+                break;
+
+            case BS_FIRE:
+                if (b->num_ships > 0)
+                {
+                    b->step = BS_GUN_HIT;
+                    return event(ev, EV_ENEMY_FIRE, 0, 0, 0);
+                }
+                b->step = BS_ROUND;
+                break;
+
+            case BS_GUN_HIT:
+                b->step = BS_DAMAGE;
+                b->hits = (b->num_ships > 15) ? 15 : b->num_ships;
+                if ((g->guns > 0) &&
+                        ((rnd(g, 100) < (((float) g->damage / g->capacity) * 100)) ||
+                         ((((float) g->damage / g->capacity) * 100) > 80)))
+                {
+                    b->hits = 1;
+/* EJB: Don't lose guns when debugging. */
+#ifndef DEBUG
+                    g->guns--;
+                    g->hold += 10;
+#endif
+                    return event(ev, EV_GUN_HIT, 0, 0, 0);
+                }
+                break;
+
+            case BS_DAMAGE:
+/* EJB: Don't lose guns when debugging. */
+#ifndef DEBUG
+                g->damage = g->damage +
+                    ((g->ed * b->hits * b->id) * frand(g)) + (b->hits / 2);
+#endif
+                if ((b->id == GENERIC) && (rnd(g, 20) == 0))
+                {
+                    return battle_over(g, ev, BATTLE_INTERRUPTED);  // Battle interrupted by Li Yuen's pirates.
+                }
+                b->step = BS_ROUND;
+                break;
+
+            case BS_END:
+            default:
+                return battle_over(g, ev, (b->orders == ORDERS_FIGHT) ?
+                        BATTLE_WON : BATTLE_FLED);
+        }
+    }
+}
+
+/* The end of every voyage in quit(). */
+static void turn_month(struct game_state *g)
+{
+    g->month++;
+    if (g->month == 13)
+    {
+        g->month = 1;
+        g->year++;
+        g->ec += 10;
+        g->ed += 0.5;
+    }
+
+    g->debt = g->debt + (g->debt * 0.1);
+    g->bank = g->bank + (g->bank * 0.005);
+    game_set_prices(g);
+}
+
+int game_step(struct game_state *g, struct game_event *ev)
+{
+    int i;
+
+    for (;;)
+    {
+        switch (g->step)
+        {
+            case STEP_ARRIVE:
+                g->step = STEP_LI_YUEN;
+                return event(ev, EV_IN_PORT, g->port, 0, 0);
+
+            case STEP_LI_YUEN:
+                g->step = STEP_MCHENRY;
+                if ((g->port == 1) && (g->li == 0) && (g->cash > 0))
+                {
+                    int   time = game_months(g);
+                    float i = 1.8,
+                          j = 0;
+
+                    if (time > 12)
+                    {
+                        j = rnd(g, 1000 * time) + (1000 * time);
+                        i = 1;
+                    }
+
+                    g->offer = ((g->cash / i) * frand(g)) + j;
+                    return event(ev, EV_LI_YUEN_DEMAND, 0, 0, g->offer);
+                }
+                break;
+
+            case STEP_MCHENRY:
+                g->step = STEP_WU_WARNING;
+                if ((g->port == 1) && (g->damage > 0))
+                {
+                    g->br = 0;
+                    return event(ev, EV_MCHENRY, 0, 0, 0);
+                }
+                break;
+
+            case STEP_WU_WARNING:
+                g->step = STEP_WU;
+                if ((g->port == 1) && (g->debt >= 10000) && (g->wu_warn == 0))
+                {
+                    int braves = rnd(g, 100) + 50;
+
+                    g->wu_warn = 1;
+                    return event(ev, EV_WU_WARNING, braves, 0, 0);
+                }
+                break;
+
+            case STEP_WU:
+                g->step = STEP_SHIP_OR_GUN;
+                if (g->port == 1)
+                {
+                    g->step = STEP_CUTTHROATS;
+                    return event(ev, EV_WU, 0, 0, 0);
+                }
+                break;
+
+            case STEP_CUTTHROATS:
+                g->step = STEP_SHIP_OR_GUN;
+                if ((i = cutthroats(g)) > 0)
+                {
+                    return event(ev, EV_CUTTHROATS, i, 0, 0);
+                }
+                break;
+
+            case STEP_SHIP_OR_GUN:
+                g->step = STEP_SEIZURE;
+                if (rnd(g, 4) == 0)
+                {
+                    if (rnd(g, 2) == 0)
+                    {
+                        int time = game_months(g);
+
+                        g->offer = rnd(g, 1000 * (time + 5) / 6) *
+                            (g->capacity / 50) + 1000;
+                        if (g->cash < g->offer)
+                        {
+                            break;
+                        }
+
+                        g->step = STEP_SHIP_GUN;
+                        return event(ev, EV_NEW_SHIP, 0, 0, g->offer);
+                    } else if (g->guns < 1000) {
+                        g->step = STEP_NEW_GUN;
+                    }
+                }
+                break;
+
+            case STEP_SHIP_GUN:
+                g->step = STEP_SEIZURE;
+                if ((rnd(g, 2) == 0) && (g->guns < 1000))
+                {
+                    g->step = STEP_NEW_GUN;
+                }
+                break;
+
+            case STEP_NEW_GUN:
+            {
+                int time = game_months(g);
+
+                g->step  = STEP_SEIZURE;
+                g->offer = rnd(g, 1000 * (time + 5) / 6) + 500;
+                if ((g->cash < g->offer) || (g->hold < 10))
+                {
+                    break;
+                }
+
+                return event(ev, EV_NEW_GUN, 0, 0, g->offer);
+            }
+
+            case STEP_SEIZURE:
+                g->step = STEP_THEFT;
+                if ((g->port != 1) && (rnd(g, 18) == 0) && (g->hold_[0] > 0))
+                {
+                    float fine = ((g->cash / 1.8) * frand(g)) + 1;
+                    /* EJB: Prevent -1 cash */
+                    if (g->cash == 0)
+                    {
+                        fine = 0;
+                    }
+
+                    g->hold += g->hold_[0];
+                    g->hold_[0] = 0;
+                    g->cash -= fine;
+
+                    return event(ev, EV_OPIUM_SEIZED, 0, 0, fine);
+                }
+                break;
+
+            case STEP_THEFT:
+                g->step = STEP_LI_DECAY;
+                if ((rnd(g, 50) == 0) && (game_in_use(g) > 0))
+                {
+                    for (i = 0; i < 4; i++)
+                    {
+                        g->hkw_[i] = ((g->hkw_[i] / 1.8) * frand(g));
+                    }
+
+                    return event(ev, EV_WAREHOUSE_THEFT, 0, 0, 0);
+                }
+                break;
+
+            case STEP_LI_DECAY:
+                g->step = STEP_SUMMONS;
+                if (rnd(g, 20) == 0)
+                {
+                    if (g->li > 0) { g->li++; }
+                    if (g->li == 4) { g->li = 0; }
+                }
+                break;
+
+            case STEP_SUMMONS:
+                g->step = STEP_GOOD_PRICES;
+                if ((g->port != 1) && (g->li == 0) && (rnd(g, 4) != 0))
+                {
+                    return event(ev, EV_LI_YUEN_SUMMONS, 0, 0, 0);
+                }
+                break;
+
+            case STEP_GOOD_PRICES:
+                g->step = STEP_ROBBERY;
+                if (rnd(g, 9) == 0)
+                {
+                    int j;
+
+                    i = rnd(g, 4);
+                    j = rnd(g, 2);
+                    if (j == 0)
+                    {
+                        g->price[i] = g->price[i] / 5;
+                        if (g->price[i] == 0)
+                        {
+                            /* Dropped twice without the month turning
+                             * (Li Yuen let us be); keep it buyable. */
+                            g->price[i] = 1;
+                        }
+                    } else {
+                        g->price[i] = g->price[i] * (rnd(g, 5) + 5);
+                    }
+
+                    return event(ev, EV_GOOD_PRICES, i, j, 0);
+                }
+                break;
+
+            case STEP_ROBBERY:
+                g->step = STEP_PORT;
+                if ((g->cash > 25000) && (rnd(g, 20) == 0))
+                {
+                    float robbed = ((g->cash / 1.4) * frand(g));
+
+                    g->cash -= robbed;
+                    return event(ev, EV_ROBBERY, 0, 0, robbed);
+                }
+                break;
+
+            case STEP_PORT:
+                return event(ev, EV_PORT, g->port, 0, 0);
+
+            case STEP_WHEEDLE:
+                g->step = STEP_WHEEDLE_CUTTHROATS;
+                return event(ev, EV_WU, 0, 0, 0);
+
+            case STEP_WHEEDLE_CUTTHROATS:
+                g->step = STEP_PORT;
+                if ((i = cutthroats(g)) > 0)
+                {
+                    return event(ev, EV_CUTTHROATS, i, 0, 0);
+                }
+                break;
+
+            case STEP_PIRATES:
+                g->step = STEP_LI_YUEN_PIRATES;
+                if (rnd(g, g->bp) == 0)
+                {
+                    int num_ships = rnd(g, (g->capacity / 10) + g->guns) + 1;
+
+                    num_ships = battle_begin(g, GENERIC, num_ships);
+                    return event(ev, EV_PIRATES, num_ships, GENERIC, 0);
+                }
+                break;
+
+            case STEP_BATTLE:
+                return battle_step(g, ev);
+
+            case STEP_LI_YUEN_PIRATES:
+                g->step = STEP_BATTLE_RESULT;
+                if (((g->result == BATTLE_NOT_FINISHED) &&
+                            (rnd(g, 4 + (8 * g->li))) == 0) ||
+                        (g->result == BATTLE_INTERRUPTED))
+                {
+                    if (g->li > 0)
+                    {
+                        /* They let us be, and quit() returned before the
+                         * month turned. */
+                        g->step = STEP_ARRIVE;
+                        return event(ev, EV_LI_YUEN_PIRATES, 0, LI_YUEN, 0);
+                    } else {
+                        int num_ships = rnd(g, (g->capacity / 5) + g->guns) + 5;
+
+                        num_ships = battle_begin(g, LI_YUEN, num_ships);
+                        return event(ev, EV_LI_YUEN_PIRATES, num_ships, LI_YUEN, 0);
+                    }
+                }
+                break;
+
+            case STEP_BATTLE_RESULT:
+                g->step = STEP_STORM;
+                if (g->result == BATTLE_WON)  // Victory!
+                {
+                    g->cash += g->booty;
+                    return event(ev, EV_BATTLE_RESULT, g->result, 0, g->booty);
+                } else if (g->result == BATTLE_FLED) {  // Ran and got away.
+                    return event(ev, EV_BATTLE_RESULT, g->result, 0, 0);
+                } else if (g->result == BATTLE_LOST) {  // Ship lost!
+                    g->over = GAME_SUNK;
+                    g->step = STEP_OVER;
+                    return event(ev, EV_BATTLE_RESULT, g->result, 0, 0);
+                }
+                break;
+
+            case STEP_STORM:
+                g->step = STEP_MONTH;
+                if (rnd(g, 10) == 0)
+                {
+                    g->step = STEP_GOING_DOWN;
+                    return event(ev, EV_STORM, 0, 0, 0);
+                }
+                break;
+
+            case STEP_GOING_DOWN:
+                g->step = STEP_STORM_SURVIVED;
+                if (rnd(g, 30) == 0)
+                {
+                    g->step = STEP_SINKING;
+                    return event(ev, EV_GOING_DOWN, 0, 0, 0);
+                }
+                break;
+
+            case STEP_SINKING:
+                g->step = STEP_STORM_SURVIVED;
+                if (((g->damage / g->capacity * 3) * frand(g)) >= 1)
+                {
+                    g->over = GAME_FOUNDERED;
+                    g->step = STEP_OVER;
+                }
+                break;
+
+            case STEP_STORM_SURVIVED:
+                g->step = STEP_BLOWN_OFF_COURSE;
+                return event(ev, EV_STORM_SURVIVED, 0, 0, 0);
+
+            case STEP_BLOWN_OFF_COURSE:
+                g->step = STEP_MONTH;
+                if (rnd(g, 3) == 0)
+                {
+                    int orig = g->port;
+
+                    while (g->port == orig)
+                    {
+                        g->port = rnd(g, 7) + 1;
+                    }
+
+                    return event(ev, EV_BLOWN_OFF_COURSE, g->port, 0, 0);
+                }
+                break;
+
+            case STEP_MONTH:
+                if (g->batch_months)
+                {
+                    g->step = STEP_MONTH_DUE;
+                    return event(ev, EV_MONTH_DUE, 0, 0, 0);
+                }
+                /* Fall through. */
+
+            case STEP_MONTH_DUE:
+                turn_month(g);
+                /* Fall through. */
+
+            case STEP_ARRIVING:
+                g->step = STEP_ARRIVE;
+                return event(ev, EV_ARRIVING, g->port, 0, 0);
+
+            case STEP_OVER:
+            default:
+                return event(ev, EV_GAME_OVER, g->over, 0, 0);
+        }
+    }
+}
+
+/* li_yuen_extortion(): pay what Li Yuen asks.  Returns ERR_AMOUNT if we
+ * don't have the cash, in which case game_li_yuen_wu() says whether Elder
+ * Brother Wu makes up the difference. */
+int game_li_yuen_pay(struct game_state *g)
+{
+    if (g->offer <= g->cash)
+    {
+        g->cash -= g->offer;
+        g->li = 1;
+        return 0;
+    }
+
+    return ERR_AMOUNT;
+}
+
+void game_li_yuen_wu(struct game_state *g, int yes)
+{
+    if (yes)
+    {
+        float amount = g->offer - g->cash;
+
+        g->debt += amount;
+        g->cash = 0;
+        g->li = 1;
+    } else {
+        g->cash = 0;
+    }
+}
+
+/* mchenry(): what a full repair costs.  Each later call takes an amount of
+ * -1 to mean that price. */
+long game_mchenry_quote(struct game_state *g)
+{
+    int time = game_months(g);
+
+    g->br = ((((60 * (time + 3) / 4) * frand(g)) +
+                25 * (time + 3) / 4) * g->capacity / 50);
+    g->diff = 0;  /* EJB */
+
+    return (g->br * g->damage) + 1;
+}
+
+static long repair_amount(const struct game_state *g, long amount)
+{
+    /* EJB 2015-04-20 See https://github.com/freebsd/freebsd-ports/blob/master/games/taipan/files/patch-taipan.c */
+    return (amount == -1) ? (g->br * g->damage) + 1 : amount;
+}
+
+/* Whether amount is more than our cash, so that Wu must be asked. */
+int game_mchenry_short(struct game_state *g, long amount)
+{
+    return repair_amount(g, amount) > g->cash;
+}
+
+void game_mchenry_wu(struct game_state *g, long amount, int yes)
+{
+    amount = repair_amount(g, amount);
+
+    if (yes)
+    {
+        g->diff = amount - g->cash;
+        g->debt += g->diff;
+        g->cash = 0;
+    } else {
+        g->cash = 0;
+    }
+}
+
+/* Returns ERR_AMOUNT if McHenry won't do it: he does not work for free. */
+int game_mchenry_pay(struct game_state *g, long amount)
+{
+    amount = repair_amount(g, amount);
+
+    if ((amount >= 0) && (amount <= g->cash + g->diff))
+    {
+        g->cash = g->cash - amount + g->diff;
+        if (g->br > 0)  /* EJB: Don't divide by zero */
+        {
+            g->damage -= (int)((amount / g->br) + 0.5);
+        }
+        g->damage = (g->damage < 0) ? 0 : g->damage;
+        return 0;
+    }
+
+    return ERR_AMOUNT;
+}
+
+/* Broke, with nothing to sell: Wu offers a bailout instead of business. */
+int game_wu_broke(const struct game_state *g)
+{
+    return ((int)g->cash == 0) && ((int)g->bank == 0) && (g->guns == 0) &&
+        (g->hold_[0] == 0) && (g->hkw_[0] == 0) &&
+        (g->hold_[1] == 0) && (g->hkw_[1] == 0) &&
+        (g->hold_[2] == 0) && (g->hkw_[2] == 0) &&
+        (g->hold_[3] == 0) && (g->hkw_[3] == 0);
+}
+
+/* Sets loan and repay. */
+void game_wu_bailout_offer(struct game_state *g)
+{
+    g->loan = rnd(g, 1500) + 500;
+    g->wu_bailout++;
+    g->repay = rnd(g, 2000) * g->wu_bailout + 1500;
+}
+
+void game_wu_bailout(struct game_state *g, int yes)
+{
+    if (yes)
+    {
+        g->cash += g->loan;
+        g->debt += g->repay;
+    } else {
+        g->over = GAME_BANKRUPT;
+        g->step = STEP_OVER;
+    }
+}
+
+int game_wu_can_repay(const struct game_state *g)
+{
+    return (g->cash > 0) && (g->debt != 0);
+}
+
+/* Returns WU_PAID_IN_FULL if we offered more than we owe. */
+int game_wu_repay(struct game_state *g, long amount)
+{
+    int paid = 0;
+
+    if (amount == -1)
+    {
+        /* Give Wu the *lesser* of your cash or your debt. */
+        amount = (g->cash <= g->debt) ? g->cash : g->debt;
+    }
+    if ((amount < 0) || (amount > g->cash))
+    {
+        return ERR_AMOUNT;
+    }
+
+    /* EJB: Don't allow overpayment */
+    if (amount > g->debt)
+    {
+        amount = g->debt;
+        paid = WU_PAID_IN_FULL;
+    }
+    g->cash -= amount;
+    g->debt -= amount;
+
+    return paid;
+}
+
+int game_wu_borrow(struct game_state *g, long amount)
+{
+    long most = g->cash * 2;
+
+    if (amount == -1)
+    {
+        amount = most;
+    }
+    if ((amount < 0) || (amount > most))
+    {
+        return ERR_AMOUNT;
+    }
+
+    g->cash += amount;
+    g->debt += amount;
+
+    return 0;
+}
+
+void game_buy_ship(struct game_state *g)
+{
+    g->cash -= g->offer;
+    g->hold += 50;
+    g->capacity += 50;
+    g->damage = 0;
+}
+
+void game_buy_gun(struct game_state *g)
+{
+    g->cash -= g->offer;
+    g->hold -= 10;
+    g->guns += 1;
+}
+
+long game_afford(const struct game_state *g, int item)
+{
+    return g->cash / g->price[item];
+}
+
+int game_buy(struct game_state *g, int item, long amount)
+{
+    long afford = game_afford(g, item);
+
+    if (amount == -1)
+    {
+        amount = afford;
+    }
+    if ((amount < 0) || (amount > afford))
+    {
+        return ERR_AMOUNT;
+    }
+
+    g->cash -= (amount * g->price[item]);
+    g->hold_[item] += amount;
+    g->hold -= amount;
+
+    return 0;
+}
+
+int game_sell(struct game_state *g, int item, long amount)
+{
+    if (amount == -1)
+    {
+        amount = g->hold_[item];
+    }
+    if ((amount < 0) || (amount > g->hold_[item]))
+    {
+        return ERR_AMOUNT;
+    }
+
+    g->hold_[item] -= amount;
+    g->cash += (amount * g->price[item]);
+    g->hold += amount;
+
+    return 0;
+}
+
+int game_deposit(struct game_state *g, long amount)
+{
+    if (amount == -1)
+    {
+        amount = g->cash;
+    }
+    if ((amount < 0) || (amount > g->cash))
+    {
+        return ERR_AMOUNT;
+    }
+
+    g->cash -= amount;
+    g->bank += amount;
+
+    return 0;
+}
+
+int game_withdraw(struct game_state *g, long amount)
+{
+    if (amount == -1)
+    {
+        amount = g->bank;
+    }
+    if ((amount < 0) || (amount > g->bank))
+    {
+        return ERR_AMOUNT;
+    }
+
+    g->cash += amount;
+    g->bank -= amount;
+
+    return 0;
+}
+
+int game_to_warehouse(struct game_state *g, int item, long amount)
+{
+    int in_use = game_in_use(g);
+
+    if (amount == -1)
+    {
+        amount = g->hold_[item];
+    }
+    if ((amount < 0) || (amount > g->hold_[item]))
+    {
+        return ERR_AMOUNT;
+    }
+    if ((in_use + amount) > 10000)
+    {
+        return (in_use == 10000) ? ERR_FULL : ERR_ROOM;
+    }
+
+    g->hold_[item] -= amount;
+    g->hkw_[item] += amount;
+    g->hold += amount;
+
+    return 0;
+}
+
+int game_to_ship(struct game_state *g, int item, long amount)
+{
+    if (amount == -1)
+    {
+        amount = g->hkw_[item];
+    }
+    if ((amount < 0) || (amount > g->hkw_[item]))
+    {
+        return ERR_AMOUNT;
+    }
+
+    g->hold_[item] += amount;
+    g->hkw_[item] -= amount;
+    g->hold -= amount;
+
+    return 0;
+}
+
+/* The port's 'W': see Wu again, then game_step() returns EV_WU. */
+int game_wheedle_wu(struct game_state *g)
+{
+    if ((g->step != STEP_PORT) || (g->port != 1))
+    {
+        return ERR_STATE;
+    }
+
+    g->step = STEP_WHEEDLE;
+
+    return 0;
+}
+
+int game_can_retire(const struct game_state *g)
+{
+    return (g->port == 1) && ((g->cash + g->bank) >= 1000000);
+}
+
+int game_retire(struct game_state *g)
+{
+    if ((g->step != STEP_PORT) || !game_can_retire(g))
+    {
+        return ERR_STATE;
+    }
+
+    g->over = GAME_RETIRED;
+    g->step = STEP_OVER;
+
+    return 0;
+}
+
+/* quit(): set sail for dest, 1 to 7. */
+int game_quit(struct game_state *g, int dest)
+{
+    if (g->step != STEP_PORT)
+    {
+        return ERR_STATE;
+    }
+    if (g->hold < 0)
+    {
+        return ERR_OVERLOAD;
+    }
+    if (dest == g->port)
+    {
+        return ERR_HERE;
+    }
+    if ((dest < 1) || (dest > 7))
+    {
+        return ERR_AMOUNT;
+    }
+
+    g->port   = dest;
+    g->result = BATTLE_NOT_FINISHED;
+    g->step   = STEP_PIRATES;
+
+    return 0;
+}
+
+/* Answers EV_BATTLE_ORDERS or EV_ORDERS_CHANGE. */
+void game_battle_orders(struct game_state *g, int orders)
+{
+    if ((orders >= ORDERS_FIGHT) && (orders <= ORDERS_THROW))
+    {
+        g->battle.orders = orders;
+    }
+}
+
+/* Answers EV_THROW_CARGO.  item 4 throws everything.  Returns 0 if there
+ * was nothing there to throw. */
+int game_battle_throw(struct game_state *g, int item, long amount)
+{
+    struct battle *b = &g->battle;
+    long total;
+
+    if (item < 4)
+    {
+        if ((g->hold_[item] > 0) && ((amount == -1) || (amount > g->hold_[item])))
+        {
+            amount = g->hold_[item];
+        }
+        total = g->hold_[item];
+    } else {
+        total = g->hold_[0] + g->hold_[1] + g->hold_[2] + g->hold_[3];
+    }
+
+    if (total <= 0)
+    {
+        return 0;
+    }
+
+    if (item < 4)
+    {
+        if (amount > 0)
+        {
+            g->hold_[item] -= amount;
+            g->hold += amount;
+            b->ok += (amount / 10);
+        }
+    } else {
+        g->hold_[0] = 0;
+        g->hold_[1] = 0;
+        g->hold_[2] = 0;
+        g->hold_[3] = 0;
+        g->hold += total;
+        b->ok += (total / 10);
+    }
+
+    return 1;
+}
+
+/* Sets a battle going wherever the game stands, for tools that study
+ * battles on their own.  game_battle_resolve() or game_step() fights it. */
+void game_battle_begin(struct game_state *g, int id, int num_ships)
+{
+    g->result = BATTLE_NOT_FINISHED;
+    battle_begin(g, id, num_ships);
+}
+
+/* Fights the whole battle at once, giving the same orders every round and
+ * throwing everything overboard when they are ORDERS_THROW.  Once the guns
+ * are all gone, ORDERS_FIGHT turns to running: a fleet too small to do us
+ * a whole point of damage would otherwise keep us there for ever.  The
+ * outcome is just what stepping through it with those answers would give;
+ * only the events are skipped.  Answers EV_PIRATES or EV_LI_YUEN_PIRATES,
+ * and returns BATTLE_* (or ERR_STATE if no battle is on). */
+int game_battle_resolve(struct game_state *g, int orders)
+{
+    struct game_event ev;
+
+    if (g->step != STEP_BATTLE)
+    {
+        return ERR_STATE;
+    }
+
+    do
+    {
+        switch (battle_step(g, &ev))
+        {
+            case EV_BATTLE_ORDERS:
+            case EV_ORDERS_CHANGE:
+                game_battle_orders(g, ((orders == ORDERS_FIGHT) &&
+                            (g->guns == 0)) ? ORDERS_RUN : orders);
+                break;
+
+            case EV_THROW_CARGO:
+                game_battle_throw(g, 4, -1);
+                break;
+        }
+    } while (ev.type != EV_BATTLE_OVER);
+
+    return ev.n;
+}
+
+/* ------------------------------------------------------------------------ *
+ * Turning the month for a batch of games at once.  Each figure turn_month()
+ * touches is copied out into a row of its own, so that the arithmetic and
+ * the xoshiro256** steps run straight along the rows, a game to a lane,
+ * and back again.  The sums are turn_month()'s, on the same types, so
+ * they come out the same to the bit.
+ * ------------------------------------------------------------------------ */
+
+void game_months_begin(struct month_batch *b)
+{
+    b->n = 0;
+}
+
+int game_months_add(struct month_batch *b, struct game_state *g)
+{
+    int i = b->n,
+        k;
+
+    if ((g->step != STEP_MONTH_DUE) || (i == MONTH_BATCH))
+    {
+        return ERR_STATE;
+    }
+
+    b->games[i] = g;
+    b->month[i] = g->month;
+    b->year[i]  = g->year;
+    b->port[i]  = g->port;
+    b->ec[i]    = g->ec;
+    b->ed[i]    = g->ed;
+    b->debt[i]  = g->debt;
+    b->bank[i]  = g->bank;
+    for (k = 0; k < 4; k++)
+    {
+        b->s[k][i] = g->rng.s[k];
+    }
+    b->n++;
+
+    return 0;
+}
+
+static uint64_t rotl(uint64_t x, int k)
+{
+    return (x << k) | (x >> (64 - k));
+}
+
+void game_months_turn(struct month_batch *b)
+{
+    uint64_t *s0 = b->s[0],
+             *s1 = b->s[1],
+             *s2 = b->s[2],
+             *s3 = b->s[3];
+    uint32_t threshold = -3u % 3u;
+    int      n = b->n,
+             i,
+             k;
+
+    for (i = 0; i < n; i++)
+    {
+        int roll = (++b->month[i] == 13);
+
+        b->month[i] = roll ? 1 : b->month[i];
+        b->year[i] += roll;
+        b->ec[i]   += roll ? 10 : 0;
+        b->ed[i]   += roll ? 0.5 : 0;
+        b->debt[i]  = b->debt[i] + (b->debt[i] * 0.1);
+        b->bank[i]  = b->bank[i] + (b->bank[i] * 0.005);
+        b->redraw[i] = 0;
+    }
+
+    /* set_prices(): rnd(3) for each good in turn, as rng_below() draws
+     * it.  Once in 2^32 draws rng_below() would throw one away and draw
+     * again; that game is turned on its own below instead. */
+    for (k = 0; k < 4; k++)
+    {
+        for (i = 0; i < n; i++)
+        {
+            uint64_t x = rotl(s1[i] * 5, 7) * 9,
+                     t = s1[i] << 17,
+                     m = (x >> 32) * 3;
+
+            s2[i] ^= s0[i];
+            s3[i] ^= s1[i];
+            s1[i] ^= s2[i];
+            s0[i] ^= s3[i];
+            s2[i] ^= t;
+            s3[i]  = rotl(s3[i], 45);
+
+            b->redraw[i] |= ((uint32_t) m < threshold);
+            b->price[k][i] = base_price[k][b->port[i]] / 2 *
+                ((int) (m >> 32) + 1) * base_price[k][0];
+        }
+    }
+
+    for (i = 0; i < n; i++)
+    {
+        struct game_state *g = b->games[i];
+
+        if (b->redraw[i])
+        {
+            turn_month(g);  /* Still as it was. */
+        } else {
+            g->month = b->month[i];
+            g->year  = b->year[i];
+            g->ec    = b->ec[i];
+            g->ed    = b->ed[i];
+            g->debt  = b->debt[i];
+            g->bank  = b->bank[i];
+            for (k = 0; k < 4; k++)
+            {
+                g->price[k]  = b->price[k][i];
+                g->rng.s[k] = b->s[k][i];
+            }
+        }
+        g->step = STEP_ARRIVING;
+    }
+    b->n = 0;
+}
@@ -0,0 +1,286 @@
+/* ------------------------------------------------------------------------ *
+ * Taipan game engine.
+ *
+ * All of the rules of the game, with no terminal I/O.  The whole game
+ * lives in one struct game_state, so any number of games can be played
+ * side by side, copied, or thrown away.
+ *
+ * The engine is driven by game_step(), which runs the game forward in
+ * the order main() and quit() always have, and stops at each thing that
+ * happens (an event) or needs deciding.  Decisions are made by calling
+ * the matching game_*() function before calling game_step() again; an
+ * unanswered question is taken as "no".
+ *
+ * Every random draw comes from the game's own stream.  Two games started
+ * with game_init(), game_seed() and the same answers play out the same.
+ * ------------------------------------------------------------------------ */
+
+#ifndef TAIPAN_ENGINE_H
+#define TAIPAN_ENGINE_H
+
+#include <stdint.h>
+#include <sys/types.h>
+
+#include "rng.h"
+
+#define GENERIC 1
+#define LI_YUEN 2
+
+#define BATTLE_NOT_FINISHED 0
+#define BATTLE_WON          1
+#define BATTLE_INTERRUPTED  2
+#define BATTLE_FLED         3
+#define BATTLE_LOST         4
+
+/* Why a game ended; see game_state.over. */
+#define GAME_RUNNING  0
+#define GAME_RETIRED  1  /* Retired a millionaire. */
+#define GAME_SUNK     2  /* Lost a sea battle. */
+#define GAME_FOUNDERED 3 /* Went down in a storm. */
+#define GAME_BANKRUPT 4  /* Refused Elder Brother Wu's bailout. */
+
+/* Battle orders. */
+#define ORDERS_NONE  0
+#define ORDERS_FIGHT 1
+#define ORDERS_RUN   2
+#define ORDERS_THROW 3
+
+/* Events returned by game_step(). */
+enum
+{
+    EV_NONE,
+
+    /* Arriving in port (the top of the old main loop). */
+    EV_IN_PORT,           /* Redraw the port. */
+    EV_LI_YUEN_DEMAND,    /* amount asked; game_li_yuen_pay() */
+    EV_MCHENRY,           /* game_mchenry_quote() etc. */
+    EV_WU_WARNING,        /* n braves sent. */
+    EV_WU,                /* game_wu_*() */
+    EV_CUTTHROATS,        /* n bodyguards killed, all cash lost. */
+    EV_NEW_SHIP,          /* amount asked; game_buy_ship() */
+    EV_NEW_GUN,           /* amount asked; game_buy_gun() */
+    EV_OPIUM_SEIZED,      /* amount fined. */
+    EV_WAREHOUSE_THEFT,
+    EV_LI_YUEN_SUMMONS,
+    EV_GOOD_PRICES,       /* n = item, m = 1 if the price rose. */
+    EV_ROBBERY,           /* amount robbed. */
+    EV_PORT,              /* Waiting for a port action; game_buy() etc. */
+
+    /* At sea (the old quit()). */
+    EV_PIRATES,           /* n hostile ships; a battle begins. */
+    EV_LI_YUEN_PIRATES,   /* n ships, or 0 if they let us be. */
+    EV_BATTLE_RESULT,     /* n = result, amount = booty if won. */
+    EV_STORM,
+    EV_GOING_DOWN,
+    EV_STORM_SURVIVED,
+    EV_BLOWN_OFF_COURSE,  /* n = new port. */
+    EV_MONTH_DUE,         /* Only with batch_months; game_months_add(). */
+    EV_ARRIVING,          /* n = port; the month has turned. */
+
+    /* In a sea battle (the old sea_battle()). */
+    EV_BATTLE_ROUND,      /* n = seaworthiness in percent. */
+    EV_SHIP_SPAWN,        /* n = screen slot. */
+    EV_BATTLE_ORDERS,     /* game_battle_orders() */
+    EV_VOLLEY,            /* We open fire. */
+    EV_NO_GUNS,
+    EV_SHOT,              /* n = slot, m = 1 if sunk (2 if slowly). */
+    EV_VOLLEY_END,        /* n = ships sunk. */
+    EV_RAN_AWAY,          /* n ships ran away. */
+    EV_SHIP_CLEAR,        /* n = screen slot. */
+    EV_ORDERS_CHANGE,     /* May call game_battle_orders(). */
+    EV_THROW_CARGO,       /* game_battle_throw() */
+    EV_ESCAPE,            /* n = 1 if we got away. */
+    EV_ESCAPED_SOME,      /* n ships lost. */
+    EV_ENEMY_FIRE,
+    EV_GUN_HIT,
+    EV_BATTLE_OVER,       /* n = BATTLE_* */
+
+    EV_GAME_OVER          /* n = GAME_* */
+};
+
+struct game_event
+{
+    int   type,
+          n,
+          m;
+    float amount;
+};
+
+/* The most ships a fleet can have, and how many of them are ever on
+ * screen (and in range) at once. */
+#define FLEET_MAX 9999
+#define ON_SCREEN 10
+
+struct battle
+{
+    int id,
+        num_ships,
+        s0,
+        orders,
+        ok,
+        ik,
+        sk,
+        shot,
+        hits,
+        num_on_screen,
+        live[ON_SCREEN], /* The slots with a ship in them, in no order. */
+        slot,
+        step,
+        next,
+        result;
+
+    /* Hit points of the whole enemy fleet.  hp[0] to hp[ON_SCREEN - 1] are
+     * the ships on screen, slot by slot (0 for an empty slot); the rest of
+     * the fleet waits behind them in hp[ON_SCREEN] up, and the next to come
+     * on screen is the last of those.  A short holds any ship before the
+     * year 4000 or so. */
+    int16_t hp[ON_SCREEN + FLEET_MAX];
+};
+
+struct game_state
+{
+    char  firm[23];
+
+    uint  cash,
+          bank,
+          debt,
+          booty;
+    float ec,  /* Base health of enemies; grows over time. */
+          ed;  /* Damage dealt by enemies; grows over time. */
+
+    long  price[4];
+
+    int   hkw_[4],
+          hold_[4];
+
+    int   hold,
+          capacity,
+          guns,
+          bp,
+          damage,
+          month,
+          year,
+          li,
+          port,
+          wu_warn,
+          wu_bailout;
+
+    int   over;  /* GAME_* once the game has ended. */
+
+    /* Stop with EV_MONTH_DUE before turning the month, so that a batch of
+     * games can have it turned together.  Unanswered, game_step() turns
+     * it as it always has. */
+    int   batch_months;
+
+    /* Where game_step() picks up, and what it is waiting on. */
+    int   step,
+          result;
+    float offer;      /* Li Yuen's demand, or the price of a ship or gun. */
+    long  br,         /* McHenry's rate, and what Wu made up for him. */
+          diff;
+    int   loan,       /* Elder Brother Wu's bailout terms. */
+          repay;
+
+    struct battle battle;
+
+    uint64_t   seed;  /* What game_seed() was given. */
+    struct rng rng;   /* Every random draw in this game comes from here. */
+};
+
+/* Errors returned by the port actions. */
+#define ERR_AMOUNT   -1  /* More than you have (or can afford). */
+#define ERR_FULL     -2  /* The warehouse is full. */
+#define ERR_ROOM     -3  /* The warehouse will not hold that much more. */
+#define ERR_HERE     -4  /* You're already here. */
+#define ERR_OVERLOAD -5  /* The ship is overloaded. */
+#define ERR_STATE    -6  /* Not now. */
+
+#define WU_PAID_IN_FULL 1
+
+/* Setting up. */
+void game_init(struct game_state *g);
+void game_seed(struct game_state *g, uint64_t seed);
+/* Copies from into to, such that to plays on exactly as from would.
+ * Only the live part of the fleet's hit points is copied, not the whole
+ * 20K struct. */
+void game_copy(struct game_state *to, const struct game_state *from);
+void game_start(struct game_state *g, int with_cash);
+void game_restart(struct game_state *g);
+void game_set_prices(struct game_state *g);
+int  game_step(struct game_state *g, struct game_event *ev);
+
+/* Useful sums. */
+long game_mean_price(int item, int port);
+int  game_months(const struct game_state *g);
+int  game_status(const struct game_state *g);
+int  game_in_use(const struct game_state *g);
+long long game_net_worth(const struct game_state *g);
+double game_worth(const struct game_state *g);  /* Cargo at the prices here. */
+long long game_score(const struct game_state *g);
+int  game_fleet_reserve(const struct game_state *g);
+long game_fleet_hp(const struct game_state *g);
+
+/* Answers to events on arriving in port. */
+int  game_li_yuen_pay(struct game_state *g);
+void game_li_yuen_wu(struct game_state *g, int yes);
+long game_mchenry_quote(struct game_state *g);
+int  game_mchenry_short(struct game_state *g, long amount);
+void game_mchenry_wu(struct game_state *g, long amount, int yes);
+int  game_mchenry_pay(struct game_state *g, long amount);
+int  game_wu_broke(const struct game_state *g);
+void game_wu_bailout_offer(struct game_state *g);
+void game_wu_bailout(struct game_state *g, int yes);
+int  game_wu_can_repay(const struct game_state *g);
+int  game_wu_repay(struct game_state *g, long amount);
+int  game_wu_borrow(struct game_state *g, long amount);
+void game_buy_ship(struct game_state *g);
+void game_buy_gun(struct game_state *g);
+
+/* Port actions, answering EV_PORT.  An amount of -1 means "all". */
+long game_afford(const struct game_state *g, int item);
+int  game_buy(struct game_state *g, int item, long amount);
+int  game_sell(struct game_state *g, int item, long amount);
+int  game_deposit(struct game_state *g, long amount);
+int  game_withdraw(struct game_state *g, long amount);
+int  game_to_warehouse(struct game_state *g, int item, long amount);
+int  game_to_ship(struct game_state *g, int item, long amount);
+int  game_wheedle_wu(struct game_state *g);
+int  game_can_retire(const struct game_state *g);
+int  game_retire(struct game_state *g);
+int  game_quit(struct game_state *g, int dest);
+
+/* Answers to events in a sea battle. */
+void game_battle_orders(struct game_state *g, int orders);
+int  game_battle_throw(struct game_state *g, int item, long amount);
+int  game_battle_resolve(struct game_state *g, int orders);
+void game_battle_begin(struct game_state *g, int id, int num_ships);
+
+/* Games waiting at EV_MONTH_DUE, laid out figure by figure so that
+ * game_months_turn() can turn them all at once. */
+#define MONTH_BATCH 64
+
+struct month_batch
+{
+    int               n;
+    struct game_state *games[MONTH_BATCH];
+    int               month[MONTH_BATCH],
+                      year[MONTH_BATCH],
+                      port[MONTH_BATCH],
+                      redraw[MONTH_BATCH];
+    float             ec[MONTH_BATCH],
+                      ed[MONTH_BATCH];
+    uint              debt[MONTH_BATCH],
+                      bank[MONTH_BATCH];
+    long              price[4][MONTH_BATCH];
+    uint64_t          s[4][MONTH_BATCH];  /* Each game's rng, word by word. */
+};
+
+/* Turning the month in a batch.  game_months_add() returns ERR_STATE if g
+ * is not at EV_MONTH_DUE or the batch is full.  game_months_turn() leaves
+ * every game in the batch just as game_step() would have, ready to return
+ * EV_ARRIVING, and empties the batch. */
+void game_months_begin(struct month_batch *b);
+int  game_months_add(struct month_batch *b, struct game_state *g);
+void game_months_turn(struct month_batch *b);
+
+#endif /* TAIPAN_ENGINE_H */
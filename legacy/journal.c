@@ -0,0 +1,138 @@
+/* ------------------------------------------------------------------------ *
+ * Game journals.  See journal.h.
+ * ------------------------------------------------------------------------ */
+
+#include <curses.h>
+#include <string.h>
+
+#include "journal.h"
+
+#define MAGIC  "TAIPANJ2"
+#define ESCAPE 255
+
+/* Returns 0, or -1 if the file would not open. */
+int journal_create(struct journal *j, const char *path, uint64_t seed,
+                   int quick)
+{
+    int i;
+
+    if ((j->fp = fopen(path, "wb")) == NULL)
+    {
+        return -1;
+    }
+
+    fwrite(MAGIC, 8, 1, j->fp);
+    for (i = 0; i < 8; i++)
+    {
+        putc((seed >> (8 * i)) & 0xff, j->fp);
+    }
+    putc(quick != 0, j->fp);
+    fflush(j->fp);
+
+    return 0;
+}
+
+/* Returns 0, or -1 if the file is missing or not a journal. */
+int journal_open(struct journal *j, const char *path, uint64_t *seed,
+                 int *quick)
+{
+    unsigned char head[17];
+    int           i;
+
+    if ((j->fp = fopen(path, "rb")) == NULL)
+    {
+        return -1;
+    }
+    if ((fread(head, sizeof(head), 1, j->fp) != 1) ||
+            (memcmp(head, MAGIC, 8) != 0))
+    {
+        fclose(j->fp);
+        j->fp = NULL;
+        return -1;
+    }
+
+    *seed = 0;
+    for (i = 7; i >= 0; i--)
+    {
+        *seed = (*seed << 8) | head[8 + i];
+    }
+    *quick = head[16];
+
+    return 0;
+}
+
+void journal_close(struct journal *j)
+{
+    if (j->fp != NULL)
+    {
+        fclose(j->fp);
+        j->fp = NULL;
+    }
+}
+
+void journal_write(struct journal *j, int key)
+{
+    int i;
+
+    if ((key >= 0) && (key < ESCAPE))
+    {
+        putc(key, j->fp);
+    } else if (key == ERR) {
+        putc(ESCAPE, j->fp);
+        putc(0, j->fp);
+    } else if (key == ESCAPE) {
+        putc(ESCAPE, j->fp);
+        putc(1, j->fp);
+    } else {
+        putc(ESCAPE, j->fp);
+        putc(2, j->fp);
+        for (i = 0; i < 4; i++)
+        {
+            putc(((unsigned) key >> (8 * i)) & 0xff, j->fp);
+        }
+    }
+
+    /* A game that crashes should still leave its journal behind. */
+    fflush(j->fp);
+}
+
+int journal_read(struct journal *j, int *key)
+{
+    int c,
+        i;
+
+    if ((c = getc(j->fp)) == EOF)
+    {
+        return 0;
+    }
+    if (c != ESCAPE)
+    {
+        *key = c;
+        return 1;
+    }
+
+    switch (getc(j->fp))
+    {
+        case 0:
+            *key = ERR;
+            return 1;
+
+        case 1:
+            *key = ESCAPE;
+            return 1;
+
+        case 2:
+            *key = 0;
+            for (i = 0; i < 4; i++)
+            {
+                if ((c = getc(j->fp)) == EOF)
+                {
+                    return 0;
+                }
+                *key |= c << (8 * i);
+            }
+            return 1;
+    }
+
+    return 0;
+}
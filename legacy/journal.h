@@ -0,0 +1,34 @@
+/* ------------------------------------------------------------------------ *
+ * Game journals: the seed of a game and every key it read, so that the
+ * game can be played again exactly (taipan -r), as fast as it will go.
+ *
+ * The file is the magic "TAIPANJ2", the seed (8 bytes, least significant
+ * first), the mode (1 if sea battles were settled at once with -q, which
+ * reads its keys differently, else 0), then one byte per key.  Byte 255
+ * starts a two-byte code: 255 0 is a wait that ran out with no key (ERR),
+ * 255 1 is a real 255, and 255 2 is followed by a key code above 255 in 4
+ * bytes.
+ * ------------------------------------------------------------------------ */
+
+#ifndef TAIPAN_JOURNAL_H
+#define TAIPAN_JOURNAL_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+struct journal
+{
+    FILE *fp;
+};
+
+int  journal_create(struct journal *j, const char *path, uint64_t seed,
+                    int quick);
+int  journal_open(struct journal *j, const char *path, uint64_t *seed,
+                  int *quick);
+void journal_close(struct journal *j);
+
+void journal_write(struct journal *j, int key);
+/* The next key, or 0 at the end of the journal. */
+int  journal_read(struct journal *j, int *key);
+
+#endif /* TAIPAN_JOURNAL_H */
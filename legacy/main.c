@@ -0,0 +1,94 @@
+/* ------------------------------------------------------------------------ *
+ * Taipan on the player's own terminal.
+ * ------------------------------------------------------------------------ */
+
+#include <curses.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "taipan.h"
+
+static void usage(void)
+{
+    fprintf(stderr, "usage: taipan [-q] [-s seed] [-j journal | -r journal]\n");
+    exit(1);
+}
+
+int main(int argc, char *argv[])
+{
+    uint64_t seed = getpid();
+    char     *end,
+             *record = NULL,
+             *play = NULL;
+    int      c;
+
+    while ((c = getopt(argc, argv, "qs:j:r:")) != -1)
+    {
+        switch (c)
+        {
+            case 'j':
+                record = optarg;
+                break;
+
+            case 'r':
+                play = optarg;
+                break;
+
+            case 'q':
+                quick = 1;
+                break;
+
+            case 's':
+                seed = strtoull(optarg, &end, 0);
+                if ((*optarg == '\0') || (*end != '\0'))
+                {
+                    usage();
+                }
+                break;
+
+            default:
+                usage();
+        }
+    }
+    if ((optind != argc) || (record && play))
+    {
+        usage();
+    }
+
+    if (play != NULL)
+    {
+        /* The journal's own mode, whatever -q says. */
+        if (journal_open(&journal, play, &seed, &quick) == -1)
+        {
+            fprintf(stderr, "taipan: %s is not a journal\n", play);
+            exit(1);
+        }
+        replay = 1;
+    } else if ((record != NULL) &&
+            (journal_create(&journal, record, seed, quick) == -1)) {
+        perror(record);
+        exit(1);
+    }
+
+    initscr();
+    cbreak();
+    noecho();
+    curs_set(0);  // EJB: Set cursor to invisible - EJB: this is not working (and I would only want this done during battle anyway, not on user prompts.)
+
+    game_init(g);
+    game_seed(g, seed);
+    taipan();
+
+    if (replay)
+    {
+        replay_over();
+    }
+
+    clear();
+    refresh();
+    nocbreak();
+    endwin();
+
+    return EXIT_SUCCESS;
+}
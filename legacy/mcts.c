@@ -0,0 +1,506 @@
+/* ------------------------------------------------------------------------ *
+ * The Monte Carlo tree search player.  See mcts.h.
+ * ------------------------------------------------------------------------ */
+
+#include <math.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "mcts.h"
+#include "policy.h"
+#include "pool.h"
+
+/* How far UCB1 strays from the best move so far, with values scaled to
+ * [0, 1] by the least and most a tree has seen. */
+#define EXPLORE 0.7
+
+struct node
+{
+    struct mcts_move move;
+    int              child,      /* The first of its children, or -1. */
+                     children;
+    long             visits;
+    double           total;      /* Of the values of its playouts. */
+};
+
+/* One thread's tree, and what it has cost. */
+struct tree
+{
+    struct mcts *m;
+    struct node *nodes;
+    long        used;
+    int         *path;       /* horizon + 1 nodes, root first. */
+    double      lo,
+                hi;          /* The least and most a playout has made. */
+    struct rng  rng;         /* For reseeding the copies. */
+
+    long long   playouts,
+                voyages;
+    double      seconds;
+};
+
+struct mcts
+{
+    int                     threads,
+                            horizon;
+    long                    nodes;
+    struct tree             *trees;
+    const struct policy     *greedy;
+
+    /* The search under way. */
+    const struct game_state *root;
+    double                  deadline;
+    atomic_int              stop;
+};
+
+static double now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+void mcts_apply(struct game_state *g, const struct mcts_move *move)
+{
+    int  hk = (g->port == 1),
+         err,
+         i;
+    long amount;
+
+    if (move->sell)
+    {
+        for (i = 0; i < 4; i++)
+        {
+            if (g->hold_[i] > 0)
+            {
+                game_sell(g, i, -1);
+            }
+        }
+    }
+
+    if (hk && (move->finance == MCTS_REPAY))
+    {
+        if (g->bank > 0)
+        {
+            game_withdraw(g, -1);
+        }
+        if (game_wu_can_repay(g))
+        {
+            game_wu_repay(g, -1);
+        }
+    } else if (hk && (move->finance == MCTS_BORROW)) {
+        game_wu_borrow(g, -1);
+    }
+
+    if ((move->buy >= 0) && (g->hold > 0))
+    {
+        amount = game_afford(g, move->buy);
+        if (move->half)
+        {
+            amount /= 2;
+        }
+        if (amount > g->hold)
+        {
+            amount = g->hold;
+        }
+        if (amount > 0)
+        {
+            game_buy(g, move->buy, amount);
+        }
+    }
+
+    if (hk && ((move->finance == MCTS_BANK) ||
+               (move->finance == MCTS_REPAY)) && (g->cash > 0))
+    {
+        game_deposit(g, -1);
+    }
+
+    if ((move->dest == 0) && (game_retire(g) == 0))
+    {
+        return;
+    }
+    if ((err = game_quit(g, move->dest)) == ERR_OVERLOAD)
+    {
+        for (i = 0; i < 4; i++)
+        {
+            game_sell(g, i, -1);
+        }
+        err = game_quit(g, move->dest);
+    }
+    if (err != 0)
+    {
+        game_quit(g, (g->port % 7) + 1);
+    }
+}
+
+int mcts_moves(const struct game_state *g, struct mcts_move *moves)
+{
+    struct mcts_move m;
+    int              n = 0,
+                     loaded = 0,
+                     finances,
+                     k;
+
+    for (k = 0; k < 4; k++)
+    {
+        loaded |= (g->hold_[k] > 0);
+    }
+
+    if (game_can_retire(g))
+    {
+        m.sell    = 1;
+        m.finance = MCTS_KEEP;
+        m.buy     = -1;
+        m.half    = 0;
+        m.dest    = 0;
+        moves[n++] = m;
+    }
+
+    finances = (g->port == 1) ? 4 : 1;
+    for (m.sell = 1; m.sell >= !loaded; m.sell--)
+    {
+        for (m.finance = 0; m.finance < finances; m.finance++)
+        {
+            if (((m.finance == MCTS_REPAY) && (g->debt == 0)) ||
+                    ((m.finance == MCTS_BORROW) && (g->debt > 0)))
+            {
+                continue;  /* Nothing to pay; or more on a debt that grows
+                            * by a tenth a month. */
+            }
+            for (k = -1; k < 8; k++)
+            {
+                m.buy  = (k < 0) ? -1 : (k / 2);
+                m.half = (k >= 0) && (k % 2);
+                for (m.dest = 1; m.dest <= 7; m.dest++)
+                {
+                    if (m.dest != g->port)
+                    {
+                        moves[n++] = m;
+                    }
+                }
+            }
+        }
+    }
+
+    return n;
+}
+
+/* The moves the tree tries in g: fewer than mcts_moves(), so that each
+ * is tried often enough in the time to tell them apart.  The cargo is
+ * kept only to sail on with, not added to; what is bought is bought with
+ * all the cash; and Wu's money is never borrowed, since the greedy
+ * playouts repay him at once and make it look free.  In the same order
+ * for the same game, as mcts_moves() is. */
+static int tree_moves(const struct game_state *g, struct mcts_move *moves)
+{
+    struct mcts_move m;
+    int              n = 0,
+                     loaded = 0,
+                     finances,
+                     k;
+
+    for (k = 0; k < 4; k++)
+    {
+        loaded |= (g->hold_[k] > 0);
+    }
+
+    if (game_can_retire(g))
+    {
+        m.sell    = 1;
+        m.finance = MCTS_KEEP;
+        m.buy     = -1;
+        m.half    = 0;
+        m.dest    = 0;
+        moves[n++] = m;
+    }
+
+    m.half   = 0;
+    finances = (g->port != 1) ? 1 : (g->debt > 0) ? 3 : 2;
+    for (m.sell = 1; m.sell >= !loaded; m.sell--)
+    {
+        for (m.finance = 0; m.finance < finances; m.finance++)
+        {
+            for (m.buy = -1; m.buy < (m.sell ? 4 : 0); m.buy++)
+            {
+                for (m.dest = 1; m.dest <= 7; m.dest++)
+                {
+                    if (m.dest != g->port)
+                    {
+                        moves[n++] = m;
+                    }
+                }
+            }
+        }
+    }
+
+    return n;
+}
+
+/* Gives n's children the moves the tree tries in g; 0 if the tree is
+ * full. */
+static int expand(struct tree *t, struct node *n, const struct game_state *g)
+{
+    struct mcts_move list[MCTS_MOVES];
+    int              count = tree_moves(g, list),
+                     i;
+
+    if (t->used + count > t->m->nodes)
+    {
+        return 0;
+    }
+
+    n->child    = t->used;
+    n->children = count;
+    for (i = 0; i < count; i++)
+    {
+        struct node *c = &t->nodes[t->used++];
+
+        c->move     = list[i];
+        c->child    = -1;
+        c->children = 0;
+        c->visits   = 0;
+        c->total    = 0;
+    }
+
+    return 1;
+}
+
+/* UCB1 among n's children; the first untried one first. */
+static int choose(const struct tree *t, const struct node *n)
+{
+    double log_n = log((double) n->visits),
+           range = (t->hi > t->lo) ? t->hi - t->lo : 1,
+           best = -1,
+           ucb;
+    int    pick = n->child,
+           i;
+
+    for (i = n->child; i < n->child + n->children; i++)
+    {
+        const struct node *c = &t->nodes[i];
+
+        if (c->visits == 0)
+        {
+            return i;
+        }
+        ucb = ((c->total / c->visits) - t->lo) / range +
+            EXPLORE * sqrt(log_n / c->visits);
+        if (ucb > best)
+        {
+            best = ucb;
+            pick = i;
+        }
+    }
+
+    return pick;
+}
+
+/* One playout: down the tree, a node added, greedy to the horizon, and
+ * the value back up the way it came. */
+static void playout(struct tree *t)
+{
+    struct mcts       *m = t->m;
+    struct game_state g;
+    struct game_event ev;
+    struct player     p;
+    int               node = 0,
+                      depth = 0,
+                      in_tree = 1,
+                      ports;
+    double            value;
+
+    game_copy(&g, m->root);
+    game_seed(&g, rng_next(&t->rng));
+    player_init(&p, m->greedy, rng_next(&t->rng));
+
+    ev.type = EV_PORT;
+    for (ports = 0; ports < m->horizon; ports++)
+    {
+        struct node *n = &t->nodes[node];
+
+        if (in_tree && (n->child < 0) && !expand(t, n, &g))
+        {
+            in_tree = 0;
+        }
+        if (in_tree)
+        {
+            node = choose(t, n);
+            t->path[++depth] = node;
+            in_tree = (t->nodes[node].visits > 0);
+            mcts_apply(&g, &t->nodes[node].move);
+        } else {
+            player_answer(&p, &g, &ev);
+        }
+
+        while ((game_step(&g, &ev) != EV_PORT) && (ev.type != EV_GAME_OVER))
+        {
+            t->voyages += (ev.type == EV_ARRIVING);
+            player_answer(&p, &g, &ev);
+        }
+        if (ev.type == EV_GAME_OVER)
+        {
+            break;
+        }
+    }
+
+    value = (double) game_net_worth(&g) / game_months(&g);
+    t->lo = (value < t->lo) ? value : t->lo;
+    t->hi = (value > t->hi) ? value : t->hi;
+    for (; depth >= 0; depth--)
+    {
+        t->nodes[t->path[depth]].visits++;
+        t->nodes[t->path[depth]].total += value;
+    }
+    t->playouts++;
+}
+
+/* Grows tree i from the root until the time is up. */
+static void grow(long i, void *arg)
+{
+    struct mcts     *m = arg;
+    struct tree     *t = &m->trees[i];
+    struct node     *root = &t->nodes[0];
+    struct timespec cpu[2];
+
+    t->used       = 1;
+    root->child   = -1;
+    root->visits  = 0;
+    root->total   = 0;
+    t->path[0]    = 0;
+    t->lo         = HUGE_VAL;
+    t->hi         = -HUGE_VAL;
+    expand(t, root, m->root);
+
+    /* Counted in the thread's own CPU time, so that threads sharing a
+     * core do not count it twice. */
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &cpu[0]);
+    while (!atomic_load_explicit(&m->stop, memory_order_relaxed))
+    {
+        playout(t);
+        if (now() >= m->deadline)
+        {
+            atomic_store_explicit(&m->stop, 1, memory_order_relaxed);
+        }
+    }
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &cpu[1]);
+    t->seconds += (cpu[1].tv_sec - cpu[0].tv_sec) +
+        (cpu[1].tv_nsec - cpu[0].tv_nsec) / 1e9;
+}
+
+struct mcts *mcts_new(int threads, long nodes, int horizon)
+{
+    struct mcts *m = calloc(1, sizeof(*m));
+    int         i;
+
+    if (m == NULL)
+    {
+        return NULL;
+    }
+    m->threads = (threads > 0) ? threads : pool_cpus();
+    m->nodes   = (nodes > MCTS_MOVES) ? nodes : MCTS_MOVES + 1;
+    m->horizon = (horizon > 0) ? horizon : 1;
+    m->greedy  = policy_find("greedy");
+    m->trees   = calloc(m->threads, sizeof(*m->trees));
+    if (m->trees == NULL)
+    {
+        free(m);
+        return NULL;
+    }
+    for (i = 0; i < m->threads; i++)
+    {
+        struct tree *t = &m->trees[i];
+
+        t->m     = m;
+        t->nodes = malloc(m->nodes * sizeof(*t->nodes));
+        t->path  = malloc((m->horizon + 1) * sizeof(*t->path));
+        rng_seed(&t->rng, 0x6d637473 + i);
+        if ((t->nodes == NULL) || (t->path == NULL))
+        {
+            mcts_free(m);
+            return NULL;
+        }
+    }
+
+    return m;
+}
+
+void mcts_free(struct mcts *m)
+{
+    int i;
+
+    if (m != NULL)
+    {
+        for (i = 0; i < m->threads; i++)
+        {
+            free(m->trees[i].nodes);
+            free(m->trees[i].path);
+        }
+        free(m->trees);
+        free(m);
+    }
+}
+
+int mcts_port(struct mcts *m, const struct game_state *g, long usec,
+              struct mcts_move *move)
+{
+    long   best_visits = -1,
+           visits;
+    double best_total = 0,
+           total;
+    int    children,
+           i,
+           k;
+
+    m->root     = g;
+    m->deadline = now() + usec / 1e6;
+    atomic_store(&m->stop, 0);
+    if (m->threads == 1)
+    {
+        grow(0, m);
+    } else if (pool_run(m->threads, m->threads, grow, m) != 0) {
+        return -1;
+    }
+
+    /* Every tree has the same moves at the root (see tree_moves()). */
+    children = m->trees[0].nodes[0].children;
+    for (k = 0; k < children; k++)
+    {
+        visits = 0;
+        total  = 0;
+        for (i = 0; i < m->threads; i++)
+        {
+            const struct node *c = &m->trees[i].nodes[1 + k];
+
+            visits += c->visits;
+            total  += c->total;
+        }
+        if ((visits > best_visits) ||
+                ((visits == best_visits) && (total > best_total)))
+        {
+            best_visits = visits;
+            best_total  = total;
+            *move = m->trees[0].nodes[1 + k].move;
+        }
+    }
+
+    return 0;
+}
+
+void mcts_counts(const struct mcts *m, long long *playouts,
+                 long long *voyages, double *seconds)
+{
+    int i;
+
+    *playouts = 0;
+    *voyages  = 0;
+    *seconds  = 0;
+    for (i = 0; i < m->threads; i++)
+    {
+        *playouts += m->trees[i].playouts;
+        *voyages  += m->trees[i].voyages;
+        *seconds  += m->trees[i].seconds;
+    }
+}
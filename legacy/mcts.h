@@ -0,0 +1,83 @@
+/* ------------------------------------------------------------------------ *
+ * A Monte Carlo tree search player.
+ *
+ * At each port the player plays the game on from where it stands many
+ * times over, in the engine itself: a copy of the game is reseeded (so
+ * nothing is learned of the real dice), the moves in the tree are made at
+ * the ports it comes to, and from where the tree ends the greedy policy
+ * (policy.c) plays out the rest of the horizon.  A line is worth the
+ * firm's net worth over months where it stops, as final_stats() reckons
+ * it.  Moves are chosen down the tree by UCB1, and the tree grows a node
+ * a playout.  Between ports, the tree and the playouts alike answer as
+ * greedy does.  The tree tries only some of the moves mcts_moves() gives:
+ * none that borrow, and none that buy with half the cash or add to the
+ * cargo kept aboard.
+ *
+ * The tree is open-loop: a node stands for the moves that led to it, not
+ * for any one state, and a move that will not do where a playout finds
+ * itself is made as near as it can be (see mcts_apply()).
+ *
+ * Each thread grows a tree of its own from the same root; when the time is
+ * up their counts at the root are added together and the most tried move
+ * is made.
+ * ------------------------------------------------------------------------ */
+
+#ifndef TAIPAN_MCTS_H
+#define TAIPAN_MCTS_H
+
+#include "engine.h"
+
+/* Ports played out past the root, tree and playout together. */
+#define MCTS_HORIZON 24
+
+/* In Hong Kong, what to do about money. */
+#define MCTS_KEEP   0  /* Nothing. */
+#define MCTS_BANK   1  /* Bank what is left once the buying is done. */
+#define MCTS_REPAY  2  /* Draw everything out, pay Wu what we can, and
+                        * bank what is left. */
+#define MCTS_BORROW 3  /* Borrow all Wu will lend, before buying. */
+
+/* A move at a port, made in this order. */
+struct mcts_move
+{
+    int sell,     /* 1 to sell all the cargo aboard. */
+        finance,  /* MCTS_*; only in Hong Kong. */
+        buy,      /* A good (0 to 3) to put money into, or -1. */
+        half,     /* 1 to spend half the cash on it, not all. */
+        dest;     /* The port to sail for, 1 to 7, or 0 to retire. */
+};
+
+/* The most moves there can be at a port: keep or sell the cargo, four
+ * ways with money in Hong Kong, nothing or all or half into each good,
+ * and six ports; and retiring. */
+#define MCTS_MOVES ((2 * 4 * 9 * 6) + 1)
+
+struct mcts;
+
+/* A player that searches on threads threads (0 for one per CPU), each with
+ * a tree of up to nodes nodes, playing horizon ports ahead.  NULL if we
+ * are out of memory. */
+struct mcts *mcts_new(int threads, long nodes, int horizon);
+void        mcts_free(struct mcts *m);
+
+/* Chooses g's move at EV_PORT, searching for usec microseconds; every
+ * thread finishes the playout it is in, and stops.  Returns 0, or -1 if
+ * the threads could not be had. */
+int mcts_port(struct mcts *m, const struct game_state *g, long usec,
+              struct mcts_move *move);
+
+/* What the searches so far have cost: playouts, and voyages sailed in
+ * them (in the tree and out), over how many seconds of CPU time. */
+void mcts_counts(const struct mcts *m, long long *playouts,
+                 long long *voyages, double *seconds);
+
+/* The moves there are in g, waiting at EV_PORT, into moves[]; returns how
+ * many, in the same order for the same game. */
+int mcts_moves(const struct game_state *g, struct mcts_move *moves);
+
+/* Makes move in g, waiting at EV_PORT, and sails.  Cargo that will not
+ * sell, money that cannot be had and ports that will not do are passed
+ * over; a port that cannot be sailed for is swapped for the next. */
+void mcts_apply(struct game_state *g, const struct mcts_move *move);
+
+#endif /* TAIPAN_MCTS_H */
@@ -0,0 +1,170 @@
+/* ------------------------------------------------------------------------ *
+ * taipan-mcts: play games of Taipan with the Monte Carlo tree search
+ * player (mcts.h), and report how they went and how fast the engine ran
+ * the playouts.
+ *
+ * The games are played one after another, each move searched on every
+ * thread for the time given it.  Game i is seeded with seed + i, but how
+ * far a search gets in its time varies from run to run, and so do the
+ * games.  Between ports the player answers as greedy does.
+ * ------------------------------------------------------------------------ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "engine.h"
+#include "mcts.h"
+#include "policy.h"
+#include "tool.h"
+
+void usage(void)
+{
+    fprintf(stderr,
+            "usage: taipan-mcts [-v] [-n games] [-s seed] [-j threads] [-m months]\n"
+            "                   [-t ms] [-H ports]\n");
+    exit(1);
+}
+
+int main(int argc, char *argv[])
+{
+    struct mcts       *m;
+    struct game_state g;
+    struct game_event ev;
+    struct player     p;
+    struct mcts_move  move;
+    uint64_t          seed = 1;
+    long              games = 10,
+                      ms = 100,
+                      moves = 0,
+                      i;
+    int               threads = 0,
+                      horizon = MCTS_HORIZON,
+                      max_months = 1200,
+                      verbose = 0,
+                      count[5] = { 0 },
+                      cause,
+                      c;
+    long long         score = 0,
+                      playouts,
+                      voyages;
+    double            elapsed,
+                      busy;
+
+    while ((c = getopt(argc, argv, "vn:s:j:m:t:H:")) != -1)
+    {
+        switch (c)
+        {
+            case 'v':
+                verbose = 1;
+                break;
+
+            case 'n':
+                games = number(optarg);
+                break;
+
+            case 's':
+                seed = number(optarg);
+                break;
+
+            case 'j':
+                threads = number(optarg);
+                break;
+
+            case 'm':
+                max_months = number(optarg);
+                break;
+
+            case 't':
+                ms = number(optarg);
+                break;
+
+            case 'H':
+                horizon = number(optarg);
+                break;
+
+            default:
+                usage();
+        }
+    }
+    if ((optind != argc) || (games < 1) || (max_months < 1) || (horizon < 1))
+    {
+        usage();
+    }
+
+    if ((m = mcts_new(threads, 1L << 18, horizon)) == NULL)
+    {
+        fprintf(stderr, "taipan-mcts: out of memory\n");
+        return 1;
+    }
+
+    if (verbose)
+    {
+        printf("%10s %12s %14s %7s  %s\n",
+               "seed", "score", "net worth", "months", "end");
+    }
+    elapsed = seconds();
+    for (i = 0; i < games; i++)
+    {
+        game_init(&g);
+        game_seed(&g, seed + i);
+        player_init(&p, policy_find("greedy"), ~(seed + i));
+        player_start(&p, &g);
+
+        cause = 0;  /* Cut off. */
+        for (;;)
+        {
+            if (game_step(&g, &ev) == EV_GAME_OVER)
+            {
+                cause = ev.n;
+                break;
+            }
+            if ((ev.type == EV_ARRIVING) && (game_months(&g) >= max_months))
+            {
+                break;
+            }
+            if (ev.type != EV_PORT)
+            {
+                player_answer(&p, &g, &ev);
+            } else if (mcts_port(m, &g, ms * 1000, &move) != 0) {
+                fprintf(stderr, "taipan-mcts: out of memory\n");
+                return 1;
+            } else {
+                mcts_apply(&g, &move);
+                moves++;
+            }
+        }
+
+        if (verbose)
+        {
+            printf("%10llu %12lld %14lld %7d  %s\n",
+                   (unsigned long long) (seed + i), game_score(&g),
+                   game_net_worth(&g), game_months(&g), causes[cause]);
+            fflush(stdout);
+        }
+        score += game_score(&g);
+        count[cause]++;
+    }
+    elapsed = seconds() - elapsed;
+    mcts_counts(m, &playouts, &voyages, &busy);
+
+    printf("%ld games from seed %llu, %ld ms a move, %d ports ahead\n\n",
+           games, (unsigned long long) seed, ms, horizon);
+    printf("mean score %.1f\n", (double) score / games);
+    for (c = 1; c <= 5; c++)
+    {
+        int k = c % 5;  /* The cut-off games last. */
+
+        printf("%-10s %8d  %5.1f%%\n", causes[k], count[k],
+               100.0 * count[k] / games);
+    }
+    printf("\n%ld moves in %.3f s; %lld playouts, %.0f a move\n", moves,
+           elapsed, playouts, (moves > 0) ? (double) playouts / moves : 0);
+    printf("%lld voyages in %.3f s of CPU: %.0f a second a core\n",
+           voyages, busy, (busy > 0) ? voyages / busy : 0);
+
+    mcts_free(m);
+
+    return 0;
+}
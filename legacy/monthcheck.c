@@ -0,0 +1,294 @@
+/* ------------------------------------------------------------------------ *
+ * month-check: turn a great many months both ways, game_months_turn()'s
+ * rows and game_step()'s turn_month(), and check they come out the same
+ * to the bit.
+ *
+ * Games are played by the greedy trader, 64 at a time, up to the month
+ * they are due; then each is copied, the copy's month turned on its own
+ * and the batch's together, and every figure a month touches compared.
+ * Now and then a game's debt, bank and years are thrown about first, out
+ * to where uint and float arithmetic run out, as no trader would take
+ * them.  Then two venvs, one turning its months in batches and one not,
+ * are stepped side by side on the same random actions, and must not
+ * differ in a game or an observation.  "make check" runs it.
+ * ------------------------------------------------------------------------ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "engine.h"
+#include "policy.h"
+#include "rng.h"
+#include "tool.h"
+#include "venv.h"
+
+#define MAX_MONTHS 1200
+#define VENV_GAMES 256
+
+static struct rng dice;
+static long long  months,  /* Turned both ways and compared. */
+                  thrown,  /* Of those, thrown about first. */
+                  steps;   /* venv games stepped side by side. */
+
+void usage(void)
+{
+    fprintf(stderr, "usage: month-check [-n batches] [-v steps] "
+            "[-s seed]\n");
+    exit(1);
+}
+
+static int same(const void *a, const void *b, size_t len)
+{
+    return memcmp(a, b, len) == 0;
+}
+
+/* Checks g, turned in a batch, against h, turned on its own. */
+static void compare(const struct game_state *g, const struct game_state *h)
+{
+    if (same(&g->month, &h->month, sizeof(g->month)) &&
+            same(&g->year, &h->year, sizeof(g->year)) &&
+            same(&g->ec, &h->ec, sizeof(g->ec)) &&
+            same(&g->ed, &h->ed, sizeof(g->ed)) &&
+            same(&g->debt, &h->debt, sizeof(g->debt)) &&
+            same(&g->bank, &h->bank, sizeof(g->bank)) &&
+            same(g->price, h->price, sizeof(g->price)) &&
+            same(&g->rng, &h->rng, sizeof(g->rng)) &&
+            (g->step == h->step))
+    {
+        return;
+    }
+
+    fprintf(stderr, "month-check: game %llu, month %d of year %d, turned "
+            "apart\n", (unsigned long long) g->seed, h->month, h->year);
+    fprintf(stderr, "  batch:  debt %u bank %u ec %a ed %a prices %ld %ld "
+            "%ld %ld\n", g->debt, g->bank, g->ec, g->ed, g->price[0],
+            g->price[1], g->price[2], g->price[3]);
+    fprintf(stderr, "  alone:  debt %u bank %u ec %a ed %a prices %ld %ld "
+            "%ld %ld\n", h->debt, h->bank, h->ec, h->ed, h->price[0],
+            h->price[1], h->price[2], h->price[3]);
+    exit(1);
+}
+
+/* Sometimes sends g's figures where a month's sums are hardest to get
+ * the same: near the top of a uint, or years on, with ec and ed large. */
+static void throw_about(struct game_state *g)
+{
+    if (rng_below(&dice, 16) != 0)
+    {
+        return;
+    }
+
+    g->debt = (uint) rng_next(&dice) >> rng_below(&dice, 32);
+    g->bank = (uint) rng_next(&dice) >> rng_below(&dice, 32);
+    if (rng_below(&dice, 2) == 0)
+    {
+        g->year += rng_below(&dice, 1000);
+        g->ec   += rng_float(&dice) * 10000;
+        g->ed   += rng_float(&dice) * 500;
+    }
+    thrown++;
+}
+
+/* Plays a batch of games, seeds seed on, each up to the month it is due,
+ * and turns those months both ways, until every game is over. */
+static void play_batch(uint64_t seed)
+{
+    static struct game_state games[MONTH_BATCH],
+                             alone[MONTH_BATCH];
+    static struct player     players[MONTH_BATCH];
+    struct month_batch       batch;
+    struct game_event        ev;
+    const struct policy      *greedy = policy_find("greedy");
+    int                      live[MONTH_BATCH],
+                             turned[MONTH_BATCH],  /* Years thrown on
+                                                    * do not count. */
+                             left = MONTH_BATCH,
+                             n,
+                             i,
+                             k;
+
+    for (i = 0; i < MONTH_BATCH; i++)
+    {
+        game_init(&games[i]);
+        game_seed(&games[i], seed + i);
+        games[i].batch_months = 1;
+        player_init(&players[i], greedy, ~(seed + i));
+        player_start(&players[i], &games[i]);
+        live[i]   = 1;
+        turned[i] = 0;
+    }
+
+    while (left > 0)
+    {
+        game_months_begin(&batch);
+        for (i = 0; i < MONTH_BATCH; i++)
+        {
+            struct game_state *g = &games[i];
+
+            while (live[i])
+            {
+                if (game_step(g, &ev) == EV_GAME_OVER)
+                {
+                    live[i] = 0;
+                    left--;
+                } else if (ev.type == EV_MONTH_DUE) {
+                    throw_about(g);
+                    game_copy(&alone[batch.n], g);
+                    game_months_add(&batch, g);
+                    break;
+                } else {
+                    player_answer(&players[i], g, &ev);
+                }
+            }
+        }
+
+        n = batch.n;
+        game_months_turn(&batch);
+        for (k = 0; k < n; k++)
+        {
+            struct game_state *g = batch.games[k];
+
+            i = g - games;
+            game_step(&alone[k], &ev);
+            if (game_step(g, &ev) != EV_ARRIVING)
+            {
+                fprintf(stderr, "month-check: game %llu did not arrive\n",
+                        (unsigned long long) g->seed);
+                exit(1);
+            }
+            compare(g, &alone[k]);
+            months++;
+
+            if (++turned[i] >= MAX_MONTHS)
+            {
+                live[i] = 0;
+                left--;
+            } else {
+                player_answer(&players[i], g, &ev);
+            }
+        }
+    }
+}
+
+/* Steps two venvs of the same games side by side, one turning its months
+ * in batches and the other a game at a time, on the same random actions,
+ * for limit steps, and checks nothing about them differs. */
+static void lockstep(uint64_t seed, long long limit)
+{
+    struct venv        *a = venv_new(VENV_GAMES, 0),
+                       *b = venv_new(VENV_GAMES, 0);
+    struct venv_action act[VENV_GAMES];
+    long long          t;
+    int                i;
+
+    if ((a == NULL) || (b == NULL))
+    {
+        fprintf(stderr, "month-check: out of memory\n");
+        exit(1);
+    }
+    a->batch_months = 1;
+    for (i = 0; i < VENV_GAMES; i++)
+    {
+        venv_reset_one(a, i, seed + i);
+        venv_reset_one(b, i, seed + i);
+    }
+
+    for (t = 0; t < limit; t++)
+    {
+        for (i = 0; i < VENV_GAMES; i++)
+        {
+            act[i].sell   = 1;
+            act[i].repay  = rng_below(&dice, 2);
+            act[i].borrow = (rng_below(&dice, 3) == 0);
+            act[i].buy    = (int) rng_below(&dice, 5) - 1;
+            act[i].bank   = rng_below(&dice, 2);
+            act[i].dest   = rng_below(&dice, 8);
+        }
+        venv_step(a, act);
+        venv_step(b, act);
+
+        if (!same(a->obs, b->obs, sizeof(*a->obs) * VENV_GAMES * VENV_OBS) ||
+                !same(a->reward, b->reward,
+                      sizeof(*a->reward) * VENV_GAMES) ||
+                !same(a->done, b->done, VENV_GAMES))
+        {
+            fprintf(stderr, "month-check: venvs apart at step %lld\n", t);
+            exit(1);
+        }
+        for (i = 0; i < VENV_GAMES; i++)
+        {
+            struct game_state *g = &a->state[i],
+                              *h = &b->state[i];
+
+            if ((g->month != h->month) || (g->year != h->year) ||
+                    (g->cash != h->cash) || (g->debt != h->debt) ||
+                    (g->bank != h->bank) ||
+                    !same(&g->rng, &h->rng, sizeof(g->rng)))
+            {
+                fprintf(stderr, "month-check: venv game %d apart at step "
+                        "%lld\n", i, t);
+                exit(1);
+            }
+            steps += !a->done[i];
+            if (a->done[i])
+            {
+                uint64_t next = seed + VENV_GAMES * (t + 1) + i;
+
+                venv_reset_one(a, i, next);
+                venv_reset_one(b, i, next);
+            }
+        }
+    }
+
+    venv_free(a);
+    venv_free(b);
+}
+
+int main(int argc, char *argv[])
+{
+    long long batches = 64,
+              limit   = 400,
+              i;
+    uint64_t  seed = 1;
+    int       c;
+
+    while ((c = getopt(argc, argv, "n:v:s:")) != -1)
+    {
+        switch (c)
+        {
+            case 'n':
+                batches = number(optarg);
+                break;
+
+            case 'v':
+                limit = number(optarg);
+                break;
+
+            case 's':
+                seed = number(optarg);
+                break;
+
+            default:
+                usage();
+        }
+    }
+    if (optind != argc)
+    {
+        usage();
+    }
+
+    rng_seed(&dice, seed);
+    for (i = 0; i < batches; i++)
+    {
+        play_batch(seed + i * MONTH_BATCH);
+    }
+    lockstep(seed, limit);
+
+    printf("%lld months turned both ways (%lld thrown about), %lld venv "
+           "steps in lockstep: all the same\n", months, thrown, steps);
+
+    return 0;
+}
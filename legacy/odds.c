@@ -0,0 +1,153 @@
+/* ------------------------------------------------------------------------ *
+ * Battle odds tables.  See odds.h.
+ * ------------------------------------------------------------------------ */
+
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "odds.h"
+
+/* The grid.  Fleets and guns are spaced roughly geometrically, since one
+ * more ship matters a lot more against three than against three hundred. */
+static int ships[] = { 1, 2, 3, 4, 5, 6, 8, 10, 13, 16, 20, 25, 32, 40,
+    50, 64, 80, 100, 150, 200, 300, 500, 1000, FLEET_MAX };
+static int guns[] = { 0, 1, 2, 3, 4, 5, 6, 8, 10, 13, 16, 20, 25, 32, 40,
+    50, 64, 100 };
+static int damage[] = { 0, 20, 40, 60, 80 };  /* Percent of capacity. */
+static int capacity[] = { 60, 160, 360, 1060 };
+static int years[] = { 0, 1, 2, 3, 4, 6, 8, 11, 15, 20, 30 };
+
+#define AXIS(a) ((int) (sizeof(a) / sizeof(a[0])))
+
+/* Where x falls on an axis: the last value not above it. */
+static int axis(const int *a, int n, int x)
+{
+    int i;
+
+    for (i = 1; i < n; i++)
+    {
+        if (a[i] > x)
+        {
+            break;
+        }
+    }
+
+    return i - 1;
+}
+
+long odds_cells(void)
+{
+    return 2L * 2 * AXIS(ships) * AXIS(guns) * AXIS(damage) *
+        AXIS(capacity) * AXIS(years);
+}
+
+void odds_cell(long i, struct odds_query *q)
+{
+    int y = years[i % AXIS(years)];
+
+    i /= AXIS(years);
+    q->capacity = capacity[i % AXIS(capacity)];
+    i /= AXIS(capacity);
+    q->damage = damage[i % AXIS(damage)] * q->capacity / 100;
+    i /= AXIS(damage);
+    q->guns = guns[i % AXIS(guns)];
+    i /= AXIS(guns);
+    q->num_ships = ships[i % AXIS(ships)];
+    i /= AXIS(ships);
+    q->orders = (i % 2) ? ORDERS_RUN : ORDERS_FIGHT;
+    i /= 2;
+    q->id = (i % 2) ? LI_YUEN : GENERIC;
+
+    /* ec and ed grow together, once a year. */
+    q->ec = 20 + (10 * y);
+}
+
+const struct odds *odds_lookup(const struct odds_table *t,
+                               const struct odds_query *q)
+{
+    long i;
+    int  pct = (q->capacity > 0) ? (q->damage * 100 / q->capacity) : 0;
+
+    i = (q->id == LI_YUEN);
+    i = (i * 2) + (q->orders != ORDERS_FIGHT);
+    i = (i * AXIS(ships)) + axis(ships, AXIS(ships), q->num_ships);
+    i = (i * AXIS(guns)) + axis(guns, AXIS(guns), q->guns);
+    i = (i * AXIS(damage)) + axis(damage, AXIS(damage), pct);
+    i = (i * AXIS(capacity)) + axis(capacity, AXIS(capacity), q->capacity);
+    i = (i * AXIS(years)) +
+        axis(years, AXIS(years), (int) ((q->ec - 20) / 10));
+
+    return &t->cells[i];
+}
+
+const struct odds *odds_lookup_game(const struct odds_table *t,
+                                    const struct game_state *g, int orders)
+{
+    struct odds_query q;
+
+    q.id        = g->battle.id;
+    q.orders    = orders;
+    q.num_ships = g->battle.num_ships;
+    q.guns      = g->guns;
+    q.damage    = g->damage;
+    q.capacity  = g->capacity;
+    q.ec        = g->ec;
+
+    return odds_lookup(t, &q);
+}
+
+/* Maps a table written by taipan-odds.  Returns 0, or -1 if the file is
+ * missing or is not a table for this grid. */
+int odds_open(struct odds_table *t, const char *path)
+{
+    const struct odds_header *h;
+    struct stat              st;
+    void                     *map;
+    int                      fd;
+
+    if ((fd = open(path, O_RDONLY)) == -1)
+    {
+        return -1;
+    }
+    if ((fstat(fd, &st) == -1) ||
+            (st.st_size != (off_t) (sizeof(*h) +
+                                    odds_cells() * sizeof(struct odds))))
+    {
+        close(fd);
+        return -1;
+    }
+
+    map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+    {
+        return -1;
+    }
+
+    h = map;
+    if ((memcmp(h->magic, "TAIPANBO", 8) != 0) ||
+            (h->version != ODDS_VERSION) || (h->cells != odds_cells()))
+    {
+        munmap(map, st.st_size);
+        return -1;
+    }
+
+    t->map   = map;
+    t->size  = st.st_size;
+    t->cells = (const struct odds *) (h + 1);
+
+    return 0;
+}
+
+void odds_close(struct odds_table *t)
+{
+    if (t->map != NULL)
+    {
+        munmap(t->map, t->size);
+    }
+    t->map   = NULL;
+    t->cells = NULL;
+}
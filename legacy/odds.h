@@ -0,0 +1,83 @@
+/* ------------------------------------------------------------------------ *
+ * Battle odds: how a sea battle is likely to go, looked up in a table
+ * instead of fought.
+ *
+ * The table covers a grid of battles (fleet size, guns, seaworthiness,
+ * ship size, year, whose fleet, and orders) and is built once by
+ * taipan-odds, which fights every cell many times over with
+ * game_battle_resolve().  It is written as one flat file that is mapped
+ * straight into memory, so loading it costs nothing and a lookup is a
+ * handful of compares and one load.
+ *
+ * Fighting ORDERS_THROW is not in the table; it goes as ORDERS_RUN with
+ * lighter holds, and is looked up as ORDERS_RUN.
+ * ------------------------------------------------------------------------ */
+
+#ifndef TAIPAN_ODDS_H
+#define TAIPAN_ODDS_H
+
+#include <stdint.h>
+
+#include "engine.h"
+
+#define ODDS_FILE    "taipan-odds.tbl"
+#define ODDS_VERSION 1
+#define ODDS_ONE     65535  /* A probability of 1 in struct odds. */
+
+/* One cell: how a battle ends, and what it costs us on the way. */
+struct odds
+{
+    uint16_t won,          /* Out of ODDS_ONE. */
+             fled,
+             lost,
+             interrupted;  /* Li Yuen drove them off. */
+    float    damage,       /* Seaworthiness lost, in percent. */
+             guns_lost;
+};
+
+/* A battle to look up, or one cell of the grid. */
+struct odds_query
+{
+    int   id,
+          orders,
+          num_ships,
+          guns,
+          damage,
+          capacity;
+    float ec;  /* ed goes with it, as it always does in a game. */
+};
+
+struct odds_table
+{
+    const struct odds *cells;
+    void              *map;
+    long              size;
+};
+
+/* The file: this header, then odds_cells() cells in grid order. */
+struct odds_header
+{
+    char     magic[8];  /* "TAIPANBO" */
+    uint32_t version,
+             cells,
+             samples;
+    uint32_t pad;
+    uint64_t seed;
+};
+
+int  odds_open(struct odds_table *t, const char *path);
+void odds_close(struct odds_table *t);
+
+/* The cell nearest below q on every axis (the smallest, where q is below
+ * them all). */
+const struct odds *odds_lookup(const struct odds_table *t,
+                               const struct odds_query *q);
+/* The same for a battle just begun in g. */
+const struct odds *odds_lookup_game(const struct odds_table *t,
+                                    const struct game_state *g, int orders);
+
+/* The grid, for taipan-odds. */
+long odds_cells(void);
+void odds_cell(long i, struct odds_query *q);
+
+#endif /* TAIPAN_ODDS_H */
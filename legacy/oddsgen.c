@@ -0,0 +1,147 @@
+/* ------------------------------------------------------------------------ *
+ * taipan-odds: build the battle odds table (see odds.h) by fighting every
+ * battle on the grid many times over, on every core.
+ *
+ * Sample s of cell i is seeded with seed + (i * samples) + s, so the same
+ * seed and sample count give the same table on any number of threads.
+ * ------------------------------------------------------------------------ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "engine.h"
+#include "odds.h"
+#include "pool.h"
+#include "tool.h"
+
+struct build
+{
+    uint64_t    seed;
+    int         samples;
+    struct odds *cells;
+};
+
+static void fill(long i, void *arg)
+{
+    struct build      *build = arg;
+    struct odds_query q;
+    struct game_state g;
+    long              count[5] = { 0 };
+    double            damage = 0,
+                      guns = 0;
+    int               s;
+
+    odds_cell(i, &q);
+
+    for (s = 0; s < build->samples; s++)
+    {
+        game_init(&g);
+        game_seed(&g, build->seed + ((uint64_t) i * build->samples) + s);
+        g.capacity = q.capacity;
+        g.damage   = q.damage;
+        g.guns     = q.guns;
+        g.ec       = q.ec;
+        g.ed       = 0.5 + ((q.ec - 20) / 20);
+
+        game_battle_begin(&g, q.id, q.num_ships);
+        count[game_battle_resolve(&g, q.orders)]++;
+
+        damage += (double) (g.damage - q.damage) * 100 / q.capacity;
+        guns   += q.guns - g.guns;
+    }
+
+    build->cells[i].won         = count[BATTLE_WON] * ODDS_ONE / s;
+    build->cells[i].fled        = count[BATTLE_FLED] * ODDS_ONE / s;
+    build->cells[i].lost        = count[BATTLE_LOST] * ODDS_ONE / s;
+    build->cells[i].interrupted = count[BATTLE_INTERRUPTED] * ODDS_ONE / s;
+    build->cells[i].damage      = damage / s;
+    build->cells[i].guns_lost   = guns / s;
+}
+
+void usage(void)
+{
+    fprintf(stderr,
+            "usage: taipan-odds [-n samples] [-s seed] [-j threads] [-o file]\n");
+    exit(1);
+}
+
+int main(int argc, char *argv[])
+{
+    struct build       build;
+    struct odds_header h;
+    char               *path = ODDS_FILE,
+                       tmp[4096];
+    long               cells = odds_cells();
+    int                threads = 0,
+                       c;
+    FILE               *fp;
+
+    build.seed    = 1;
+    build.samples = 256;
+
+    while ((c = getopt(argc, argv, "n:s:j:o:")) != -1)
+    {
+        switch (c)
+        {
+            case 'n':
+                build.samples = number(optarg);
+                break;
+
+            case 's':
+                build.seed = number(optarg);
+                break;
+
+            case 'j':
+                threads = number(optarg);
+                break;
+
+            case 'o':
+                path = optarg;
+                break;
+
+            default:
+                usage();
+        }
+    }
+    if ((optind != argc) || (build.samples < 1))
+    {
+        usage();
+    }
+
+    build.cells = calloc(cells, sizeof(*build.cells));
+    if ((build.cells == NULL) || (pool_run(threads, cells, fill, &build) != 0))
+    {
+        fprintf(stderr, "taipan-odds: out of memory\n");
+        return 1;
+    }
+
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, "TAIPANBO", 8);
+    h.version = ODDS_VERSION;
+    h.cells   = cells;
+    h.samples = build.samples;
+    h.seed    = build.seed;
+
+    /* Written aside and moved into place, so that a game mapping the old
+     * table never sees half of the new one. */
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+    if (((fp = fopen(tmp, "wb")) == NULL) ||
+            (fwrite(&h, sizeof(h), 1, fp) != 1) ||
+            (fwrite(build.cells, sizeof(*build.cells), cells, fp) !=
+             (size_t) cells) ||
+            (fclose(fp) != 0) ||
+            (rename(tmp, path) != 0))
+    {
+        perror(path);
+        return 1;
+    }
+
+    printf("%ld battles, %d times each, written to %s\n", cells,
+           build.samples, path);
+    free(build.cells);
+
+    return 0;
+}
@@ -0,0 +1,512 @@
+/* ------------------------------------------------------------------------ *
+ * taipan-oracle: the best score it can find for a game whose dice are all
+ * known, choosing every move in port and answering as greedy between
+ * them, as a mark to hold players and bots up to.
+ *
+ * The game is played from its seed, with every draw the engine would make,
+ * by a beam search over its ports.  Each game in the beam is played on to
+ * its next port with each move mcts_moves() gives it, answering between
+ * ports as greedy (policy.c) does; games that turn out the same (figures,
+ * prices and dice) are kept once; and the width richest, counting their
+ * cargo at the prices where they are, go on to the next port.  Games that
+ * end on the way are scored as final_stats() scores them, and so is the
+ * whole beam at the month limit.  The ports are played out on every
+ * thread.
+ *
+ * Only the moves in port are searched.  Between ports (Li Yuen, McHenry,
+ * Wu, ships and guns for sale, and the battles) every game answers as
+ * greedy would, and the dice then fall as those answers leave them.  So
+ * what it finds is the best score with greedy's answers between ports:
+ * other answers at sea are never tried, and may do better.
+ *
+ * Nor is a beam search exhaustive.  The score found can be had, and so is
+ * a floor under the best there is with greedy's answers between ports,
+ * which widening the beam only raises; it is no ceiling on any player.
+ * ------------------------------------------------------------------------ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "engine.h"
+#include "mcts.h"
+#include "policy.h"
+#include "pool.h"
+#include "tool.h"
+
+/* A game in the beam, and how it got there. */
+struct entry
+{
+    struct game_state g;
+    int               parent;
+    struct mcts_move  move;
+};
+
+/* A game one port on from the beam, known only by its hash until it is
+ * chosen and played again. */
+struct child
+{
+    uint64_t         hash;
+    double           worth;
+    int              parent;
+    struct mcts_move move;
+};
+
+/* The best ending found. */
+struct ending
+{
+    long long        score;
+    int              found,
+                     port,    /* How many ports in, */
+                     parent,  /* from which game in the beam then, */
+                     months,
+                     cause;
+    long long        net_worth;
+    struct mcts_move move;    /* making this move. */
+};
+
+/* How a game in the beam came about. */
+struct step
+{
+    int              parent;
+    struct mcts_move move;
+};
+
+struct oracle
+{
+    const struct policy *greedy;
+    int                 width,
+                        ports,
+                        max_months;
+
+    struct entry        *beam,
+                        *next;
+    int                 size;
+    struct child        *children;   /* MCTS_MOVES to each game. */
+    int                 *counts,     /* Children to each game, */
+                        *tried;      /* of so many moves. */
+    struct ending       *endings;    /* One to each game. */
+
+    struct step         **steps;     /* How each port's beam came about, */
+    int                 depth;       /* for so many ports. */
+    long long           played;      /* Voyages sailed. */
+};
+
+void usage(void)
+{
+    fprintf(stderr,
+            "usage: taipan-oracle [-v] [-s seed] [-w width] [-m months] [-j threads]\n");
+    exit(1);
+}
+
+static uint64_t mix(uint64_t h, uint64_t v)
+{
+    h ^= v + 0x9e3779b97f4a7c15 + (h << 6) + (h >> 2);
+    h *= 0xbf58476d1ce4e5b9;
+
+    return h ^ (h >> 31);
+}
+
+/* Everything that decides how g plays on from a port. */
+static uint64_t hash(const struct game_state *g)
+{
+    uint64_t h = 0;
+    uint32_t ec,
+             ed;
+    int      k;
+
+    memcpy(&ec, &g->ec, sizeof(ec));
+    memcpy(&ed, &g->ed, sizeof(ed));
+    h = mix(h, g->cash);
+    h = mix(h, g->bank);
+    h = mix(h, g->debt);
+    h = mix(h, ((uint64_t) ec << 32) | ed);
+    for (k = 0; k < 4; k++)
+    {
+        h = mix(h, g->price[k]);
+        h = mix(h, ((uint64_t) (uint32_t) g->hkw_[k] << 32) |
+                (uint32_t) g->hold_[k]);
+    }
+    h = mix(h, ((uint64_t) (uint32_t) g->hold << 32) | (uint32_t) g->guns);
+    h = mix(h, ((uint64_t) (uint32_t) g->capacity << 32) |
+            (uint32_t) g->damage);
+    h = mix(h, ((uint64_t) (uint32_t) g->bp << 32) | (uint32_t) g->li);
+    h = mix(h, ((uint64_t) (uint32_t) g->month << 32) | (uint32_t) g->year);
+    h = mix(h, ((uint64_t) (uint32_t) g->port << 32) |
+            (uint32_t) g->wu_warn);
+    h = mix(h, g->wu_bailout);
+    for (k = 0; k < 4; k++)
+    {
+        h = mix(h, g->rng.s[k]);
+    }
+
+    return h;
+}
+
+/* Plays g on from its port with move, to its next port or its end.
+ * Returns the event it stopped at. */
+static int play(const struct oracle *o, struct game_state *g,
+                const struct mcts_move *move)
+{
+    struct game_event ev;
+    struct player     p;
+
+    player_init(&p, o->greedy, 0);
+    mcts_apply(g, move);
+    while ((game_step(g, &ev) != EV_PORT) && (ev.type != EV_GAME_OVER))
+    {
+        player_answer(&p, g, &ev);
+    }
+
+    return ev.type;
+}
+
+static int better(const struct ending *a, const struct ending *b)
+{
+    return a->found && (!b->found || (a->score > b->score));
+}
+
+/* Plays game i of the beam on with each of its moves. */
+static void expand(long i, void *arg)
+{
+    struct oracle     *o = arg;
+    struct child      *c = &o->children[i * MCTS_MOVES];
+    struct ending     *end = &o->endings[i];
+    struct mcts_move  moves[MCTS_MOVES];
+    struct game_state g;
+    int               n = mcts_moves(&o->beam[i].g, moves),
+                      k;
+
+    end->found   = 0;
+    o->counts[i] = 0;
+    o->tried[i]  = n;
+    for (k = 0; k < n; k++)
+    {
+        game_copy(&g, &o->beam[i].g);
+        if (play(o, &g, &moves[k]) == EV_GAME_OVER)
+        {
+            struct ending e;
+
+            e.found     = 1;
+            e.score     = game_score(&g);
+            e.net_worth = game_net_worth(&g);
+            e.months    = game_months(&g);
+            e.cause     = g.over;
+            e.parent    = i;
+            e.move      = moves[k];
+            if (better(&e, end))
+            {
+                *end = e;
+            }
+            continue;
+        }
+
+        c->hash   = hash(&g);
+        c->worth  = game_worth(&g);
+        c->parent = i;
+        c->move   = moves[k];
+        c++;
+        o->counts[i]++;
+    }
+}
+
+/* Plays the chosen child i again, into the next beam. */
+static void regrow(long i, void *arg)
+{
+    struct oracle *o = arg;
+    struct entry  *e = &o->next[i];
+
+    game_copy(&e->g, &o->beam[e->parent].g);
+    play(o, &e->g, &e->move);
+}
+
+static int by_hash(const void *a, const void *b)
+{
+    const struct child *x = a,
+                       *y = b;
+
+    return (x->hash < y->hash) ? -1 : (x->hash > y->hash);
+}
+
+static int by_worth(const void *a, const void *b)
+{
+    const struct child *x = a,
+                       *y = b;
+
+    return (x->worth < y->worth) - (x->worth > y->worth);
+}
+
+/* Prints the line that ended in best, a port to a line. */
+static void show(const struct oracle *o, const struct ending *best)
+{
+    static char      *money[] = { "-", "bank", "repay", "borrow" },
+                     *goods[] = { "opium", "silk", "arms", "general" },
+                     *ports[] = { "retire", "Hong Kong", "Shanghai",
+                         "Nagasaki", "Saigon", "Manila", "Singapore",
+                         "Batavia" };
+    struct mcts_move *line = malloc((best->port + 1) * sizeof(*line));
+    char             buy[16];
+    int              k,
+                     i = best->parent;
+
+    if (line == NULL)
+    {
+        return;
+    }
+    line[best->port] = best->move;
+    for (k = best->port - 1; k >= 0; k--)
+    {
+        line[k] = o->steps[k + 1][i].move;
+        i = o->steps[k + 1][i].parent;
+    }
+
+    printf("%5s  %-5s %-7s %-13s %s\n",
+           "port", "sell", "money", "buy", "sail for");
+    for (k = 0; k <= best->port; k++)
+    {
+        if (line[k].buy < 0)
+        {
+            strcpy(buy, "-");
+        } else {
+            snprintf(buy, sizeof(buy), "%s%s", line[k].half ? "half " : "",
+                     goods[line[k].buy]);
+        }
+        printf("%5d  %-5s %-7s %-13s %s\n", k + 1,
+               line[k].sell ? "all" : "-", money[line[k].finance], buy,
+               ports[line[k].dest]);
+    }
+    free(line);
+}
+
+int main(int argc, char *argv[])
+{
+    struct oracle     o;
+    struct ending     best;
+    struct game_event ev;
+    struct player     p;
+    uint64_t          seed = 1;
+    int               threads = 0,
+                      verbose = 0,
+                      c,
+                      i,
+                      n;
+    double            elapsed;
+
+    memset(&o, 0, sizeof(o));
+    o.width      = 1000;
+    o.max_months = 240;
+
+    while ((c = getopt(argc, argv, "vs:w:m:j:")) != -1)
+    {
+        switch (c)
+        {
+            case 'v':
+                verbose = 1;
+                break;
+
+            case 's':
+                seed = number(optarg);
+                break;
+
+            case 'w':
+                o.width = number(optarg);
+                break;
+
+            case 'm':
+                o.max_months = number(optarg);
+                break;
+
+            case 'j':
+                threads = number(optarg);
+                break;
+
+            default:
+                usage();
+        }
+    }
+    if ((optind != argc) || (o.width < 1) || (o.width > 1000000) ||
+            (o.max_months < 1))
+    {
+        usage();
+    }
+
+    o.greedy   = policy_find("greedy");
+    o.beam     = malloc(o.width * sizeof(*o.beam));
+    o.next     = malloc(o.width * sizeof(*o.next));
+    o.children = malloc((long) o.width * MCTS_MOVES * sizeof(*o.children));
+    o.counts   = malloc(o.width * sizeof(*o.counts));
+    o.tried    = malloc(o.width * sizeof(*o.tried));
+    o.endings  = malloc(o.width * sizeof(*o.endings));
+    o.depth    = o.max_months + 1;
+    o.steps    = calloc(o.depth, sizeof(*o.steps));
+    if ((o.beam == NULL) || (o.next == NULL) || (o.children == NULL) ||
+            (o.counts == NULL) || (o.tried == NULL) || (o.endings == NULL) ||
+            (o.steps == NULL))
+    {
+        fprintf(stderr, "taipan-oracle: out of memory\n");
+        return 1;
+    }
+
+    /* The game to its first port, as greedy starts it. */
+    game_init(&o.beam[0].g);
+    game_seed(&o.beam[0].g, seed);
+    player_init(&p, o.greedy, 0);
+    player_start(&p, &o.beam[0].g);
+    while (game_step(&o.beam[0].g, &ev) != EV_PORT)
+    {
+        player_answer(&p, &o.beam[0].g, &ev);
+    }
+    o.size = 1;
+
+    memset(&best, 0, sizeof(best));
+    elapsed = seconds();
+    for (o.ports = 0; o.size > 0; o.ports++)
+    {
+        long total = 0;
+
+        if (pool_run(threads, o.size, expand, &o) != 0)
+        {
+            fprintf(stderr, "taipan-oracle: out of memory\n");
+            return 1;
+        }
+        for (i = 0; i < o.size; i++)
+        {
+            o.endings[i].port = o.ports;
+            if (better(&o.endings[i], &best))
+            {
+                best = o.endings[i];
+            }
+
+            /* The children, packed to the front. */
+            memmove(&o.children[total], &o.children[(long) i * MCTS_MOVES],
+                    o.counts[i] * sizeof(*o.children));
+            total += o.counts[i];
+            o.played += o.tried[i];
+        }
+
+        /* Each game once, then the richest. */
+        qsort(o.children, total, sizeof(*o.children), by_hash);
+        for (n = 0, i = 0; i < total; i++)
+        {
+            if ((n == 0) || (o.children[i].hash != o.children[n - 1].hash))
+            {
+                o.children[n++] = o.children[i];
+            }
+        }
+        qsort(o.children, n, sizeof(*o.children), by_worth);
+        if (n > o.width)
+        {
+            n = o.width;
+        }
+
+        if (o.ports + 2 > o.depth)
+        {
+            /* A voyage Li Yuen lets be takes no month. */
+            struct step **more = realloc(o.steps,
+                                         2 * o.depth * sizeof(*o.steps));
+
+            if (more == NULL)
+            {
+                fprintf(stderr, "taipan-oracle: out of memory\n");
+                return 1;
+            }
+            memset(more + o.depth, 0, o.depth * sizeof(*more));
+            o.steps = more;
+            o.depth *= 2;
+        }
+        o.steps[o.ports + 1] = malloc((n + 1) * sizeof(**o.steps));
+        if (o.steps[o.ports + 1] == NULL)
+        {
+            fprintf(stderr, "taipan-oracle: out of memory\n");
+            return 1;
+        }
+        for (i = 0; i < n; i++)
+        {
+            o.next[i].parent = o.children[i].parent;
+            o.next[i].move   = o.children[i].move;
+            o.steps[o.ports + 1][i].parent = o.children[i].parent;
+            o.steps[o.ports + 1][i].move   = o.children[i].move;
+        }
+        if (pool_run(threads, n, regrow, &o) != 0)
+        {
+            fprintf(stderr, "taipan-oracle: out of memory\n");
+            return 1;
+        }
+
+        {
+            struct entry *swap = o.beam;
+
+            o.beam = o.next;
+            o.next = swap;
+        }
+
+        /* Games at the month limit are cut off there, and go no further. */
+        for (o.size = 0, i = 0; i < n; i++)
+        {
+            struct entry *e = &o.beam[i];
+
+            if (game_months(&e->g) >= o.max_months)
+            {
+                struct ending end;
+
+                end.found     = 1;
+                end.score     = game_score(&e->g);
+                end.net_worth = game_net_worth(&e->g);
+                end.months    = game_months(&e->g);
+                end.cause     = GAME_RUNNING;
+                end.port      = o.ports;
+                end.parent    = e->parent;
+                end.move      = e->move;
+                if (better(&end, &best))
+                {
+                    best = end;
+                }
+                continue;
+            }
+            if (o.size != i)
+            {
+                game_copy(&o.beam[o.size].g, &e->g);
+                o.beam[o.size].parent = e->parent;
+                o.beam[o.size].move   = e->move;
+                o.steps[o.ports + 1][o.size] = o.steps[o.ports + 1][i];
+            }
+            o.size++;
+        }
+    }
+    elapsed = seconds() - elapsed;
+
+    printf("seed %llu, %d wide, to month %d\n\n", (unsigned long long) seed,
+           o.width, o.max_months);
+    if (!best.found)
+    {
+        printf("no game ended\n");
+    } else {
+        printf("best score %lld, with greedy's answers between ports: net "
+               "worth %lld in %d months, %s\n",
+               best.score, best.net_worth, best.months, causes[best.cause]);
+        if (verbose)
+        {
+            printf("\n");
+            show(&o, &best);
+        }
+    }
+    printf("\n%lld voyages over %d ports, in %.3f s: %.0f a second\n",
+           o.played, o.ports, elapsed,
+           (elapsed > 0) ? o.played / elapsed : 0);
+
+    for (i = 0; i < o.depth; i++)
+    {
+        free(o.steps[i]);
+    }
+    free(o.steps);
+    free(o.beam);
+    free(o.next);
+    free(o.children);
+    free(o.counts);
+    free(o.tried);
+    free(o.endings);
+
+    return 0;
+}
@@ -0,0 +1,200 @@
+/* ------------------------------------------------------------------------ *
+ * Games that can be put down and picked up again.  See play.h.
+ * ------------------------------------------------------------------------ */
+
+#define _GNU_SOURCE
+
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "play.h"
+#include "taipan.h"
+
+#define STACK (64 * 1024)
+
+static struct play *current;  /* The play running now. */
+
+/* ------------------------------------------------------------------------ *
+ * Inside a play: the game's waits hand control back to play_run()'s
+ * caller.
+ * ------------------------------------------------------------------------ */
+
+static void yield(int state, long wait)
+{
+    struct play *p = current;
+
+    p->state = state;
+    p->wait  = wait;
+    swapcontext(&p->ctx, &p->back);
+}
+
+static int play_io_key(int wait)
+{
+    struct play *p = current;
+    int         key;
+
+    /* Waiting for ever means just that. */
+    do
+    {
+        if ((p->in_len == 0) && (wait != 0))
+        {
+            yield(PLAY_KEY, wait);
+        }
+    } while ((p->in_len == 0) && (wait < 0));
+
+    if (p->in_len == 0)
+    {
+        return ERR;
+    }
+
+    key = p->in[0];
+    memmove(p->in, p->in + 1, --p->in_len);
+
+    return key;
+}
+
+static void play_io_nap(long usec)
+{
+    yield(PLAY_NAP, usec / 1000);
+}
+
+static void play_io_flush(void)
+{
+    current->in_len = 0;
+}
+
+/* Behind by what the caller has sent on and the player has yet to take,
+ * and by what is drawn and not yet sent. */
+static int play_io_behind(void)
+{
+    struct play *p = current;
+    size_t      len;
+
+    ansi_output(p->screen, &len);
+
+    return p->queued + len > UI_BEHIND;
+}
+
+static struct ui_io play_io = { play_io_key, play_io_nap, play_io_flush,
+                                play_io_behind };
+
+static void play_main(void)
+{
+    struct play *p = current;
+
+    game_init(g);
+    game_seed(g, p->seed);
+    taipan();
+
+    p->state = PLAY_DONE;
+    p->wait  = -1;
+}
+
+/* ------------------------------------------------------------------------ *
+ * Outside.
+ * ------------------------------------------------------------------------ */
+
+int play_open(struct play *p, uint64_t seed)
+{
+    memset(p, 0, sizeof(*p));
+    p->state = PLAY_RUN;
+    p->wait  = -1;
+    p->seed  = seed;
+
+    /* The stack's pages are only touched, and so only paid for, as they
+     * are needed.  The page below it is a guard, so that a game running
+     * off the end of its stack faults rather than trampling whatever the
+     * server has mapped there. */
+    p->guard = sysconf(_SC_PAGESIZE);
+    p->stack = mmap(NULL, p->guard + STACK, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+
+    if (p->stack == MAP_FAILED)
+    {
+        return -1;
+    }
+    if ((mprotect(p->stack, p->guard, PROT_NONE) == -1) ||
+            ((p->screen = ansi_newterm()) == NULL))
+    {
+        munmap(p->stack, p->guard + STACK);
+        return -1;
+    }
+
+    cbreak();
+    noecho();
+    curs_set(0);
+
+    getcontext(&p->ctx);
+    p->ctx.uc_stack.ss_sp   = p->stack + p->guard;
+    p->ctx.uc_stack.ss_size = STACK;
+    p->ctx.uc_link          = &p->back;
+    makecontext(&p->ctx, play_main, 0);
+
+    return 0;
+}
+
+void play_close(struct play *p)
+{
+    set_term(p->screen);
+    endwin();
+    delscreen(p->screen);
+    munmap(p->stack, p->guard + STACK);
+}
+
+int play_run(struct play *p)
+{
+    struct ui_io      *old_io = io;
+    struct game_state *old_g = g;
+
+    if (p->state == PLAY_DONE)
+    {
+        return PLAY_DONE;
+    }
+
+    current = p;
+    io = &play_io;
+    g = &p->game;
+    set_term(p->screen);
+
+    p->state = PLAY_RUN;
+    swapcontext(&p->back, &p->ctx);
+
+    current = NULL;
+    io = old_io;
+    g = old_g;
+
+    return p->state;
+}
+
+int play_key(struct play *p, int key)
+{
+    if (p->in_len == PLAY_INPUT)
+    {
+        return -1;
+    }
+    p->in[p->in_len++] = key;
+
+    return 0;
+}
+
+const char *play_output(struct play *p, size_t *len)
+{
+    return ansi_output(p->screen, len);
+}
+
+void play_consume(struct play *p, size_t n)
+{
+    ansi_consume(p->screen, n);
+}
+
+void play_repaint(struct play *p)
+{
+    p->queued = 0;
+    ansi_repaint(p->screen);
+}
+
+char *play_snapshot(struct play *p, size_t *len)
+{
+    return ansi_snapshot(p->screen, len);
+}
@@ -0,0 +1,92 @@
+/* ------------------------------------------------------------------------ *
+ * A game of the curses Taipan that can be put down and picked up again.
+ *
+ * taipan.c is written as the original was, as one long run of code that
+ * stops to wait for keys and to let the player read.  A play runs it on
+ * a small stack of its own (a ucontext), and every such wait hands control
+ * back to whoever called play_run(), saying what the game is waiting for
+ * and for how long.  The caller can then do what it likes -- run other
+ * games, wait on the network, wait not at all -- and call play_run() again
+ * when a key has been given with play_key() or the time is up.
+ *
+ * The game draws on a SCREEN of its own from ansi.h, which keeps the
+ * escape sequences for what has been drawn in a buffer; play_output()
+ * hands over the buffer as it is.  No terminal is needed, and nothing in
+ * a play depends on the thread that runs it, so any thread may run any
+ * play, one play at a time (taipan.c is not ours to share).
+ * ------------------------------------------------------------------------ */
+
+#ifndef TAIPAN_PLAY_H
+#define TAIPAN_PLAY_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <ucontext.h>
+
+#include "ansi.h"
+#include "engine.h"
+
+#define PLAY_INPUT 256  /* Keys typed ahead. */
+
+/* What a play is waiting for. */
+enum
+{
+    PLAY_RUN,   /* Not yet started, or running. */
+    PLAY_KEY,   /* A key, for up to wait ms. */
+    PLAY_NAP,   /* wait ms to go by. */
+    PLAY_DONE   /* The player has left the game. */
+};
+
+struct play
+{
+    int               state;
+    long              wait;    /* ms, or -1 for as long as it takes. */
+
+    struct game_state game;
+    uint64_t          seed;
+
+    SCREEN            *screen;
+    size_t            queued;  /* Output sent on that the player has yet to
+                                * take, as the caller last saw it. */
+
+    ucontext_t        ctx,
+                      back;    /* Where play_run() was called. */
+    char              *stack;  /* Below it, a guard page guard long. */
+    long              guard;
+
+    unsigned char     in[PLAY_INPUT];
+    int               in_len;
+};
+
+/* Sets up a game.  Returns 0, or -1 if we are out of memory. */
+int     play_open(struct play *p, uint64_t seed);
+void    play_close(struct play *p);
+
+/* Runs p until it next waits, and returns what it waits for.  Running a
+ * play that waits for a key with none given ends the wait with no key
+ * (if it was only waiting so long); running one that naps ends the nap. */
+int     play_run(struct play *p);
+
+/* Gives p a key.  Returns -1 if it has too many waiting already. */
+int     play_key(struct play *p, int key);
+
+/* What p has drawn and not yet been rid of, *len bytes of it, and ridding
+ * p of the first n of them.  A run that draws leaves a frame here, to be
+ * sent in one write; whatever is not consumed stays, and more is added
+ * after it. */
+const char *play_output(struct play *p, size_t *len);
+void       play_consume(struct play *p, size_t n);
+
+/* Starts p's output over, with all of its screen as the player last had
+ * it, for a player taking the game up on another terminal. */
+void       play_repaint(struct play *p);
+
+/* All of p's screen, as it will be once its output so far is seen, for a
+ * spectator to start from (see ansi_snapshot()). */
+char       *play_snapshot(struct play *p, size_t *len);
+
+/* Output consumed is not yet seen.  A caller that keeps p->queued up to
+ * date before each run has the battle cut its animations short for a
+ * player who has fallen behind (see UI_BEHIND in taipan.h). */
+
+#endif /* TAIPAN_PLAY_H */
@@ -0,0 +1,727 @@
+/* ------------------------------------------------------------------------ *
+ * Asking policies what to do, and the reference policies.  See policy.h.
+ * ------------------------------------------------------------------------ */
+
+#include <stddef.h>
+#include <string.h>
+
+#include "policy.h"
+
+/* Asks p's policy question q, or takes 0 for an answer if it has none. */
+#define ASK(p, q, ...) (((p)->policy->q == NULL) ? 0 : \
+        ((p)->decisions++, (p)->policy->q((p), __VA_ARGS__)))
+
+void player_init(struct player *p, const struct policy *policy,
+                 uint64_t seed)
+{
+    p->policy    = policy;
+    p->arg       = NULL;
+    p->decisions = 0;
+    rng_seed(&p->rng, seed);
+}
+
+void player_start(struct player *p, struct game_state *g)
+{
+    game_start(g, (p->policy->cash == NULL) || ASK(p, cash, g));
+}
+
+/* Where the firm is short, Elder Brother Wu may make up the difference. */
+static void short_of(struct player *p, struct game_state *g, long amount,
+                     int mchenry)
+{
+    int yes = ASK(p, wu_covers, g, amount - (long) g->cash);
+
+    if (mchenry)
+    {
+        game_mchenry_wu(g, amount, yes);
+    } else {
+        game_li_yuen_wu(g, yes);
+    }
+}
+
+static void wu(struct player *p, struct game_state *g)
+{
+    long amount;
+
+    if (game_wu_broke(g))
+    {
+        game_wu_bailout_offer(g);
+        game_wu_bailout(g, ASK(p, bailout, g));
+        return;
+    }
+
+    if (game_wu_can_repay(g) && ((amount = ASK(p, wu_repay, g)) != 0))
+    {
+        game_wu_repay(g, amount);
+    }
+    if ((amount = ASK(p, wu_borrow, g)) != 0)
+    {
+        game_wu_borrow(g, amount);
+    }
+}
+
+static void port(struct player *p, struct game_state *g)
+{
+    int  i,
+         dest,
+         err;
+    long amount;
+
+    for (i = 0; i < 4; i++)
+    {
+        if ((g->hold_[i] > 0) && ((amount = ASK(p, sell, g, i)) != 0))
+        {
+            game_sell(g, i, amount);
+        }
+    }
+
+    if (g->port == 1)
+    {
+        if ((g->bank > 0) && ((amount = ASK(p, withdraw, g)) != 0))
+        {
+            game_withdraw(g, amount);
+        }
+        if (game_wu_can_repay(g) && ((amount = ASK(p, wu_repay, g)) != 0))
+        {
+            game_wu_repay(g, amount);
+        }
+        if (game_can_retire(g) && ASK(p, retire, g))
+        {
+            game_retire(g);
+            return;
+        }
+        for (i = 0; i < 4; i++)
+        {
+            if ((g->hkw_[i] > 0) && ((amount = ASK(p, to_ship, g, i)) != 0))
+            {
+                game_to_ship(g, i, amount);
+            }
+        }
+    }
+
+    for (i = 0; i < 4; i++)
+    {
+        if ((amount = ASK(p, buy, g, i)) != 0)
+        {
+            game_buy(g, i, amount);
+        }
+    }
+
+    if (g->port == 1)
+    {
+        for (i = 0; i < 4; i++)
+        {
+            if ((g->hold_[i] > 0) &&
+                    ((amount = ASK(p, to_warehouse, g, i)) != 0))
+            {
+                game_to_warehouse(g, i, amount);
+            }
+        }
+        if ((g->cash > 0) && ((amount = ASK(p, deposit, g)) != 0))
+        {
+            game_deposit(g, amount);
+        }
+    }
+
+    dest = ASK(p, destination, g);
+    if ((err = game_quit(g, dest)) == ERR_OVERLOAD)
+    {
+        /* Bought more than the hold takes: sell up rather than stay. */
+        for (i = 0; i < 4; i++)
+        {
+            game_sell(g, i, -1);
+        }
+        err = game_quit(g, dest);
+    }
+    if (err != 0)
+    {
+        game_quit(g, (g->port % 7) + 1);
+    }
+}
+
+void player_answer(struct player *p, struct game_state *g,
+                   const struct game_event *ev)
+{
+    long amount;
+    int  item;
+
+    switch (ev->type)
+    {
+        case EV_LI_YUEN_DEMAND:
+            if (ASK(p, li_yuen, g) && (game_li_yuen_pay(g) != 0))
+            {
+                short_of(p, g, (long) g->offer, 0);
+            }
+            break;
+
+        case EV_MCHENRY:
+            if (p->policy->mchenry != NULL)
+            {
+                long quote = game_mchenry_quote(g);
+
+                if ((amount = ASK(p, mchenry, g, quote)) != 0)
+                {
+                    if (game_mchenry_short(g, amount))
+                    {
+                        short_of(p, g, (amount == -1) ? quote : amount, 1);
+                    }
+                    game_mchenry_pay(g, amount);
+                }
+            }
+            break;
+
+        case EV_WU:
+            wu(p, g);
+            break;
+
+        case EV_NEW_SHIP:
+        case EV_NEW_GUN:
+            if (ASK(p, upgrade, g, ev->type))
+            {
+                if (ev->type == EV_NEW_SHIP)
+                {
+                    game_buy_ship(g);
+                } else {
+                    game_buy_gun(g);
+                }
+            }
+            break;
+
+        case EV_PORT:
+            port(p, g);
+            break;
+
+        case EV_BATTLE_ORDERS:
+        case EV_ORDERS_CHANGE:
+            game_battle_orders(g, ASK(p, orders, g));
+            break;
+
+        case EV_THROW_CARGO:
+            if (p->policy->jettison != NULL)
+            {
+                amount = -1;
+                item = ASK(p, jettison, g, &amount);
+                game_battle_throw(g, item, amount);
+            }
+            break;
+    }
+}
+
+/* ------------------------------------------------------------------------ *
+ * Answers several policies give.
+ * ------------------------------------------------------------------------ */
+
+static int yes(struct player *p, const struct game_state *g)
+{
+    return 1;
+}
+
+static long all(struct player *p, const struct game_state *g)
+{
+    return -1;
+}
+
+static long all_of(struct player *p, const struct game_state *g, int item)
+{
+    return -1;
+}
+
+static int afford_li_yuen(struct player *p, const struct game_state *g)
+{
+    return g->offer <= g->cash;
+}
+
+static long half_cash_repair(struct player *p, const struct game_state *g,
+                             long quote)
+{
+    return (quote <= (long) g->cash / 2) ? -1 : 0;
+}
+
+static int fight_or_run(struct player *p, const struct game_state *g)
+{
+    return (g->guns > 0) ? ORDERS_FIGHT : ORDERS_RUN;
+}
+
+static int everything(struct player *p, const struct game_state *g,
+                      long *amount)
+{
+    *amount = -1;
+    return 4;
+}
+
+static long least(long a, long b)
+{
+    return (a < b) ? a : b;
+}
+
+/* As much of item as we can pay for and stow. */
+static long fill(const struct game_state *g, int item)
+{
+    return (g->hold > 0) ? least(game_afford(g, item), g->hold) : 0;
+}
+
+/* The run that promises most: the good that should sell for most above
+ * what it costs here, on average, and the port (not this one) to take it
+ * to; only Hong Kong if home.  Sets *item to -1 if nothing promises a
+ * profit, and returns the port that loses least. */
+static int best_run(const struct game_state *g, int home, int *item)
+{
+    int    i,
+           dest,
+           last = home ? 1 : 7,
+           best = (g->port % 7) + 1;
+    double ratio,
+           most = 0;
+
+    *item = -1;
+    for (dest = 1; dest <= last; dest++)
+    {
+        if (dest == g->port)
+        {
+            continue;
+        }
+        for (i = 0; i < 4; i++)
+        {
+            ratio = (double) game_mean_price(i, dest) / g->price[i];
+            if (ratio > most)
+            {
+                most  = ratio;
+                best  = dest;
+                *item = (ratio > 1) ? i : -1;
+            }
+        }
+    }
+
+    return best;
+}
+
+/* Where what we carry should sell for most, or where the best run goes if
+ * we carry nothing. */
+static int best_market(const struct game_state *g)
+{
+    int  i,
+         dest,
+         best,
+         item;
+    long worth,
+         most = 0;
+
+    best = best_run(g, 0, &item);
+    for (dest = 1; dest <= 7; dest++)
+    {
+        if (dest == g->port)
+        {
+            continue;
+        }
+        for (worth = 0, i = 0; i < 4; i++)
+        {
+            worth += g->hold_[i] * game_mean_price(i, dest);
+        }
+        if (worth > most)
+        {
+            most = worth;
+            best = dest;
+        }
+    }
+
+    return best;
+}
+
+/* ------------------------------------------------------------------------ *
+ * trader: taipan-sim's own.  Buys whatever is cheap, sells everything at
+ * the next port, keeps its money in the bank, hurries home to pay Wu
+ * while it owes him anything, fights when it has guns and runs when it
+ * does not, and retires as soon as it can.
+ * ------------------------------------------------------------------------ */
+
+/* Roughly what a unit of each good costs: prices run from 5 to 24 times
+ * this, 13 on average. */
+static long unit[] = { 1000, 100, 10, 1 };
+
+/* Cash the trader keeps back from Wu. */
+#define FLOAT 1000
+
+/* Pays Wu what we can, keeping enough back to trade with. */
+static long trader_repay(struct player *p, const struct game_state *g)
+{
+    long spare = (long) g->cash - FLOAT;
+
+    return (spare > 0) ? least(spare, (long) g->debt) : 0;
+}
+
+static int trader_bailout(struct player *p, const struct game_state *g)
+{
+    return g->wu_bailout <= 3;
+}
+
+static int trader_upgrade(struct player *p, const struct game_state *g,
+                          int type)
+{
+    return g->offer <= g->cash / 4;
+}
+
+static long trader_buy(struct player *p, const struct game_state *g,
+                       int item)
+{
+    int i,
+        best = -1;
+
+    for (i = 0; i < 4; i++)
+    {
+        if ((g->price[i] < 12 * unit[i]) &&
+                ((best == -1) ||
+                 (g->price[i] * unit[best] < g->price[best] * unit[i])))
+        {
+            best = i;
+        }
+    }
+
+    return (item == best) ? fill(g, item) : 0;
+}
+
+static int trader_destination(struct player *p, const struct game_state *g)
+{
+    int dest;
+
+    if ((g->port != 1) && ((g->debt > 0) || (g->cash + g->bank >= 1000000)))
+    {
+        /* Home to pay Wu, or to retire. */
+        return 1;
+    }
+
+    do
+    {
+        dest = rng_below(&p->rng, 7) + 1;
+    } while (dest == g->port);
+
+    return dest;
+}
+
+static const struct policy trader =
+{
+    .name         = "trader",
+    .about        = "buys what is cheap, sails at random, pays Wu first",
+    .li_yuen      = afford_li_yuen,
+    .mchenry      = half_cash_repair,
+    .bailout      = trader_bailout,
+    .wu_repay     = trader_repay,
+    .upgrade      = trader_upgrade,
+    .sell         = all_of,
+    .withdraw     = all,
+    .retire       = yes,
+    .buy          = trader_buy,
+    .deposit      = all,
+    .destination  = trader_destination,
+    .orders       = fight_or_run,
+    .jettison     = everything
+};
+
+/* ------------------------------------------------------------------------ *
+ * random: answers every question at random, within what the prompt would
+ * take.  The floor any strategy should clear.
+ * ------------------------------------------------------------------------ */
+
+static int coin(struct player *p)
+{
+    return rng_below(&p->rng, 2);
+}
+
+/* Some of n, from none to all. */
+static long some(struct player *p, long n)
+{
+    return (n > 0) ? (long) (rng_float(&p->rng) * n) : 0;
+}
+
+static int random_coin(struct player *p, const struct game_state *g)
+{
+    return coin(p);
+}
+
+static int random_covers(struct player *p, const struct game_state *g,
+                         long shortfall)
+{
+    return coin(p);
+}
+
+static long random_repair(struct player *p, const struct game_state *g,
+                          long quote)
+{
+    return some(p, quote);
+}
+
+static long random_repay(struct player *p, const struct game_state *g)
+{
+    return some(p, least(g->cash, g->debt));
+}
+
+static long random_borrow(struct player *p, const struct game_state *g)
+{
+    return (rng_below(&p->rng, 4) == 0) ? some(p, (long) g->cash * 2) : 0;
+}
+
+static int random_upgrade(struct player *p, const struct game_state *g,
+                          int type)
+{
+    return coin(p);
+}
+
+static long random_sell(struct player *p, const struct game_state *g,
+                        int item)
+{
+    return some(p, g->hold_[item]);
+}
+
+static long random_withdraw(struct player *p, const struct game_state *g)
+{
+    return some(p, g->bank);
+}
+
+static long random_to_ship(struct player *p, const struct game_state *g,
+                           int item)
+{
+    return some(p, g->hkw_[item]);
+}
+
+static long random_buy(struct player *p, const struct game_state *g,
+                       int item)
+{
+    return some(p, fill(g, item));
+}
+
+static long random_deposit(struct player *p, const struct game_state *g)
+{
+    return some(p, g->cash);
+}
+
+static int random_destination(struct player *p, const struct game_state *g)
+{
+    return rng_below(&p->rng, 7) + 1;
+}
+
+static int random_orders(struct player *p, const struct game_state *g)
+{
+    return rng_below(&p->rng, 3) + ORDERS_FIGHT;
+}
+
+static int random_jettison(struct player *p, const struct game_state *g,
+                           long *amount)
+{
+    int item = rng_below(&p->rng, 5);
+
+    *amount = (item < 4) ? some(p, g->hold_[item]) : -1;
+    return item;
+}
+
+static const struct policy random_policy =
+{
+    .name         = "random",
+    .about        = "answers everything at random",
+    .cash         = random_coin,
+    .li_yuen      = random_coin,
+    .mchenry      = random_repair,
+    .wu_covers    = random_covers,
+    .bailout      = random_coin,
+    .wu_repay     = random_repay,
+    .wu_borrow    = random_borrow,
+    .upgrade      = random_upgrade,
+    .sell         = random_sell,
+    .withdraw     = random_withdraw,
+    .retire       = random_coin,
+    .to_ship      = random_to_ship,
+    .buy          = random_buy,
+    .to_warehouse = random_sell,
+    .deposit      = random_deposit,
+    .destination  = random_destination,
+    .orders       = random_orders,
+    .jettison     = random_jettison
+};
+
+/* ------------------------------------------------------------------------ *
+ * greedy: arbitrage.  Sells everything, and puts every tael into the one
+ * good that should fetch most over its price somewhere else, then sails
+ * there.  Only goes home to pay Wu off, which it does the moment it can
+ * do so in full, or to retire; banks nothing and borrows nothing.
+ * ------------------------------------------------------------------------ */
+
+/* Whether the next voyage must be home: to pay Wu, or to retire. */
+static int greedy_home(const struct game_state *g)
+{
+    return (g->port != 1) &&
+        ((g->debt > 0) || ((long long) g->cash + g->bank >= 1000000));
+}
+
+static long greedy_repay(struct player *p, const struct game_state *g)
+{
+    return (g->cash >= g->debt) ? -1 : 0;
+}
+
+static int greedy_upgrade(struct player *p, const struct game_state *g,
+                          int type)
+{
+    return (type == EV_NEW_SHIP) && (g->offer <= g->cash / 2);
+}
+
+static long greedy_buy(struct player *p, const struct game_state *g,
+                       int item)
+{
+    int best;
+
+    if ((g->port != 1) && ((long long) g->cash + g->bank >= 1000000))
+    {
+        return 0;  /* Keep it all to retire on. */
+    }
+    best_run(g, greedy_home(g), &best);
+
+    return (item == best) ? fill(g, item) : 0;
+}
+
+static int greedy_destination(struct player *p, const struct game_state *g)
+{
+    return greedy_home(g) ? 1 : best_market(g);
+}
+
+static const struct policy greedy =
+{
+    .name         = "greedy",
+    .about        = "all in on the best arbitrage, every voyage",
+    .li_yuen      = afford_li_yuen,
+    .mchenry      = half_cash_repair,
+    .bailout      = yes,
+    .wu_repay     = greedy_repay,
+    .upgrade      = greedy_upgrade,
+    .sell         = all_of,
+    .withdraw     = all,
+    .retire       = yes,
+    .buy          = greedy_buy,
+    .destination  = greedy_destination,
+    .orders       = fight_or_run,
+    .jettison     = everything
+};
+
+/* ------------------------------------------------------------------------ *
+ * cautious: the same runs as greedy, with no more than half its cash
+ * once Wu is paid off.  Always pays Li Yuen, having Wu make up what is
+ * short if the bank can pay him back, and McHenry all it can; banks what
+ * it does not trade with but for what Li Yuen may ask, borrows nothing
+ * else of Wu but a bailout, and buys no guns.  Heads home to pay Wu off
+ * once it can, whenever Li Yuen's protection lapses, and when carrying
+ * much cash or badly damaged; only fights fleets no bigger than its guns,
+ * and throws the cargo overboard to get away when the ship is in a bad
+ * way.
+ * ------------------------------------------------------------------------ */
+
+/* More cash than this is asking to be robbed. */
+#define CAUTIOUS_CASH 25000
+
+/* Cash kept out of the bank for each month played: past the first year
+ * Li Yuen asks for up to 2000 a month on top of a share of the cash, and
+ * he asks on arriving, before there is a chance to go to the bank. */
+#define CAUTIOUS_LI   2000L
+
+static int cautious_home(const struct game_state *g)
+{
+    return (g->port != 1) &&
+        (((g->debt > 0) && (g->cash >= g->debt)) || (g->li == 0) ||
+         (g->cash > CAUTIOUS_CASH) || (g->damage * 4 > g->capacity));
+}
+
+/* All of it if we can, else what cash we have. */
+static long cautious_repair(struct player *p, const struct game_state *g,
+                            long quote)
+{
+    return (quote <= (long) g->cash) ? -1 : (long) g->cash;
+}
+
+/* What Wu makes up for Li Yuen comes straight out of the bank at home. */
+static int cautious_covers(struct player *p, const struct game_state *g,
+                           long shortfall)
+{
+    return shortfall <= (long) g->bank;
+}
+
+static int cautious_upgrade(struct player *p, const struct game_state *g,
+                            int type)
+{
+    return (type == EV_NEW_SHIP) && (g->offer <= g->cash / 3);
+}
+
+static long cautious_buy(struct player *p, const struct game_state *g,
+                         int item)
+{
+    int best;
+
+    best_run(g, cautious_home(g), &best);
+    if (item != best)
+    {
+        return 0;
+    }
+
+    if (g->debt > 0)
+    {
+        return fill(g, item);  /* Wu's interest is the worst risk of all. */
+    }
+
+    return least(fill(g, item), (long) (g->cash / 2 / g->price[item]));
+}
+
+static long cautious_deposit(struct player *p, const struct game_state *g)
+{
+    long keep = CAUTIOUS_LI * game_months(g);
+
+    return ((long) g->cash > keep) ? (long) g->cash - keep : 0;
+}
+
+static int cautious_destination(struct player *p, const struct game_state *g)
+{
+    return cautious_home(g) ? 1 : best_market(g);
+}
+
+static int cautious_orders(struct player *p, const struct game_state *g)
+{
+    if ((game_status(g) < 50) && (g->hold_[0] + g->hold_[1] +
+                g->hold_[2] + g->hold_[3] > 0))
+    {
+        return ORDERS_THROW;
+    }
+
+    return ((g->guns > 0) && (g->battle.num_ships <= g->guns)) ?
+        ORDERS_FIGHT : ORDERS_RUN;
+}
+
+static const struct policy cautious =
+{
+    .name         = "cautious",
+    .about        = "half the cash at most, home often, runs from a fight",
+    .li_yuen      = yes,
+    .mchenry      = cautious_repair,
+    .wu_covers    = cautious_covers,
+    .bailout      = yes,
+    .wu_repay     = greedy_repay,
+    .upgrade      = cautious_upgrade,
+    .sell         = all_of,
+    .withdraw     = all,
+    .retire       = yes,
+    .buy          = cautious_buy,
+    .deposit      = cautious_deposit,
+    .destination  = cautious_destination,
+    .orders       = cautious_orders,
+    .jettison     = everything
+};
+
+const struct policy *policies[] = { &trader, &random_policy, &greedy,
+    &cautious, NULL };
+
+const struct policy *policy_find(const char *name)
+{
+    int i;
+
+    for (i = 0; policies[i] != NULL; i++)
+    {
+        if (strcmp(policies[i]->name, name) == 0)
+        {
+            return policies[i];
+        }
+    }
+
+    return NULL;
+}
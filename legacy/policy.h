@@ -0,0 +1,93 @@
+/* ------------------------------------------------------------------------ *
+ * Players that need no keyboard.
+ *
+ * A policy answers each of the questions taipan.c puts to the keyboard,
+ * one function to a question, from a read-only look at the game.  The
+ * player_*() functions ask them in the order the prompts come and make
+ * the engine calls the answers call for, so any policy can be played
+ * anywhere the engine runs: in taipan-sim, in a search, or in a server.
+ *
+ * Any question a policy leaves NULL is answered "no" (or 0, or nothing),
+ * as the engine takes an unanswered question.  A policy with no orders
+ * sits out its battles, which does not end well.
+ * ------------------------------------------------------------------------ */
+
+#ifndef TAIPAN_POLICY_H
+#define TAIPAN_POLICY_H
+
+#include <stdint.h>
+
+#include "engine.h"
+#include "rng.h"
+
+struct player;
+
+struct policy
+{
+    const char *name,
+               *about;
+
+    /* cash_or_guns(): 1 for cash (and a debt), 0 for guns.  NULL takes
+     * the cash, as taipan-sim always has. */
+    int  (*cash)(struct player *p, const struct game_state *g);
+
+    /* Arriving in Hong Kong. */
+    int  (*li_yuen)(struct player *p, const struct game_state *g);
+    long (*mchenry)(struct player *p, const struct game_state *g,
+                    long quote);
+    int  (*wu_covers)(struct player *p, const struct game_state *g,
+                      long shortfall);
+    int  (*bailout)(struct player *p, const struct game_state *g);
+    long (*wu_repay)(struct player *p, const struct game_state *g);
+    long (*wu_borrow)(struct player *p, const struct game_state *g);
+
+    /* EV_NEW_SHIP or EV_NEW_GUN, with the price in g->offer. */
+    int  (*upgrade)(struct player *p, const struct game_state *g, int type);
+
+    /* port_choices(), asked in this order.  Amounts of -1 mean "all".
+     * The bank and the warehouse are only asked about in Hong Kong, and
+     * there wu_repay() is asked again once the cargo is sold. */
+    long (*sell)(struct player *p, const struct game_state *g, int item);
+    long (*withdraw)(struct player *p, const struct game_state *g);
+    int  (*retire)(struct player *p, const struct game_state *g);
+    long (*to_ship)(struct player *p, const struct game_state *g, int item);
+    long (*buy)(struct player *p, const struct game_state *g, int item);
+    long (*to_warehouse)(struct player *p, const struct game_state *g,
+                         int item);
+    long (*deposit)(struct player *p, const struct game_state *g);
+    int  (*destination)(struct player *p, const struct game_state *g);
+
+    /* sea_battle(): ORDERS_*, asked each round and whenever the orders
+     * may change; and what to throw overboard, 4 for everything. */
+    int  (*orders)(struct player *p, const struct game_state *g);
+    int  (*jettison)(struct player *p, const struct game_state *g,
+                     long *amount);
+};
+
+struct player
+{
+    const struct policy *policy;
+    struct rng          rng;        /* The player's own dice. */
+    void                *arg;       /* For the policy. */
+    long                decisions;  /* Questions answered so far. */
+};
+
+/* The reference policies, NULL-terminated. */
+extern const struct policy *policies[];
+
+const struct policy *policy_find(const char *name);
+
+/* Sets p up to play policy, throwing its dice from seed; arg starts NULL.
+ * The game's own stream is left alone, so the same seeds play the same
+ * game. */
+void player_init(struct player *p, const struct policy *policy,
+                 uint64_t seed);
+
+/* Starts g, asking p cash or guns. */
+void player_start(struct player *p, struct game_state *g);
+
+/* Answers whatever ev asks of p, if anything. */
+void player_answer(struct player *p, struct game_state *g,
+                   const struct game_event *ev);
+
+#endif /* TAIPAN_POLICY_H */
@@ -0,0 +1,197 @@
+/* ------------------------------------------------------------------------ *
+ * Work-stealing thread pool.  See pool.h.
+ * ------------------------------------------------------------------------ */
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "pool.h"
+
+/* What one thread has left to do: jobs [next, end). */
+struct share
+{
+    pthread_mutex_t lock;
+    long            next,
+                    end;
+};
+
+struct pool
+{
+    struct share *shares;
+    int          threads;
+    void         (*job)(long i, void *arg);
+    void         *arg;
+};
+
+struct worker
+{
+    struct pool *pool;
+    int         id;
+};
+
+/* Takes the next job from the front of our own share. */
+static int take(struct share *s, long *i)
+{
+    int got = 0;
+
+    pthread_mutex_lock(&s->lock);
+    if (s->next < s->end)
+    {
+        *i = s->next++;
+        got = 1;
+    }
+    pthread_mutex_unlock(&s->lock);
+
+    return got;
+}
+
+/* Moves the back half of the fullest other share into ours.  Returns 0
+ * once there is nothing left anywhere. */
+static int steal(struct pool *p, int self)
+{
+    struct share *mine = &p->shares[self];
+
+    for (;;)
+    {
+        struct share *victim = NULL;
+        long         most = 0,
+                     lo,
+                     hi;
+        int          t;
+
+        /* The share may shrink before we lock it again; checked below. */
+        for (t = 0; t < p->threads; t++)
+        {
+            struct share *s = &p->shares[t];
+            long left;
+
+            if (t == self)
+            {
+                continue;
+            }
+            pthread_mutex_lock(&s->lock);
+            left = s->end - s->next;
+            pthread_mutex_unlock(&s->lock);
+            if (left > most)
+            {
+                most = left;
+                victim = s;
+            }
+        }
+        if (victim == NULL)
+        {
+            return 0;
+        }
+
+        pthread_mutex_lock(&victim->lock);
+        hi = victim->end;
+        lo = hi - (hi - victim->next + 1) / 2;
+        if (lo >= hi)
+        {
+            /* Someone else got there first; look again. */
+            pthread_mutex_unlock(&victim->lock);
+            continue;
+        }
+        victim->end = lo;
+        pthread_mutex_unlock(&victim->lock);
+
+        pthread_mutex_lock(&mine->lock);
+        mine->next = lo;
+        mine->end  = hi;
+        pthread_mutex_unlock(&mine->lock);
+
+        return 1;
+    }
+}
+
+static void *work(void *arg)
+{
+    struct worker *w = arg;
+    struct pool   *p = w->pool;
+    long          i;
+
+    do
+    {
+        while (take(&p->shares[w->id], &i))
+        {
+            p->job(i, p->arg);
+        }
+    } while (steal(p, w->id));
+
+    return NULL;
+}
+
+int pool_cpus(void)
+{
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+
+    return (n < 1) ? 1 : (int) n;
+}
+
+int pool_run(int threads, long n, void (*job)(long i, void *arg), void *arg)
+{
+    struct pool   p;
+    struct worker *workers;
+    pthread_t     *tids;
+    int           t,
+                  started;
+
+    if (threads <= 0)
+    {
+        threads = pool_cpus();
+    }
+    if (threads > n)
+    {
+        threads = (n > 0) ? (int) n : 1;
+    }
+
+    p.threads = threads;
+    p.job     = job;
+    p.arg     = arg;
+    p.shares  = calloc(threads, sizeof(*p.shares));
+    workers   = calloc(threads, sizeof(*workers));
+    tids      = calloc(threads, sizeof(*tids));
+    if ((p.shares == NULL) || (workers == NULL) || (tids == NULL))
+    {
+        free(p.shares);
+        free(workers);
+        free(tids);
+        return -1;
+    }
+
+    for (t = 0; t < threads; t++)
+    {
+        pthread_mutex_init(&p.shares[t].lock, NULL);
+        p.shares[t].next = n * t / threads;
+        p.shares[t].end  = n * (t + 1) / threads;
+        workers[t].pool  = &p;
+        workers[t].id    = t;
+    }
+
+    /* Thread 0 is this one. */
+    for (started = 1; started < threads; started++)
+    {
+        if (pthread_create(&tids[started], NULL, work, &workers[started]) != 0)
+        {
+            break;
+        }
+    }
+    work(&workers[0]);
+    for (t = 1; t < started; t++)
+    {
+        pthread_join(tids[t], NULL);
+    }
+
+    /* A thread that would not start is no loss: its share was stolen. */
+
+    for (t = 0; t < threads; t++)
+    {
+        pthread_mutex_destroy(&p.shares[t].lock);
+    }
+    free(p.shares);
+    free(workers);
+    free(tids);
+
+    return 0;
+}
@@ -0,0 +1,21 @@
+/* ------------------------------------------------------------------------ *
+ * A work-stealing thread pool for running many independent jobs, such as
+ * whole games, that take wildly different amounts of time.
+ *
+ * Jobs are numbered 0 to n - 1.  Each thread starts with an even share of
+ * them and works from the front of its share; a thread that runs dry
+ * steals the back half of the largest share left.  Which thread runs a
+ * job is not fixed, so a job must depend only on its number.
+ * ------------------------------------------------------------------------ */
+
+#ifndef TAIPAN_POOL_H
+#define TAIPAN_POOL_H
+
+/* Calls job(i, arg) once for each i in [0, n), using threads threads (0
+ * for one per online CPU).  Returns 0, or -1 if out of memory. */
+int pool_run(int threads, long n, void (*job)(long i, void *arg), void *arg);
+
+/* One per online CPU, and at least 1. */
+int pool_cpus(void);
+
+#endif /* TAIPAN_POOL_H */
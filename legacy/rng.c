@@ -0,0 +1,74 @@
+/* ------------------------------------------------------------------------ *
+ * xoshiro256** and friends.  See rng.h.
+ * ------------------------------------------------------------------------ */
+
+#include <assert.h>
+
+#include "rng.h"
+
+static uint64_t rotl(uint64_t x, int k)
+{
+    return (x << k) | (x >> (64 - k));
+}
+
+/* splitmix64, to spread any seed (even 0) over the whole state. */
+void rng_seed(struct rng *r, uint64_t seed)
+{
+    int i;
+
+    for (i = 0; i < 4; i++)
+    {
+        uint64_t z = (seed += 0x9e3779b97f4a7c15ULL);
+
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        r->s[i] = z ^ (z >> 31);
+    }
+}
+
+uint64_t rng_next(struct rng *r)
+{
+    uint64_t *s = r->s,
+             result = rotl(s[1] * 5, 7) * 9,
+             t = s[1] << 17;
+
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rotl(s[3], 45);
+
+    return result;
+}
+
+/* A number in [0, bound) with no modulo bias (Lemire's method).  Replaces
+ * rand()%bound; the bound must be positive, as it always had to be. */
+uint32_t rng_below(struct rng *r, uint32_t bound)
+{
+    uint64_t m;
+    uint32_t low;
+
+    assert(bound > 0);
+
+    m   = (rng_next(r) >> 32) * (uint64_t) bound;
+    low = (uint32_t) m;
+    if (low < bound)
+    {
+        uint32_t threshold = -bound % bound;
+
+        while (low < threshold)
+        {
+            m   = (rng_next(r) >> 32) * (uint64_t) bound;
+            low = (uint32_t) m;
+        }
+    }
+
+    return m >> 32;
+}
+
+/* A number in [0, 1], as (float) rand() / RAND_MAX was. */
+float rng_float(struct rng *r)
+{
+    return (float) (rng_next(r) >> 40) / ((1 << 24) - 1);
+}
@@ -0,0 +1,24 @@
+/* ------------------------------------------------------------------------ *
+ * Random numbers for the engine.
+ *
+ * xoshiro256** (Blackman and Vigna), seeded through splitmix64.  Each game
+ * carries its own stream, so a game played from the same seed always comes
+ * out the same, whatever else is running alongside it.
+ * ------------------------------------------------------------------------ */
+
+#ifndef TAIPAN_RNG_H
+#define TAIPAN_RNG_H
+
+#include <stdint.h>
+
+struct rng
+{
+    uint64_t s[4];
+};
+
+void     rng_seed(struct rng *r, uint64_t seed);
+uint64_t rng_next(struct rng *r);
+uint32_t rng_below(struct rng *r, uint32_t bound);
+float    rng_float(struct rng *r);
+
+#endif /* TAIPAN_RNG_H */
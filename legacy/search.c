@@ -0,0 +1,767 @@
+/* ------------------------------------------------------------------------ *
+ * Expectimax over voyages.  See search.h.
+ * ------------------------------------------------------------------------ */
+
+#include <math.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "pool.h"
+#include "search.h"
+
+/* The figures a position is made of, and hashed on: everything the model
+ * reads, so that the table can be kept from move to move and game to
+ * game.  (The enemy's health it reckons from the months.) */
+enum
+{
+    F_PORT,
+    F_MONTHS,
+    F_CASH,
+    F_BANK,
+    F_DEBT,
+    F_HOLD,                 /* hold_[4] */
+    F_HKW = F_HOLD + 4,     /* hkw_[4] */
+    F_GUNS = F_HKW + 4,
+    F_CAPACITY,
+    F_DAMAGE,
+    F_LI,
+    F_BP,                   /* Pirates one voyage in this many. */
+    FIELDS
+};
+
+struct node
+{
+    uint64_t hash;
+    int64_t  f[FIELDS];
+};
+
+/* Lines less likely than this are not looked into further. */
+#define UNLIKELY 1e-3
+
+/* A key for each byte of each figure.  A zero byte above the lowest has
+ * no key, so small figures hash in a lookup or two. */
+static uint64_t       zobrist[FIELDS][8][256];
+static pthread_once_t zobrist_once = PTHREAD_ONCE_INIT;
+
+static void zobrist_init(void)
+{
+    struct rng r;
+    int        f,
+               b,
+               v;
+
+    rng_seed(&r, 0x7a1fa9);
+    for (f = 0; f < FIELDS; f++)
+    {
+        for (b = 0; b < 8; b++)
+        {
+            for (v = (b > 0); v < 256; v++)
+            {
+                zobrist[f][b][v] = rng_next(&r);
+            }
+        }
+    }
+}
+
+static uint64_t key(int field, int64_t value)
+{
+    uint64_t u = value,
+             h = zobrist[field][0][u & 255];
+    int      b;
+
+    for (b = 1, u >>= 8; u != 0; b++, u >>= 8)
+    {
+        h ^= zobrist[field][b][u & 255];
+    }
+
+    return h;
+}
+
+static void set(struct node *n, int field, int64_t value)
+{
+    if (n->f[field] != value)
+    {
+        n->hash ^= key(field, n->f[field]) ^ key(field, value);
+        n->f[field] = value;
+    }
+}
+
+static void add(struct node *n, int field, int64_t amount)
+{
+    set(n, field, n->f[field] + amount);
+}
+
+static void from_game(struct node *n, const struct game_state *g)
+{
+    int k;
+
+    n->f[F_PORT]     = g->port;
+    n->f[F_MONTHS]   = game_months(g);
+    n->f[F_CASH]     = g->cash;
+    n->f[F_BANK]     = g->bank;
+    n->f[F_DEBT]     = g->debt;
+    for (k = 0; k < 4; k++)
+    {
+        n->f[F_HOLD + k] = g->hold_[k];
+        n->f[F_HKW + k]  = g->hkw_[k];
+    }
+    n->f[F_GUNS]     = g->guns;
+    n->f[F_CAPACITY] = g->capacity;
+    n->f[F_DAMAGE]   = g->damage;
+    n->f[F_LI]       = g->li;
+    n->f[F_BP]       = (g->bp > 0) ? g->bp : 1;
+
+    n->hash = 0;
+    for (k = 0; k < FIELDS; k++)
+    {
+        n->hash ^= key(k, n->f[k]);
+    }
+}
+
+/* ------------------------------------------------------------------------ *
+ * The transposition table.  An entry is two words, the value (and how it
+ * was searched) and that xored with the position's hash; a torn write
+ * between two threads shows up as a hash that does not match, and is
+ * taken as a miss.
+ *
+ * A value is good for as deep a search as it came from, unless lines
+ * under it were cut off as UNLIKELY.  Which lines are cut depends on how
+ * likely the position was to be reached, and that is not in the hash: so
+ * a value with lines cut stands only for a position no likelier than the
+ * one it was searched from, which would have had as many cut or more.
+ * ------------------------------------------------------------------------ */
+
+struct entry
+{
+    _Atomic uint64_t check,
+                     data;
+};
+
+/* The data: the value as a float in the low 32 bits, then 8 bits of
+ * depth, 1 that says lines were cut, and the chance it was searched at,
+ * as rank(). */
+#define DEPTH(data) ((int) ((data) >> 32) & 255)
+#define CUT(data)   ((int) ((data) >> 40) & 1)
+#define RANK(data)  ((long) ((data) >> 41))
+
+/* -log2(p) in sixteenths: rounded up for the chance an entry was searched
+ * at, and down for one it is asked for at, so that a rank no greater than
+ * another's is a chance no smaller. */
+static long rank(double p, int up)
+{
+    double r = -16 * log2(p);
+
+    return up ? (long) ceil(r) : (long) floor(r);
+}
+
+static uint64_t pack(double value, int depth, int cut, double p)
+{
+    float    v = value;
+    uint32_t bits;
+
+    memcpy(&bits, &v, sizeof(bits));
+
+    return ((uint64_t) (cut ? rank(p, 1) : 0) << 41) |
+        ((uint64_t) cut << 40) | ((uint64_t) depth << 32) | bits;
+}
+
+static double unpack(uint64_t data)
+{
+    uint32_t bits = (uint32_t) data;
+    float    v;
+
+    memcpy(&v, &bits, sizeof(v));
+
+    return v;
+}
+
+struct search
+{
+    struct entry            *table;
+    uint64_t                mask;
+    int                     threads;
+    const struct odds_table *odds;
+
+    /* The move being searched. */
+    const struct game_state *game;
+    int                     depth,
+                            actions,
+                            buy[1 + (5 * 6)],
+                            dest[1 + (5 * 6)];
+    double                  value[1 + (5 * 6)],
+                            deadline;   /* 0 for none. */
+    atomic_int              stop;
+    atomic_long             nodes;
+};
+
+/* A value for the position searched depth voyages on, reached with chance
+ * p; *cut says whether lines under it were cut off. */
+static int probe(struct search *s, uint64_t hash, int depth, double p,
+                 double *value, int *cut)
+{
+    struct entry *e = &s->table[hash & s->mask];
+    uint64_t     data = atomic_load_explicit(&e->data, memory_order_relaxed),
+                 check = atomic_load_explicit(&e->check, memory_order_relaxed);
+
+    if (((check ^ data) != hash) || (DEPTH(data) < depth) ||
+            (CUT(data) && (RANK(data) > rank(p, 0))))
+    {
+        return 0;
+    }
+    *value = unpack(data);
+    *cut   = CUT(data);
+
+    return 1;
+}
+
+static void store(struct search *s, uint64_t hash, int depth, int cut,
+                  double p, double value)
+{
+    struct entry *e = &s->table[hash & s->mask];
+    uint64_t     data = atomic_load_explicit(&e->data, memory_order_relaxed),
+                 check = atomic_load_explicit(&e->check, memory_order_relaxed);
+
+    /* Keep a deeper search of the same position, or as deep a one that
+     * cut off no more. */
+    if (((check ^ data) == hash) && ((DEPTH(data) > depth) ||
+                ((DEPTH(data) == depth) && cut &&
+                 (!CUT(data) || (RANK(data) <= rank(p, 1))))))
+    {
+        return;
+    }
+
+    data = pack(value, depth, cut, p);
+    atomic_store_explicit(&e->data, data, memory_order_relaxed);
+    atomic_store_explicit(&e->check, hash ^ data, memory_order_relaxed);
+}
+
+/* ------------------------------------------------------------------------ *
+ * The model.
+ * ------------------------------------------------------------------------ */
+
+/* One thread's walk through the tree. */
+struct walk
+{
+    struct search *s;
+    long          nodes,
+                  cuts;   /* Lines cut off as UNLIKELY so far. */
+};
+
+static double now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int stopped(struct walk *w)
+{
+    struct search *s = w->s;
+
+    if (((++w->nodes & 1023) == 0) && (s->deadline > 0) &&
+            (now() > s->deadline))
+    {
+        atomic_store_explicit(&s->stop, 1, memory_order_relaxed);
+    }
+
+    return atomic_load_explicit(&s->stop, memory_order_relaxed);
+}
+
+/* What the game would score ending here, times 100. */
+static double score(const struct node *n)
+{
+    return (double) (n->f[F_CASH] + n->f[F_BANK] - n->f[F_DEBT]) /
+        n->f[F_MONTHS];
+}
+
+static int64_t room(const struct node *n)
+{
+    return n->f[F_CAPACITY] - (10 * n->f[F_GUNS]) - n->f[F_HOLD] -
+        n->f[F_HOLD + 1] - n->f[F_HOLD + 2] - n->f[F_HOLD + 3];
+}
+
+/* Prices here: the game's own at the root, and their average beyond. */
+static long price_of(const struct node *n, const long *price, int item)
+{
+    return (price != NULL) ? price[item] :
+        game_mean_price(item, (int) n->f[F_PORT]);
+}
+
+/* Sells up and, in Hong Kong, draws out the bank and pays Wu off if the
+ * cash will do it. */
+static void settle(struct node *n, const long *price)
+{
+    int k;
+
+    for (k = 0; k < 4; k++)
+    {
+        if (n->f[F_HOLD + k] > 0)
+        {
+            add(n, F_CASH, n->f[F_HOLD + k] * price_of(n, price, k));
+            set(n, F_HOLD + k, 0);
+        }
+    }
+
+    if (n->f[F_PORT] == 1)
+    {
+        add(n, F_CASH, n->f[F_BANK]);
+        set(n, F_BANK, 0);
+        if ((n->f[F_DEBT] > 0) && (n->f[F_CASH] >= n->f[F_DEBT]))
+        {
+            add(n, F_CASH, -n->f[F_DEBT]);
+            set(n, F_DEBT, 0);
+        }
+    }
+}
+
+/* Fills the hold with item (if there is room, and cash for one), and in
+ * Hong Kong banks the rest.  Returns 0 if not one could be bought. */
+static int load(struct node *n, const long *price, int item)
+{
+    int64_t amount = 0;
+
+    if (item >= 0)
+    {
+        amount = n->f[F_CASH] / price_of(n, price, item);
+        if (amount > room(n))
+        {
+            amount = room(n);
+        }
+        if (amount <= 0)
+        {
+            return 0;
+        }
+        add(n, F_CASH, -amount * price_of(n, price, item));
+        add(n, F_HOLD + item, amount);
+    }
+
+    if (n->f[F_PORT] == 1)
+    {
+        add(n, F_BANK, n->f[F_CASH]);
+        set(n, F_CASH, 0);
+    }
+
+    return 1;
+}
+
+static int can_retire(const struct node *n)
+{
+    return (n->f[F_PORT] == 1) && (n->f[F_CASH] + n->f[F_BANK] >= 1000000);
+}
+
+static double decide(struct walk *w, const struct node *n, int depth,
+                     double p, const long *price);
+
+/* Arriving in port after the month has turned: sells the cargo for what
+ * set_prices() and good_prices() make it fetch, and decides from there. */
+static double land(struct walk *w, const struct node *from, int item,
+                   int port, int depth, double p)
+{
+    struct node n = *from;
+    int64_t     debt = n.f[F_DEBT],
+                bank = n.f[F_BANK];
+    double      value = 0,
+                chance[5],
+                price[5];
+    int         outcomes = 1,
+                robbed,
+                k;
+
+    set(&n, F_PORT, port);
+    add(&n, F_MONTHS, 1);
+    set(&n, F_DEBT, debt + (int64_t) (debt * 0.1));
+    set(&n, F_BANK, bank + (int64_t) (bank * 0.005));
+
+    /* Taken at their expected cost. */
+    if ((port == 1) && (n.f[F_DEBT] > 20000))
+    {
+        set(&n, F_CASH, n.f[F_CASH] * 4 / 5);  /* Wu's cutthroats. */
+    }
+    if ((port != 1) && (n.f[F_HOLD] > 0))
+    {
+        /* Opium seized one time in 18, and a fine of cash / 3.6. */
+        set(&n, F_HOLD, n.f[F_HOLD] * 17 / 18);
+        set(&n, F_CASH, n.f[F_CASH] - (int64_t) (n.f[F_CASH] / 64.8));
+    }
+
+    chance[0] = 1;
+    price[0]  = 0;
+    if ((item >= 0) && (n.f[F_HOLD + item] > 0))
+    {
+        double mean = game_mean_price(item, port);
+
+        /* rnd(3) + 1 halves, and one time in 9 one good in 4 crashes to a
+         * fifth or booms to 5 to 9 times. */
+        for (k = 0; k < 3; k++)
+        {
+            chance[k] = (1 - (1.0 / 36)) / 3;
+            price[k]  = mean / 2 * (k + 1);
+        }
+        chance[3] = 1.0 / 72;
+        price[3]  = mean / 5;
+        chance[4] = 1.0 / 72;
+        price[4]  = mean * 7;
+        outcomes = 5;
+    }
+
+    for (k = 0; k < outcomes; k++)
+    {
+        struct node sold = n;
+
+        if (item >= 0)
+        {
+            add(&sold, F_CASH, (int64_t) (sold.f[F_HOLD + item] * price[k]));
+            set(&sold, F_HOLD + item, 0);
+        }
+
+        /* Robbed one time in 20 of cash / 2.8, if carrying over 25000;
+         * before selling, but it comes to the same. */
+        robbed = (n.f[F_CASH] > 25000);
+        if (robbed)
+        {
+            struct node lighter = sold;
+
+            add(&lighter, F_CASH, -(int64_t) (n.f[F_CASH] / 2.8));
+            value += chance[k] / 20 *
+                decide(w, &lighter, depth - 1, p * chance[k] / 20, NULL);
+        }
+        value += chance[k] * (robbed ? 19.0 / 20 : 1) *
+            decide(w, &sold, depth - 1, p * chance[k], NULL);
+    }
+
+    return value;
+}
+
+/* The storm that blows us elsewhere, one voyage in 30. */
+static double arrive(struct walk *w, const struct node *n, int item,
+                     int dest, int depth, double p)
+{
+    double value;
+    int    port;
+
+    if (p / 180 < UNLIKELY)
+    {
+        w->cuts++;
+        return land(w, n, item, dest, depth, p);
+    }
+
+    value = 29.0 / 30 * land(w, n, item, dest, depth, p * 29 / 30);
+    for (port = 1; port <= 7; port++)
+    {
+        if (port != dest)
+        {
+            value += land(w, n, item, port, depth, p / 180) / 180;
+        }
+    }
+
+    return value;
+}
+
+/* A rough guess at a battle, for want of the odds table. */
+static void guess_odds(const struct node *n, int id, int ships,
+                       struct odds *o)
+{
+    double guns = n->f[F_GUNS],
+           worn = (double) n->f[F_DAMAGE] / n->f[F_CAPACITY],
+           lost = (0.03 + (0.3 * worn)) * ((id == LI_YUEN) ? 3 : 1),
+           won = (guns > 0) ? (1 - lost) * guns / (guns + ships) : 0;
+
+    if (lost > 1)
+    {
+        lost = 1;
+    }
+    o->lost        = lost * ODDS_ONE;
+    o->won         = won * ODDS_ONE;
+    o->fled        = ODDS_ONE - o->lost - o->won;
+    o->interrupted = 0;
+    o->damage      = 15;
+    o->guns_lost   = 0;
+}
+
+/* A battle with the average fleet, fought if we have guns. */
+static double battle(struct walk *w, const struct node *n, int item,
+                     int dest, int depth, double p, int id)
+{
+    struct odds_query q;
+    struct odds       guess;
+    const struct odds *o;
+    struct node       after = *n;
+    double            value,
+                      won,
+                      fled,
+                      damage;
+    int64_t           guns;
+
+    q.id        = id;
+    q.orders    = (n->f[F_GUNS] > 0) ? ORDERS_FIGHT : ORDERS_RUN;
+    q.guns      = n->f[F_GUNS];
+    q.damage    = n->f[F_DAMAGE];
+    q.capacity  = n->f[F_CAPACITY];
+    q.ec        = 20 + (10 * ((n->f[F_MONTHS] - 1) / 12));
+    q.num_ships = (id == LI_YUEN) ?
+        ((q.capacity / 5) + q.guns - 1) / 2 + 5 :
+        ((q.capacity / 10) + q.guns + 1) / 2;
+
+    if (w->s->odds != NULL)
+    {
+        o = odds_lookup(w->s->odds, &q);
+    } else {
+        guess_odds(n, id, q.num_ships, &guess);
+        o = &guess;
+    }
+    won  = (double) o->won / ODDS_ONE;
+    fled = (double) (o->fled + o->interrupted) / ODDS_ONE;
+
+    /* Sunk: the game ends, with what we had. */
+    value = (double) o->lost / ODDS_ONE * score(n);
+
+    damage = o->damage * q.capacity / 100;
+    if (damage > q.capacity - 1 - q.damage)
+    {
+        damage = q.capacity - 1 - q.damage;
+    }
+    guns = n->f[F_GUNS] - (int64_t) (o->guns_lost + 0.5);
+    add(&after, F_DAMAGE, (int64_t) damage);
+    set(&after, F_GUNS, (guns > 0) ? guns : 0);
+
+    if (fled > 0)
+    {
+        value += fled * arrive(w, &after, item, dest, depth, p * fled);
+    }
+    if (won > 0)
+    {
+        add(&after, F_CASH, ((n->f[F_MONTHS] / 4) * 1000 * q.num_ships) + 750);
+        value += won * arrive(w, &after, item, dest, depth, p * won);
+    }
+
+    return value;
+}
+
+/* quit(): pirates one voyage in bp, and Li Yuen's fleet one in 4 of the
+ * rest while he is not paid off. */
+static double voyage(struct walk *w, const struct node *n, int item,
+                     int dest, int depth, double p)
+{
+    double pirates = 1.0 / n->f[F_BP],
+           li = (n->f[F_LI] == 0) ? (1 - pirates) / 4 : 0,
+           calm = 1 - pirates - li,
+           value;
+
+    value = calm * arrive(w, n, item, dest, depth, p * calm);
+    value += pirates * battle(w, n, item, dest, depth, p * pirates, GENERIC);
+    if (li > 0)
+    {
+        value += li * battle(w, n, item, dest, depth, p * li, LI_YUEN);
+    }
+
+    return value;
+}
+
+/* The best the firm can expect from n, depth voyages on. */
+static double decide(struct walk *w, const struct node *n, int depth,
+                     double p, const long *price)
+{
+    struct node settled = *n;
+    double      best,
+                value;
+    long        cuts = w->cuts;
+    int         item,
+                dest,
+                cut;
+
+    if (depth == 0)
+    {
+        return score(n);
+    }
+    if (p < UNLIKELY)
+    {
+        w->cuts++;
+        return score(n);
+    }
+    if (stopped(w))
+    {
+        return 0;
+    }
+    if (probe(w->s, n->hash, depth, p, &value, &cut))
+    {
+        w->cuts += cut;
+        return value;
+    }
+
+    settle(&settled, price);
+    best = can_retire(&settled) ? score(&settled) : -1e300;
+    for (item = -1; item < 4; item++)
+    {
+        struct node loaded = settled;
+
+        if (!load(&loaded, price, item))
+        {
+            continue;
+        }
+        for (dest = 1; dest <= 7; dest++)
+        {
+            if (dest == n->f[F_PORT])
+            {
+                continue;
+            }
+            value = voyage(w, &loaded, item, dest, depth, p);
+            if (value > best)
+            {
+                best = value;
+            }
+        }
+    }
+
+    if (!atomic_load_explicit(&w->s->stop, memory_order_relaxed))
+    {
+        store(w->s, n->hash, depth, w->cuts != cuts, p, best);
+    }
+
+    return best;
+}
+
+/* ------------------------------------------------------------------------ *
+ * The root.  Each move there is a job for the pool.
+ * ------------------------------------------------------------------------ */
+
+static void root_move(long i, void *arg)
+{
+    struct search *s = arg;
+    struct walk   w = { s, 0, 0 };
+    struct node   n;
+
+    from_game(&n, s->game);
+    settle(&n, s->game->price);
+    if (s->dest[i] == 0)
+    {
+        s->value[i] = score(&n);  /* Retire. */
+    } else {
+        load(&n, s->game->price, s->buy[i]);
+        s->value[i] = voyage(&w, &n, s->buy[i], s->dest[i], s->depth, 1);
+    }
+    atomic_fetch_add(&s->nodes, w.nodes);
+}
+
+struct search *search_new(int bits, int threads,
+                          const struct odds_table *odds)
+{
+    struct search *s = calloc(1, sizeof(*s));
+
+    pthread_once(&zobrist_once, zobrist_init);
+    if (s == NULL)
+    {
+        return NULL;
+    }
+    s->mask    = ((uint64_t) 1 << bits) - 1;
+    s->threads = (threads > 0) ? threads : pool_cpus();
+    s->odds    = odds;
+    s->table   = calloc(s->mask + 1, sizeof(*s->table));
+    if (s->table == NULL)
+    {
+        free(s);
+        return NULL;
+    }
+
+    return s;
+}
+
+void search_free(struct search *s)
+{
+    if (s != NULL)
+    {
+        free(s->table);
+        free(s);
+    }
+}
+
+int search_port(struct search *s, const struct game_state *g, long usec,
+                int depth, struct plan *plan)
+{
+    struct node n;
+    double      started = now();
+    int         item,
+                dest,
+                d,
+                i;
+
+    s->game    = g;
+    s->actions = 0;
+    atomic_store(&s->nodes, 0);
+
+    /* The moves there are: retiring, and each port with each good that
+     * there is money and room for. */
+    from_game(&n, g);
+    settle(&n, g->price);
+    if (can_retire(&n))
+    {
+        s->buy[s->actions]  = -1;
+        s->dest[s->actions] = 0;
+        s->actions++;
+    }
+    for (item = -1; item < 4; item++)
+    {
+        struct node loaded = n;
+
+        if (!load(&loaded, g->price, item))
+        {
+            continue;
+        }
+        for (dest = 1; dest <= 7; dest++)
+        {
+            if (dest != g->port)
+            {
+                s->buy[s->actions]  = item;
+                s->dest[s->actions] = dest;
+                s->actions++;
+            }
+        }
+    }
+
+    plan->buy   = -1;
+    plan->dest  = (g->port % 7) + 1;
+    plan->depth = 0;
+    plan->value = 0;
+    for (d = 1; d <= depth; d++)
+    {
+        /* The first voyage is always looked at in full. */
+        s->deadline = ((d > 1) && (usec > 0)) ? started + usec / 1e6 : 0;
+        s->depth    = d;
+        atomic_store(&s->stop, 0);
+        if (s->threads == 1)
+        {
+            for (i = 0; i < s->actions; i++)
+            {
+                root_move(i, s);
+            }
+        } else if (pool_run(s->threads, s->actions, root_move, s) != 0) {
+            return -1;
+        }
+        if (atomic_load(&s->stop))
+        {
+            break;
+        }
+
+        for (i = 0; i < s->actions; i++)
+        {
+            if ((i == 0) || (s->value[i] > plan->value))
+            {
+                plan->buy   = s->buy[i];
+                plan->dest  = s->dest[i];
+                plan->value = s->value[i];
+            }
+        }
+        plan->depth = d;
+        if ((usec > 0) && (now() > started + usec / 1e6))
+        {
+            break;
+        }
+    }
+    plan->nodes = atomic_load(&s->nodes);
+
+    return 0;
+}
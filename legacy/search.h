@@ -0,0 +1,62 @@
+/* ------------------------------------------------------------------------ *
+ * Looking a few voyages ahead: an expectimax search over what to buy and
+ * where to sail.
+ *
+ * The search plays a model of the game, not the engine itself: at each
+ * port the firm sells everything, settles with the bank and Wu, fills the
+ * hold with one good (or none) and sails, and each voyage branches on the
+ * chances quit() and main() give it: Li Yuen's and other pirates (won,
+ * fled or sunk, from the battle odds table where there is one), being
+ * blown off course, set_prices() and good_prices() for the good carried,
+ * and robbery.  Seizures and Wu's cutthroats are taken at their expected
+ * cost.  Prices further ahead than the next port are taken at their
+ * average.  A line is worth what it would score if the game ended there:
+ * net worth over months, as final_stats() reckons it.
+ *
+ * States are hashed Zobrist-fashion, a key per byte of each figure the
+ * model reads, and the hash is kept up as figures change.  Values found go
+ * into a fixed transposition table that the threads share without locks,
+ * and that is kept from move to move and game to game; a value with lines
+ * cut off as too unlikely under it is only taken for a position reached
+ * no more likely than it was.  The search deepens one voyage at a time
+ * until its time is up, and answers from the deepest search it finished.
+ * ------------------------------------------------------------------------ */
+
+#ifndef TAIPAN_SEARCH_H
+#define TAIPAN_SEARCH_H
+
+#include "engine.h"
+#include "odds.h"
+
+/* How far the search will look, in voyages. */
+#define SEARCH_DEPTH 6
+
+struct search;
+
+/* What to do at a port, with the rest as the search plays it: sell
+ * everything; in Hong Kong, take everything out of the bank and pay Wu
+ * off if the cash will do it; buy; and in Hong Kong bank what is left. */
+struct plan
+{
+    int    buy,     /* The good to fill the hold with, or -1. */
+           dest,    /* The port to sail for, or 0 to retire. */
+           depth;   /* Voyages looked ahead. */
+    double value;   /* The score expected then, times 100. */
+    long   nodes;   /* Positions looked at, in all. */
+};
+
+/* A search with a table of 2^bits entries (16 bytes each), run on threads
+ * threads (0 for one per CPU).  odds may be NULL, for a rough guess at how
+ * battles go.  NULL if we are out of memory. */
+struct search *search_new(int bits, int threads,
+                          const struct odds_table *odds);
+void          search_free(struct search *s);
+
+/* Plans g's next move, g waiting at EV_PORT: deepening up to depth
+ * voyages, and for no more than usec microseconds (none, if usec is 0)
+ * once the first voyage has been looked at.  Returns 0, or -1 if the
+ * threads could not be had. */
+int search_port(struct search *s, const struct game_state *g, long usec,
+                int depth, struct plan *plan);
+
+#endif /* TAIPAN_SEARCH_H */
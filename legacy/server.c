@@ -0,0 +1,1279 @@
+/* ------------------------------------------------------------------------ *
+ * taipan-server: Taipan for everyone who telnets in, all in one process.
+ *
+ * Each connection is a session playing a game of its own (see play.h).
+ * Where the game would block, for a key or for a pause in the show, the
+ * session sets a timer (see timer.h) and the one epoll loop carries on
+ * with the others; a key or the timer runs it again, and a key cancels
+ * the timer.  What the game draws in a run is written to the socket
+ * straight from the game's own buffer (see ansi.h), a frame at a time.
+ *
+ * A new connection is asked first for a resume code.  Given none, it
+ * gets a new game and the code for it.  A game whose connection drops is
+ * kept, stopped where it was, for a quarter of an hour, and a connection
+ * that gives its code takes it up: the player gets the whole screen as it
+ * was, and the game goes on from there.  A game still connected is not
+ * taken from its connection; TCP keepalives find one that has died
+ * without our hearing of it within a couple of minutes, and drop it.
+ *
+ * A code is 64 random bits, and no connection gets more than three tries
+ * at one, nor all of them together more than a few a minute.  A caller
+ * that does not say what it wants within a minute is sent away.
+ *
+ * Every game has a number, which its player is told.  With -w, a second
+ * port lets anyone watch a game: it lists the games being played and
+ * asks for a number, or takes the game going longest.  Each run's output is copied once into a frame shared by all
+ * the spectators, each of which sends it as its socket will take it; a
+ * spectator too far behind drops what it has not started on and picks
+ * up from a fresh copy of the whole screen.
+ * ------------------------------------------------------------------------ */
+
+#define _GNU_SOURCE
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/sockios.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/ioctl.h>
+#include <sys/random.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "play.h"
+#include "rng.h"
+#include "taipan.h"
+#include "timer.h"
+
+#define BACKLOG (256 * 1024)  /* Output we will hold for a slow client. */
+#define KEEP    (15 * 60 * 1000)  /* ms a dropped game is kept. */
+#define LINGER  (10 * 1000)   /* ms a finished game has to send its last. */
+#define FRAMES  64            /* Frames a spectator may fall behind by. */
+#define CODE    16            /* Hex digits in a resume code... */
+#define TRIES   3             /* ...the tries a connection gets at one... */
+#define MISSES  20            /* ...and the wrong ones taken a minute. */
+#define LOBBY   (60 * 1000)   /* ms a caller has to say what it wants. */
+
+/* Telnet. */
+#define IAC   255
+#define DONT  254
+#define DO    253
+#define WONT  252
+#define WILL  251
+#define SB    250
+#define SE    240
+#define ECHO  1
+#define SGA   3
+
+/* What epoll says is ready, from the int each of them starts with. */
+enum
+{
+    PLAYER,
+    SPECTATOR,
+    CALLER,      /* Not yet either. */
+    PLAYERS,     /* The port players connect to... */
+    SPECTATORS   /* ...and the one spectators do. */
+};
+
+struct port
+{
+    int kind,
+        fd;
+};
+
+/* A run's output, made once and sent as it is to every spectator. */
+struct frame
+{
+    int    refs;
+    size_t len;
+    char   bytes[];
+};
+
+struct spectator
+{
+    int              kind;
+    int              fd;          /* -1 once closed. */
+    struct session   *game;
+
+    struct frame     *frames[FRAMES];  /* To send, oldest first... */
+    int              first,
+                     count;
+    size_t           sent,        /* ...of which this much of the first
+                                   * is gone... */
+                     queued;      /* ...and this much of them all isn't. */
+
+    struct spectator *next;       /* Watching the same game, or closed. */
+};
+
+struct session
+{
+    int            kind;
+    int            fd;        /* -1 while the game waits for its player. */
+    int            id;        /* For spectators to pick it by. */
+    char           code[CODE + 1];  /* To take the game up again with. */
+    struct timer   timer;     /* The end of the game's wait, or of the
+                               * time its player has to come back. */
+
+    struct play    play;
+
+    int            telnet,    /* Where we are in a telnet command. */
+                   cr;        /* The last byte was a carriage return. */
+
+    struct spectator *spectators;
+    size_t         fanned;    /* Of the game's output, what is in frames
+                               * for them already. */
+
+    struct session *next;
+};
+
+/* A new connection, asked what game it wants to play or watch. */
+struct caller
+{
+    int           kind;
+    int           fd;         /* -1 once gone. */
+    int           watching;   /* Came in on the spectators' port. */
+    int           telnet,
+                  cr;
+
+    char          line[CODE + 1];  /* What has been typed. */
+    int           len,
+                  tries;
+    int           id;
+    char          code[CODE + 1];  /* A new game's, once given one; any
+                                    * key then starts it. */
+    struct timer  timer;      /* Its time to say what it wants. */
+
+    int           ready;      /* Has said its say, and is on ready. */
+    struct caller *next;
+};
+
+static struct session   *sessions;
+static struct spectator *closed;  /* To free once epoll is done with them. */
+static struct caller    *ready;   /* To answer once epoll is done with the
+                                   * batch. */
+static struct rng       codes;    /* Should getrandom() fail us. */
+static int              misses;   /* Wrong codes given this minute... */
+static struct timer     amnesty;  /* ...until this forgets them. */
+static int              games;    /* Numbered so far. */
+static int              epfd;
+static struct wheel     wheel;
+static uint64_t         seed;
+
+static const unsigned char hello[] = { IAC, WILL, ECHO, IAC, WILL, SGA };
+
+static uint64_t now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ((uint64_t) ts.tv_sec * 1000) + (ts.tv_nsec / 1000000);
+}
+
+/* Has epoll say when fd, for conn, can be read, and written if out. */
+static void watch(int fd, void *conn, int out)
+{
+    struct epoll_event ev;
+
+    ev.events   = EPOLLIN | (out ? EPOLLOUT : 0);
+    ev.data.ptr = conn;
+    epoll_ctl(epfd, EPOLL_CTL_MOD, fd, &ev);
+}
+
+/* ------------------------------------------------------------------------ *
+ * Spectators.
+ * ------------------------------------------------------------------------ */
+
+/* A frame, held by its maker until it lets go with release(). */
+static struct frame *new_frame(const char *bytes, size_t len)
+{
+    struct frame *f = malloc(sizeof(*f) + len);
+
+    if (f != NULL)
+    {
+        f->refs = 1;
+        f->len  = len;
+        memcpy(f->bytes, bytes, len);
+    }
+
+    return f;
+}
+
+static void release(struct frame *f)
+{
+    if (--f->refs == 0)
+    {
+        free(f);
+    }
+}
+
+static void close_spectator(struct spectator *v)
+{
+    struct spectator **p;
+
+    for (p = &v->game->spectators; *p != v; p = &(*p)->next)
+    {
+        ;
+    }
+    *p = v->next;
+
+    while (v->count > 0)
+    {
+        release(v->frames[v->first]);
+        v->first = (v->first + 1) % FRAMES;
+        v->count--;
+    }
+    close(v->fd);
+    v->fd = -1;
+
+    v->next = closed;
+    closed  = v;
+}
+
+/* Sends what the socket will take of v's frames, all in one go.  Returns
+ * -1 if the spectator has gone. */
+static int send_frames(struct spectator *v)
+{
+    struct iovec iov[FRAMES];
+    struct frame *f;
+    ssize_t      n;
+    int          i;
+
+    if (v->count > 0)
+    {
+        for (i = 0; i < v->count; i++)
+        {
+            f = v->frames[(v->first + i) % FRAMES];
+            iov[i].iov_base = f->bytes;
+            iov[i].iov_len  = f->len;
+        }
+        iov[0].iov_base = (char *) iov[0].iov_base + v->sent;
+        iov[0].iov_len -= v->sent;
+
+        n = writev(v->fd, iov, v->count);
+        if (n < 0)
+        {
+            if ((errno != EAGAIN) && (errno != EWOULDBLOCK))
+            {
+                return -1;
+            }
+            n = 0;
+        }
+
+        v->queued -= n;
+        n += v->sent;
+        while ((v->count > 0) && (n >= (ssize_t) v->frames[v->first]->len))
+        {
+            n -= v->frames[v->first]->len;
+            release(v->frames[v->first]);
+            v->first = (v->first + 1) % FRAMES;
+            v->count--;
+        }
+        v->sent = n;
+    }
+
+    watch(v->fd, v, v->count > 0);
+
+    return 0;
+}
+
+static int add_frame(struct spectator *v, struct frame *f)
+{
+    if (v->count == FRAMES)
+    {
+        return -1;
+    }
+    f->refs++;
+    v->frames[(v->first + v->count++) % FRAMES] = f;
+    v->queued += f->len;
+
+    return 0;
+}
+
+/* A spectator too far behind to catch up frame by frame: finish the frame
+ * it is part way through, if it is, then skip to the screen as it is. */
+static int catch_up(struct spectator *v)
+{
+    struct frame *f;
+    char         *snap;
+    size_t       len;
+
+    while (v->count > ((v->sent > 0) ? 1 : 0))
+    {
+        v->count--;
+        f = v->frames[(v->first + v->count) % FRAMES];
+        v->queued -= f->len;
+        release(f);
+    }
+
+    if ((snap = play_snapshot(&v->game->play, &len)) == NULL)
+    {
+        return -1;
+    }
+    f = new_frame(snap, len);
+    free(snap);
+    if (f == NULL)
+    {
+        return -1;
+    }
+    add_frame(v, f);
+    release(f);
+
+    return 0;
+}
+
+/* Puts what the game has drawn since it last did this in a frame for its
+ * spectators, and sends it them. */
+static void fan_out(struct session *s)
+{
+    struct spectator *v,
+                     *next;
+    struct frame     *f;
+    const char       *out;
+    size_t           len;
+
+    out = play_output(&s->play, &len);
+    if ((len == s->fanned) || (s->spectators == NULL))
+    {
+        s->fanned = len;
+        return;
+    }
+
+    f = new_frame(out + s->fanned, len - s->fanned);
+    s->fanned = len;
+
+    for (v = s->spectators; v != NULL; v = next)
+    {
+        next = v->next;
+        if ((f == NULL) || (v->queued + f->len > BACKLOG) ||
+                (add_frame(v, f) == -1))
+        {
+            if (catch_up(v) == -1)
+            {
+                close_spectator(v);
+                continue;
+            }
+        }
+        if (send_frames(v) == -1)
+        {
+            close_spectator(v);
+        }
+    }
+
+    if (f != NULL)
+    {
+        release(f);
+    }
+}
+
+/* Makes the caller a spectator of game. */
+static void open_spectator(const struct caller *c, struct session *game)
+{
+    struct spectator   *v;
+    struct epoll_event ev;
+
+    if ((v = calloc(1, sizeof(*v))) == NULL)
+    {
+        close(c->fd);
+        return;
+    }
+
+    v->kind = SPECTATOR;
+    v->fd   = c->fd;
+    v->game = game;
+    v->next = game->spectators;
+    game->spectators = v;
+
+    ev.events   = EPOLLIN;
+    ev.data.ptr = v;
+    epoll_ctl(epfd, EPOLL_CTL_MOD, v->fd, &ev);
+
+    /* The screen so far, then on from there with everyone else. */
+    if ((catch_up(v) == -1) || (send_frames(v) == -1))
+    {
+        close_spectator(v);
+    }
+}
+
+/* Spectators have nothing to say: anything they type is thrown away. */
+static void spectator_readable(struct spectator *v)
+{
+    char    buf[512];
+    ssize_t n;
+
+    while ((n = read(v->fd, buf, sizeof(buf))) > 0)
+    {
+        ;
+    }
+    if ((n == 0) || ((errno != EAGAIN) && (errno != EWOULDBLOCK)))
+    {
+        close_spectator(v);
+    }
+}
+
+/* ------------------------------------------------------------------------ *
+ * Players.
+ * ------------------------------------------------------------------------ */
+
+/* Sends what the socket will take of what the session has drawn.  Returns
+ * -1 if the client has gone, or is too far behind to be worth keeping. */
+static int send_out(struct session *s)
+{
+    const char *out;
+    size_t     len;
+    ssize_t    n;
+
+    out = play_output(&s->play, &len);
+    if (len > 0)
+    {
+        n = write(s->fd, out, len);
+        if (n < 0)
+        {
+            if ((errno != EAGAIN) && (errno != EWOULDBLOCK))
+            {
+                return -1;
+            }
+            n = 0;
+        }
+        play_consume(&s->play, n);
+        s->fanned -= n;
+        len -= n;
+    }
+    if (len > BACKLOG)
+    {
+        return -1;
+    }
+
+    watch(s->fd, s, len > 0);
+
+    return 0;
+}
+
+static void close_session(struct session *s)
+{
+    struct session **p;
+
+    for (p = &sessions; *p != s; p = &(*p)->next)
+    {
+        ;
+    }
+    *p = s->next;
+
+    while (s->spectators != NULL)
+    {
+        close_spectator(s->spectators);
+    }
+    timer_cancel(&wheel, &s->timer);
+    play_close(&s->play);
+    if (s->fd != -1)
+    {
+        close(s->fd);
+    }
+    free(s);
+}
+
+/* The connection has gone, or is no use: keep the game for its player to
+ * come back to, stopped where it is.  A game that is over is let go. */
+static void drop_session(struct session *s)
+{
+    if (s->play.state == PLAY_DONE)
+    {
+        close_session(s);
+        return;
+    }
+    close(s->fd);
+    s->fd = -1;
+    timer_set(&wheel, &s->timer, now() + KEEP);
+}
+
+/* The game is over: sends what is left of its last screen as the socket
+ * takes it, and closes the session once it is all gone, or once LINGER ms
+ * are up if the client is too slow to take it. */
+static void finish(struct session *s)
+{
+    size_t len;
+
+    if (send_out(s) == -1)
+    {
+        close_session(s);
+        return;
+    }
+    play_output(&s->play, &len);
+    if (len == 0)
+    {
+        close_session(s);
+    } else if (!timer_pending(&s->timer)) {
+        timer_set(&wheel, &s->timer, now() + LINGER);
+    }
+}
+
+/* Runs s until it waits again, then sends what it drew.  The game is told
+ * first how much of what was sent before the client has yet to take. */
+static void run(struct session *s)
+{
+    int  queued,
+         state;
+    long wait;
+
+    if (ioctl(s->fd, SIOCOUTQ, &queued) == 0)
+    {
+        s->play.queued = queued;
+    }
+
+    state = play_run(&s->play);
+    wait  = s->play.wait;
+    fan_out(s);
+
+    if (state == PLAY_DONE)
+    {
+        timer_cancel(&wheel, &s->timer);
+        finish(s);
+        return;
+    }
+
+    if (wait >= 0)
+    {
+        timer_set(&wheel, &s->timer, now() + wait);
+    } else {
+        timer_cancel(&wheel, &s->timer);
+    }
+    if (send_out(s) == -1)
+    {
+        drop_session(s);
+    }
+}
+
+static void wake(void *arg)
+{
+    struct session *s = arg;
+
+    if ((s->fd == -1) || (s->play.state == PLAY_DONE))
+    {
+        close_session(s);  /* Its player is not coming back, or its last
+                            * screen is not getting through. */
+    } else {
+        run(s);
+    }
+}
+
+/* Gives s the caller's connection, where it is in telnet's commands. */
+static void attach(struct session *s, const struct caller *c)
+{
+    struct epoll_event ev;
+
+    s->fd     = c->fd;
+    s->telnet = c->telnet;
+    s->cr     = c->cr;
+
+    ev.events   = EPOLLIN;
+    ev.data.ptr = s;
+    epoll_ctl(epfd, EPOLL_CTL_MOD, s->fd, &ev);
+}
+
+/* Gives s's player, cut off, the game again on c's connection, the screen
+ * as it was and the wait it was in started afresh. */
+static void resume(struct session *s, const struct caller *c)
+{
+    timer_cancel(&wheel, &s->timer);
+    attach(s, c);
+    if (s->play.wait >= 0)
+    {
+        timer_set(&wheel, &s->timer, now() + s->play.wait);
+    }
+    play_repaint(&s->play);
+    s->fanned = 0;
+    fan_out(s);
+    if (send_out(s) == -1)
+    {
+        drop_session(s);
+    }
+}
+
+static void open_session(const struct caller *c)
+{
+    struct session *s;
+
+    if ((s = calloc(1, sizeof(*s))) == NULL)
+    {
+        close(c->fd);
+        return;
+    }
+    s->kind = PLAYER;
+    s->id   = c->id;
+    strcpy(s->code, c->code);
+    timer_init(&s->timer, wake, s);
+
+    if (play_open(&s->play, seed++) == -1)
+    {
+        close(c->fd);
+        free(s);
+        return;
+    }
+
+    s->next  = sessions;
+    sessions = s;
+
+    attach(s, c);
+    run(s);
+}
+
+/* Takes telnet's own chatter out of what a client sent, in place, given
+ * where it was in a command before.  A carriage return is Enter, whatever
+ * follows it.  Returns how many keys are left. */
+static ssize_t strip(int *telnet, int *cr, unsigned char *buf, ssize_t n)
+{
+    ssize_t i,
+            keys = 0;
+
+    for (i = 0; i < n; i++)
+    {
+        int c = buf[i];
+
+        switch (*telnet)
+        {
+            case 0:
+                if (c == IAC)
+                {
+                    *telnet = IAC;
+                    continue;
+                }
+                break;
+
+            case IAC:
+                if ((c >= WILL) && (c <= DONT))
+                {
+                    *telnet = WILL;
+                    continue;
+                }
+                *telnet = (c == SB) ? SB : 0;
+                if (c != IAC)
+                {
+                    continue;
+                }
+                break;  /* IAC IAC is a real 255. */
+
+            case WILL:
+                *telnet = 0;
+                continue;
+
+            case SB:
+                if (c == IAC)
+                {
+                    *telnet = SE;
+                }
+                continue;
+
+            case SE:
+                *telnet = (c == SE) ? 0 : SB;
+                continue;
+        }
+
+        if (*cr && ((c == '\n') || (c == '\0')))
+        {
+            *cr = 0;
+            continue;
+        }
+        *cr = (c == '\r');
+        buf[keys++] = (c == '\r') ? '\n' : c;
+    }
+
+    return keys;
+}
+
+static void readable(struct session *s)
+{
+    unsigned char buf[512];
+    ssize_t       n,
+                  keys,
+                  i;
+
+    while ((n = read(s->fd, buf, sizeof(buf))) > 0)
+    {
+        keys = strip(&s->telnet, &s->cr, buf, n);
+        for (i = 0; i < keys; i++)
+        {
+            play_key(&s->play, buf[i]);  /* Typing far ahead loses keys. */
+        }
+    }
+    if ((n == 0) || ((errno != EAGAIN) && (errno != EWOULDBLOCK)))
+    {
+        drop_session(s);
+        return;
+    }
+
+    if ((s->play.state == PLAY_KEY) && (s->play.in_len > 0))
+    {
+        run(s);
+    }
+}
+
+/* ------------------------------------------------------------------------ *
+ * Callers: new connections, asked for a resume code before they get a
+ * game, or for the game they would watch.  Their answers wait for the end
+ * of epoll's batch, so that a game taken up from a dead connection has no
+ * events left in it for that connection.
+ * ------------------------------------------------------------------------ */
+
+#define LISTED 20  /* Games listed for a spectator to choose from. */
+
+static const char ask[] =
+    "To take up a game you were cut off from, give its resume code;\r\n"
+    "or press Enter for a new game: ";
+
+static void say(int fd, const char *format, ...)
+{
+    char    buf[512];
+    va_list ap;
+    int     n;
+
+    va_start(ap, format);
+    n = vsnprintf(buf, sizeof(buf), format, ap);
+    va_end(ap);
+
+    if (write(fd, buf, n) < 0)
+    {
+        ;  /* If it is gone, the next read will say so. */
+    }
+}
+
+/* A code no game has yet. */
+static void new_code(char *code)
+{
+    struct session *s;
+    uint64_t       r;
+
+    do
+    {
+        if (getrandom(&r, sizeof(r), 0) != sizeof(r))
+        {
+            r = rng_next(&codes);
+        }
+        snprintf(code, CODE + 1, "%0*llx", CODE, (unsigned long long) r);
+        for (s = sessions; (s != NULL) && strcmp(s->code, code); s = s->next)
+        {
+            ;
+        }
+    } while (s != NULL);
+}
+
+/* The newest games, and asks which to watch.  Returns -1 if there are
+ * none. */
+static int list_games(int fd)
+{
+    struct session *s;
+    int            n = 0;
+
+    for (s = sessions; s != NULL; s = s->next)
+    {
+        if (s->play.state == PLAY_DONE)
+        {
+            continue;
+        }
+        if (n++ == 0)
+        {
+            say(fd, "\r\nGames being played:\r\n\r\n"
+                "  Game  Firm                    Months\r\n");
+        }
+        if (n <= LISTED)
+        {
+            say(fd, "  %4d  %-22s  %6d%s\r\n", s->id,
+                (s->play.game.firm[0] != '\0') ? s->play.game.firm : "-",
+                game_months(&s->play.game),
+                (s->fd == -1) ? "  (cut off)" : "");
+        }
+    }
+    if (n == 0)
+    {
+        return -1;
+    }
+    if (n > LISTED)
+    {
+        say(fd, "  ...and %d older\r\n", n - LISTED);
+    }
+    say(fd, "\r\nGame to watch, or Enter for the one going longest: ");
+
+    return 0;
+}
+
+/* The caller has been too long about it. */
+static void send_away(void *arg)
+{
+    struct caller *c = arg;
+
+    say(c->fd, "\r\nTime is up.\r\n");
+    close(c->fd);
+    free(c);
+}
+
+/* A minute is up since the first wrong code in it. */
+static void forgive(void *arg)
+{
+    misses = 0;
+}
+
+static void open_caller(int fd, int watching)
+{
+    struct caller      *c;
+    struct epoll_event ev;
+    int                one = 1,
+                       idle = 60,
+                       interval = 10,
+                       probes = 3;
+
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    /* A player's connection that dies unheard of is dropped in some two
+     * minutes, so that the game can be taken up on another. */
+    setsockopt(fd, SOL_SOCKET, SO_KEEPALIVE, &one, sizeof(one));
+    setsockopt(fd, IPPROTO_TCP, TCP_KEEPIDLE, &idle, sizeof(idle));
+    setsockopt(fd, IPPROTO_TCP, TCP_KEEPINTVL, &interval, sizeof(interval));
+    setsockopt(fd, IPPROTO_TCP, TCP_KEEPCNT, &probes, sizeof(probes));
+
+    if ((c = calloc(1, sizeof(*c))) == NULL)
+    {
+        close(fd);
+        return;
+    }
+    c->kind     = CALLER;
+    c->fd       = fd;
+    c->watching = watching;
+    timer_init(&c->timer, send_away, c);
+
+    ev.events   = EPOLLIN;
+    ev.data.ptr = c;
+    epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev);
+
+    if (write(fd, hello, sizeof(hello)) < 0)
+    {
+        ;  /* If it is gone, the first read will say so. */
+    }
+    if (!watching)
+    {
+        say(fd, "\r\nTaipan!\r\n\r\n%s", ask);
+    } else if (list_games(fd) == -1) {
+        say(fd, "No one is playing just now.\r\n");
+        close(fd);
+        free(c);
+        return;
+    }
+    timer_set(&wheel, &c->timer, now() + LOBBY);
+}
+
+static void hand_in(struct caller *c)
+{
+    if (!c->ready)
+    {
+        c->ready = 1;
+        c->next  = ready;
+        ready    = c;
+    }
+}
+
+static void caller_gone(struct caller *c)
+{
+    close(c->fd);
+    c->fd = -1;
+    hand_in(c);
+}
+
+/* A key for the line being typed, echoed, since we told telnet we would. */
+static void edit(struct caller *c, int key)
+{
+    if (c->code[0] != '\0')
+    {
+        hand_in(c);  /* Any key starts the new game. */
+    } else if (key == '\n') {
+        say(c->fd, "\r\n");
+        hand_in(c);
+    } else if (((key == '\b') || (key == 127)) && (c->len > 0)) {
+        c->len--;
+        say(c->fd, "\b \b");
+    } else if ((key > ' ') && (key < 127) && (c->len < CODE)) {
+        c->line[c->len++] = key;
+        say(c->fd, "%c", key);
+    }
+}
+
+static void caller_readable(struct caller *c)
+{
+    unsigned char buf[64];
+    ssize_t       n,
+                  keys,
+                  i;
+
+    while ((n = read(c->fd, buf, sizeof(buf))) > 0)
+    {
+        keys = strip(&c->telnet, &c->cr, buf, n);
+        for (i = 0; (i < keys) && !c->ready; i++)
+        {
+            edit(c, buf[i]);
+        }
+    }
+    if ((n == 0) || ((errno != EAGAIN) && (errno != EWOULDBLOCK)))
+    {
+        caller_gone(c);
+    }
+}
+
+/* Does as c asked: starts it a game, gives it back its own, shows it the
+ * game it would watch, or asks it again, with LOBBY ms to answer in.
+ * Frees c unless it is to be asked again. */
+static void answer(struct caller *c)
+{
+    struct session *s,
+                   *game = NULL;
+
+    c->ready = 0;
+    timer_cancel(&wheel, &c->timer);
+    if (c->fd == -1)
+    {
+        free(c);
+        return;
+    }
+
+    c->line[c->len] = '\0';
+    if (c->watching)
+    {
+        for (s = sessions; s != NULL; s = s->next)
+        {
+            if ((s->play.state != PLAY_DONE) &&
+                    ((c->len == 0) || (atoi(c->line) == s->id)))
+            {
+                game = s;  /* The list is newest first. */
+            }
+        }
+        if (game != NULL)
+        {
+            open_spectator(c, game);
+            free(c);
+            return;
+        }
+
+        c->len = 0;
+        say(c->fd, "No game %s is being played.\r\n", c->line);
+        if ((++c->tries == TRIES) || (list_games(c->fd) == -1))
+        {
+            close(c->fd);
+            free(c);
+            return;
+        }
+        timer_set(&wheel, &c->timer, now() + LOBBY);
+        return;
+    }
+
+    if (c->code[0] != '\0')
+    {
+        open_session(c);
+        free(c);
+        return;
+    }
+    if (c->len == 0)
+    {
+        c->id = ++games;
+        new_code(c->code);
+        say(c->fd, "\r\nThis is game %d, and its resume code is %s.  Should "
+            "you be cut\r\noff, connect again within a quarter of an hour "
+            "and give the code, to\r\ntake up the game where you left it."
+            "\r\n\r\nPress any key to begin. ", c->id, c->code);
+        timer_set(&wheel, &c->timer, now() + LOBBY);
+        return;
+    }
+
+    /* Past MISSES, no code is taken, right or wrong, till the minute is
+     * up: guessing gets nowhere, however many connections it comes on. */
+    if (misses >= MISSES)
+    {
+        say(c->fd, "Too many wrong codes have been given just now; try "
+            "again in a minute.\r\n");
+        close(c->fd);
+        free(c);
+        return;
+    }
+    for (s = sessions; s != NULL; s = s->next)
+    {
+        if ((s->play.state != PLAY_DONE) &&
+                (strcasecmp(s->code, c->line) == 0))
+        {
+            break;
+        }
+    }
+    if ((s != NULL) && (s->fd == -1))
+    {
+        resume(s, c);
+        free(c);
+        return;
+    }
+
+    c->len = 0;
+    if (s != NULL)
+    {
+        say(c->fd, "That game is still connected.  If it is yours and its "
+            "connection has\r\ndied, it will be let go in a minute or "
+            "two.\r\n");
+    } else {
+        say(c->fd, "No game has that code.\r\n");
+        if (misses++ == 0)
+        {
+            timer_set(&wheel, &amnesty, now() + 60 * 1000);
+        }
+    }
+    if (++c->tries == TRIES)
+    {
+        close(c->fd);
+        free(c);
+        return;
+    }
+    say(c->fd, "\r\n%s", ask);
+    timer_set(&wheel, &c->timer, now() + LOBBY);
+}
+
+/* Wakes every session whose wait is up, and says how long until the
+ * next one is. */
+static int timers(void)
+{
+    wheel_run(&wheel, now());
+
+    return (int) wheel_timeout(&wheel, now());
+}
+
+static void usage(void)
+{
+    fprintf(stderr, "usage: taipan-server [-q] [-p port] [-s seed] [-w port]\n");
+    exit(1);
+}
+
+static int port_number(const char *arg)
+{
+    char *end;
+    long port = strtol(arg, &end, 10);
+
+    if ((*arg == '\0') || (*end != '\0') || (port <= 0) || (port > 65535))
+    {
+        usage();
+    }
+
+    return port;
+}
+
+/* Listens on port for connections of the given kind.  Exits if it
+ * cannot. */
+static void listen_on(struct port *l, int kind, int port)
+{
+    struct sockaddr_in addr;
+    struct epoll_event ev;
+    int                one = 1;
+
+    l->kind = kind;
+    l->fd   = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    setsockopt(l->fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family      = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port        = htons(port);
+    if ((bind(l->fd, (struct sockaddr *) &addr, sizeof(addr)) == -1) ||
+            (listen(l->fd, SOMAXCONN) == -1))
+    {
+        perror("taipan-server");
+        exit(1);
+    }
+
+    ev.events   = EPOLLIN;
+    ev.data.ptr = l;
+    epoll_ctl(epfd, EPOLL_CTL_ADD, l->fd, &ev);
+}
+
+int main(int argc, char *argv[])
+{
+    static struct port players,
+                       watchers;
+    struct epoll_event events[256];
+    struct rlimit      rl;
+    char               *end;
+    int                port = 2323,
+                       watch_port = 0,
+                       c,
+                       i,
+                       n;
+
+    seed = time(NULL);
+
+    while ((c = getopt(argc, argv, "qp:s:w:")) != -1)
+    {
+        switch (c)
+        {
+            case 'q':
+                quick = 1;
+                break;
+
+            case 'p':
+                port = port_number(optarg);
+                break;
+
+            case 's':
+                seed = strtoull(optarg, &end, 0);
+                if ((*optarg == '\0') || (*end != '\0'))
+                {
+                    usage();
+                }
+                break;
+
+            case 'w':
+                watch_port = port_number(optarg);
+                break;
+
+            default:
+                usage();
+        }
+    }
+    if (optind != argc)
+    {
+        usage();
+    }
+
+    signal(SIGPIPE, SIG_IGN);
+
+    /* A descriptor a player or spectator: as many as we are allowed. */
+    if (getrlimit(RLIMIT_NOFILE, &rl) == 0)
+    {
+        rl.rlim_cur = rl.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &rl);
+    }
+
+    rng_seed(&codes, seed ^ now() ^ getpid());
+    wheel_init(&wheel, now());
+    timer_init(&amnesty, forgive, NULL);
+    epfd = epoll_create1(EPOLL_CLOEXEC);
+    listen_on(&players, PLAYERS, port);
+    if (watch_port != 0)
+    {
+        listen_on(&watchers, SPECTATORS, watch_port);
+    }
+
+    for (;;)
+    {
+        int accepting = 0,
+            watching = 0;
+
+        n = epoll_wait(epfd, events, 256, timers());
+
+        for (i = 0; i < n; i++)
+        {
+            void             *conn = events[i].data.ptr;
+            struct session   *s = conn,
+                             *t;
+            struct spectator *v = conn;
+            struct caller    *k = conn;
+
+            switch (*(int *) conn)
+            {
+                case PLAYERS:
+                    accepting = 1;
+                    continue;
+
+                case SPECTATORS:
+                    watching = 1;
+                    continue;
+
+                case SPECTATOR:
+                    if (v->fd == -1)
+                    {
+                        ;  /* Closed earlier in this batch. */
+                    } else if (events[i].events & (EPOLLERR | EPOLLHUP)) {
+                        close_spectator(v);
+                    } else if (events[i].events & EPOLLIN) {
+                        spectator_readable(v);
+                    } else if ((events[i].events & EPOLLOUT) &&
+                            (send_frames(v) == -1)) {
+                        close_spectator(v);
+                    }
+                    continue;
+
+                case CALLER:
+                    if ((k->fd == -1) || k->ready)
+                    {
+                        ;  /* Answered once the batch is done. */
+                    } else if (events[i].events & (EPOLLERR | EPOLLHUP)) {
+                        caller_gone(k);
+                    } else if (events[i].events & EPOLLIN) {
+                        caller_readable(k);
+                    }
+                    continue;
+            }
+
+            /* A session closed or dropped earlier in this batch is no
+             * longer here. */
+            for (t = sessions; (t != NULL) && (t != s); t = t->next)
+            {
+                ;
+            }
+            if ((t == NULL) || (s->fd == -1))
+            {
+                continue;
+            }
+
+            if (events[i].events & (EPOLLERR | EPOLLHUP))
+            {
+                drop_session(s);
+            } else if (events[i].events & EPOLLIN) {
+                readable(s);
+            } else if (events[i].events & EPOLLOUT) {
+                if (s->play.state == PLAY_DONE)
+                {
+                    finish(s);
+                } else if (send_out(s) == -1) {
+                    drop_session(s);
+                }
+            }
+        }
+
+        /* Callers' answers last, so that none takes up a game while this
+         * batch still has events for the connection it had. */
+        while (ready != NULL)
+        {
+            struct caller *k = ready;
+
+            ready = k->next;
+            answer(k);
+        }
+        if (accepting)
+        {
+            int fd;
+
+            while ((fd = accept4(players.fd, NULL, NULL, SOCK_CLOEXEC)) != -1)
+            {
+                open_caller(fd, 0);
+            }
+        }
+        if (watching)
+        {
+            int fd;
+
+            while ((fd = accept4(watchers.fd, NULL, NULL, SOCK_CLOEXEC)) != -1)
+            {
+                open_caller(fd, 1);
+            }
+        }
+
+        /* Nothing has events for these any more. */
+        while (closed != NULL)
+        {
+            struct spectator *v = closed;
+
+            closed = v->next;
+            free(v);
+        }
+    }
+
+    return 0;
+}
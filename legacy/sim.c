@@ -0,0 +1,219 @@
+/* ------------------------------------------------------------------------ *
+ * taipan-sim: play a great many games of Taipan with no one at the
+ * keyboard, spread over every core, and report how they went.
+ *
+ * Each game is played by one of the policies in policy.c, the trader
+ * unless told otherwise.  Game i is seeded with seed + i, and everything a
+ * game does depends only on its seed, so the same seed gives the same
+ * report however many threads run it; only the timing at the end varies.
+ * ------------------------------------------------------------------------ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "engine.h"
+#include "policy.h"
+#include "pool.h"
+#include "tool.h"
+
+/* Marks a game cut off at the month limit, alongside GAME_*. */
+#define CUT_OFF GAME_RUNNING
+
+struct result
+{
+    long long score,
+              net_worth;
+    long      decisions;
+    int       months,
+              cause;
+};
+
+struct sim
+{
+    const struct policy *policy;
+    uint64_t            seed;
+    int                 max_months;
+    struct result       *results;
+};
+
+/* Plays game i to the end, or to the month limit. */
+static void play(long i, void *arg)
+{
+    struct sim        *sim = arg;
+    struct result     *res = &sim->results[i];
+    struct game_state g;
+    struct game_event ev;
+    struct player     p;
+
+    game_init(&g);
+    game_seed(&g, sim->seed + i);
+
+    /* The player's own dice, so that its choices leave the game's alone. */
+    player_init(&p, sim->policy, ~(sim->seed + i));
+    player_start(&p, &g);
+
+    res->cause = CUT_OFF;
+    for (;;)
+    {
+        if (game_step(&g, &ev) == EV_GAME_OVER)
+        {
+            res->cause = ev.n;
+            break;
+        }
+        if ((ev.type == EV_ARRIVING) && (game_months(&g) >= sim->max_months))
+        {
+            break;
+        }
+        player_answer(&p, &g, &ev);
+    }
+
+    res->score     = game_score(&g);
+    res->net_worth = game_net_worth(&g);
+    res->months    = game_months(&g);
+    res->decisions = p.decisions;
+}
+
+void usage(void)
+{
+    int i;
+
+    fprintf(stderr,
+            "usage: taipan-sim [-v] [-n games] [-s seed] [-j threads] [-m months]\n"
+            "                  [-p policy]\n\npolicies:\n");
+    for (i = 0; policies[i] != NULL; i++)
+    {
+        fprintf(stderr, "  %-10s %s\n", policies[i]->name, policies[i]->about);
+    }
+    exit(1);
+}
+
+int main(int argc, char *argv[])
+{
+    struct sim sim;
+    long       games = 1000,
+               i;
+    int        threads = 0,
+               verbose = 0,
+               count[5] = { 0 },
+               c;
+    long long  min[3],
+               max[3],
+               sum[3],
+               decisions = 0;
+    double     elapsed;
+
+    sim.policy = policies[0];
+    sim.seed = 1;
+    sim.max_months = 1200;
+
+    while ((c = getopt(argc, argv, "vn:s:j:m:p:")) != -1)
+    {
+        switch (c)
+        {
+            case 'v':
+                verbose = 1;
+                break;
+
+            case 'n':
+                games = number(optarg);
+                break;
+
+            case 's':
+                sim.seed = number(optarg);
+                break;
+
+            case 'j':
+                threads = number(optarg);
+                break;
+
+            case 'm':
+                sim.max_months = number(optarg);
+                break;
+
+            case 'p':
+                if ((sim.policy = policy_find(optarg)) == NULL)
+                {
+                    usage();
+                }
+                break;
+
+            default:
+                usage();
+        }
+    }
+    if ((optind != argc) || (games < 1) || (sim.max_months < 1))
+    {
+        usage();
+    }
+
+    sim.results = calloc(games, sizeof(*sim.results));
+    elapsed = seconds();
+    if ((sim.results == NULL) || (pool_run(threads, games, play, &sim) != 0))
+    {
+        fprintf(stderr, "taipan-sim: out of memory\n");
+        return 1;
+    }
+    elapsed = seconds() - elapsed;
+
+    if (verbose)
+    {
+        printf("%10s %12s %14s %7s  %s\n",
+               "seed", "score", "net worth", "months", "end");
+    }
+    for (i = 0; i < games; i++)
+    {
+        struct result *res = &sim.results[i];
+        long long     v[3] = { res->score, res->net_worth, res->months };
+        int           k;
+
+        if (verbose)
+        {
+            printf("%10llu %12lld %14lld %7d  %s\n",
+                   (unsigned long long) (sim.seed + i),
+                   res->score, res->net_worth, res->months,
+                   causes[res->cause]);
+        }
+
+        for (k = 0; k < 3; k++)
+        {
+            if ((i == 0) || (v[k] < min[k]))
+            {
+                min[k] = v[k];
+            }
+            if ((i == 0) || (v[k] > max[k]))
+            {
+                max[k] = v[k];
+            }
+            sum[k] = ((i == 0) ? 0 : sum[k]) + v[k];
+        }
+        count[res->cause]++;
+        decisions += res->decisions;
+    }
+
+    printf("%ld games from seed %llu, played by %s\n\n", games,
+           (unsigned long long) sim.seed, sim.policy->name);
+    printf("%-10s %14s %14s %14s\n", "", "mean", "min", "max");
+    printf("%-10s %14.1f %14lld %14lld\n", "score",
+           (double) sum[0] / games, min[0], max[0]);
+    printf("%-10s %14.1f %14lld %14lld\n", "net worth",
+           (double) sum[1] / games, min[1], max[1]);
+    printf("%-10s %14.1f %14lld %14lld\n\n", "months",
+           (double) sum[2] / games, min[2], max[2]);
+    for (c = 1; c <= 5; c++)
+    {
+        int k = c % 5;  /* The cut-off games last. */
+
+        printf("%-10s %8d  %5.1f%%\n", causes[k], count[k],
+               100.0 * count[k] / games);
+    }
+    printf("\n%lld decisions, %.1f a game, in %.3f s: %.0f a second\n",
+           decisions, (double) decisions / games, elapsed,
+           (elapsed > 0) ? decisions / elapsed : 0);
+
+    free(sim.results);
+
+    return 0;
+}
@@ -0,0 +1,234 @@
+/* ------------------------------------------------------------------------ *
+ * Policy tables.  See solve.h.
+ * ------------------------------------------------------------------------ */
+
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "solve.h"
+
+/* The grid.  Money is spaced geometrically, at half decades where most
+ * games are decided; debt beyond the last point is not to be had, since
+ * the solver borrows no further. */
+static const double ports[] = { 1, 2, 3, 4, 5, 6, 7 };
+static const double debt[] = { 0, 3162, 1e4, 31623, 1e5, 1e6 };
+static const double bank[] = { 0, 1e5, 1e6, 1e7, 1e8 };
+static const double guns[] = { 0, 5 };
+static const double capacity[] = { 60, 160, 360 };
+static const double damage[] = { 0, 50 };
+static const double li[] = { 0, 1 };
+static const double cash[] = { 0, 100, 316, 1000, 3162, 1e4, 31623, 1e5,
+    316228, 1e6, 3162278, 1e7, 31622777, 1e8, 1e9 };
+
+static const struct
+{
+    const double *at;
+    int          n;
+} axes[SOLVE_AXES] =
+{
+#define AXIS(a) { a, (int) (sizeof(a) / sizeof(a[0])) }
+    AXIS(ports), AXIS(debt), AXIS(bank), AXIS(guns), AXIS(capacity),
+    AXIS(damage), AXIS(li), AXIS(cash)
+#undef AXIS
+};
+
+/* Where each band of months begins, and the month its moves are worked
+ * out for. */
+static const int bands[SOLVE_BANDS] = { 1, 13, 25, 49, 97 };
+static const int middles[SOLVE_BANDS] = { 6, 18, 36, 72, 144 };
+
+int solve_points(int axis, const double **at)
+{
+    *at = axes[axis].at;
+
+    return axes[axis].n;
+}
+
+long solve_states(void)
+{
+    long n = 1;
+    int  a;
+
+    for (a = 0; a < SOLVE_AXES; a++)
+    {
+        n *= axes[a].n;
+    }
+
+    return n;
+}
+
+long solve_cells(void)
+{
+    return SOLVE_BANDS * solve_states() * SOLVE_PATTERNS;
+}
+
+int solve_band(int months)
+{
+    int b;
+
+    for (b = SOLVE_BANDS - 1; b > 0; b--)
+    {
+        if (months >= bands[b])
+        {
+            break;
+        }
+    }
+
+    return b;
+}
+
+int solve_month(int band)
+{
+    return middles[band];
+}
+
+/* The prices set_prices() draws are half, once and one and a half times
+ * the mean; a price cut or raised since counts as low or high. */
+int solve_level(int item, int port, long price)
+{
+    long mean = game_mean_price(item, port);
+
+    if (price * 4 < mean * 3)
+    {
+        return 0;
+    }
+
+    return (price * 4 > mean * 5) ? 2 : 1;
+}
+
+uint8_t solve_code(const struct mcts_move *move)
+{
+    return move->dest | ((move->buy + 1) << 3) | (move->finance << 6);
+}
+
+void solve_decode(uint8_t code, struct mcts_move *move)
+{
+    move->sell    = 1;
+    move->finance = code >> 6;
+    move->buy     = ((code >> 3) & 7) - 1;
+    move->half    = 0;
+    move->dest    = code & 7;
+}
+
+/* The nearest point to x along an axis, in proportion (the least of them
+ * being 0, and the rest all above it). */
+static int nearest(int axis, double x)
+{
+    const double *at = axes[axis].at;
+    int          i;
+
+    for (i = 0; i + 1 < axes[axis].n; i++)
+    {
+        if ((at[i] > 0) ? (x * x < at[i] * at[i + 1]) : (x < at[1] / 2))
+        {
+            break;
+        }
+    }
+
+    return i;
+}
+
+long solve_state(const double *x)
+{
+    long i = (long) x[SOLVE_PORT] - 1;
+    int  a;
+
+    for (a = SOLVE_PORT + 1; a < SOLVE_AXES; a++)
+    {
+        i = (i * axes[a].n) + nearest(a, x[a]);
+    }
+
+    return i;
+}
+
+void solve_move(const struct solve_table *t, const struct game_state *g,
+                struct mcts_move *move)
+{
+    double worth = g->cash,
+           x[SOLVE_AXES];
+    long   i;
+    int    pattern = 0,
+           k;
+
+    for (k = 0; k < 4; k++)
+    {
+        worth += (double) g->hold_[k] * g->price[k];
+        pattern = (pattern * 3) + solve_level(k, g->port, g->price[k]);
+    }
+
+    x[SOLVE_PORT]     = g->port;
+    x[SOLVE_DEBT]     = g->debt;
+    x[SOLVE_BANK]     = g->bank;
+    x[SOLVE_GUNS]     = g->guns;
+    x[SOLVE_CAPACITY] = g->capacity;
+    x[SOLVE_DAMAGE]   = (double) g->damage * 100 / g->capacity;
+    x[SOLVE_LI]       = (g->li > 0);
+    x[SOLVE_CASH]     = worth;
+
+    i = (solve_band(game_months(g)) * solve_states()) + solve_state(x);
+    solve_decode(t->cells[(i * SOLVE_PATTERNS) + pattern], move);
+
+    /* A good whose price has jumped is bucketed as dear, but is not worth
+     * buying at five times that. */
+    if ((move->buy >= 0) &&
+            (g->price[move->buy] > 2 * game_mean_price(move->buy, g->port)))
+    {
+        move->buy = -1;
+    }
+}
+
+/* Maps a table written by taipan-solve.  Returns 0, or -1 if the file is
+ * missing or is not a table for this grid. */
+int solve_open(struct solve_table *t, const char *path)
+{
+    const struct solve_header *h;
+    struct stat               st;
+    void                      *map;
+    int                       fd;
+
+    if ((fd = open(path, O_RDONLY)) == -1)
+    {
+        return -1;
+    }
+    if ((fstat(fd, &st) == -1) ||
+            (st.st_size != (off_t) (sizeof(*h) + solve_cells())))
+    {
+        close(fd);
+        return -1;
+    }
+
+    map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+    {
+        return -1;
+    }
+
+    h = map;
+    if ((memcmp(h->magic, "TAIPANPT", 8) != 0) ||
+            (h->version != SOLVE_VERSION) || (h->cells != solve_cells()))
+    {
+        munmap(map, st.st_size);
+        return -1;
+    }
+
+    t->map    = map;
+    t->size   = st.st_size;
+    t->months = h->months;
+    t->cells  = (const uint8_t *) (h + 1);
+
+    return 0;
+}
+
+void solve_close(struct solve_table *t)
+{
+    if (t->map != NULL)
+    {
+        munmap(t->map, t->size);
+    }
+    t->map   = NULL;
+    t->cells = NULL;
+}
@@ -0,0 +1,101 @@
+/* ------------------------------------------------------------------------ *
+ * A policy table: the move to make at a port, worked out offline for
+ * every bucket of game states by taipan-solve, and looked up in play.
+ *
+ * A game waiting in port is bucketed by its port, its month (in bands),
+ * its cash, debt and bank, its guns, its capacity, its damage, and
+ * whether Li Yuen has been paid; the cargo aboard is counted in with the
+ * cash at the prices there, since selling it and buying it back costs
+ * nothing.  The prices there are bucketed too, each good's as low, middling
+ * or high for the port, as set_prices() draws them.  For each bucket and
+ * each pattern of prices the table holds one move (struct mcts_move:
+ * sell the cargo, settle with Wu and the bank in Hong Kong, fill the hold
+ * with one good or none, and sail for a port or retire), in one byte.
+ *
+ * The moves are worked out by backward induction over the months, from
+ * the horizon the table is built for down to the first, with the odds of
+ * each voyage taken from the engine's own rules: set_prices(), the events
+ * on arriving in port, the pirates (one in bp) and Li Yuen on the way,
+ * the storms, and the battles as the odds table (odds.h) has them.  What
+ * happens in port and in battle is answered as greedy (policy.c) answers
+ * it, and the game is scored as final_stats() scores it.  The cash, debt
+ * and bank are interpolated between their buckets while solving; a game
+ * in play is looked up in the nearest bucket on every axis, so a lookup
+ * is a handful of compares and one load from a table mapped straight into
+ * memory, as the battle odds are.
+ *
+ * The model is a rough one in places, and says so in taipan-solve.
+ * ------------------------------------------------------------------------ */
+
+#ifndef TAIPAN_SOLVE_H
+#define TAIPAN_SOLVE_H
+
+#include <stdint.h>
+
+#include "engine.h"
+#include "mcts.h"
+
+#define SOLVE_FILE    "taipan-solve.tbl"
+#define SOLVE_VERSION 1
+
+/* The axes of a port state, slowest first.  Damage is in percent of the
+ * capacity, and Li Yuen is 0 or 1 (paid). */
+enum
+{
+    SOLVE_PORT,
+    SOLVE_DEBT,
+    SOLVE_BANK,
+    SOLVE_GUNS,
+    SOLVE_CAPACITY,
+    SOLVE_DAMAGE,
+    SOLVE_LI,
+    SOLVE_CASH,
+    SOLVE_AXES
+};
+
+#define SOLVE_BANDS    5   /* Bands of months. */
+#define SOLVE_PATTERNS 81  /* Prices: three levels for each of four goods. */
+
+struct solve_table
+{
+    const uint8_t *cells;
+    void          *map;
+    long          size;
+    int           months;  /* The horizon it was worked out for. */
+};
+
+/* The file: this header, then solve_cells() moves, band by band, state by
+ * state and pattern by pattern. */
+struct solve_header
+{
+    char     magic[8];  /* "TAIPANPT" */
+    uint32_t version,
+             cells,
+             months;
+    uint32_t pad;
+    double   value;     /* The score a new game should come to. */
+};
+
+int  solve_open(struct solve_table *t, const char *path);
+void solve_close(struct solve_table *t);
+
+/* The move for g, waiting at EV_PORT, to be made with mcts_apply(). */
+void solve_move(const struct solve_table *t, const struct game_state *g,
+                struct mcts_move *move);
+
+/* The grid, for taipan-solve.  solve_points() gives the points along an
+ * axis (the ports are 1 to 7), and returns how many there are. */
+int  solve_points(int axis, const double **at);
+long solve_states(void);
+long solve_state(const double *x);  /* The nearest state to x[SOLVE_AXES]. */
+long solve_cells(void);
+int  solve_band(int months);
+int  solve_month(int band);  /* The month a band's moves are worked out
+                              * for. */
+int  solve_level(int item, int port, long price);  /* 0, 1 or 2. */
+
+/* One move in a byte, and back. */
+uint8_t solve_code(const struct mcts_move *move);
+void    solve_decode(uint8_t code, struct mcts_move *move);
+
+#endif /* TAIPAN_SOLVE_H */
@@ -0,0 +1,1204 @@
+/* ------------------------------------------------------------------------ *
+ * taipan-solve: work out a policy table (see solve.h) on every core, or
+ * play games with one.
+ *
+ * The table is worked out backwards from the horizon, a month at a time:
+ * what a ship in each bucket is worth at a port in month t follows from
+ * what each move there is worth, on average over the voyage, and that
+ * follows from what the buckets are worth in month t + 1.  Each month is
+ * worked out in passes over the buckets, a pass at a time on every thread,
+ * so the table comes out the same on any number of them.  Between the
+ * buckets, the cash, debt and bank are interpolated, and run on past the
+ * last of them.
+ *
+ * Where the model is rougher than the engine:
+ *
+ *  - The month always turns on the way, though Li Yuen letting us be
+ *    brings the ship in without it; Li Yuen forgets he was paid one time in
+ *    sixty, not after three turns of one in twenty.
+ *  - What is asked in port (Li Yuen, McHenry, a new ship) is taken at the
+ *    middle of its dice, or at a quarter and three quarters.  The cargo is
+ *    counted in with the cash as the ship comes in, so robbers and
+ *    cutthroats take their share of it too.
+ *  - A battle costs its average damage and guns whether it is won or run
+ *    from; only a quiet voyage is blown off course, and then sells at the
+ *    average of the other ports' prices.  The rare jumps in price count
+ *    for their average, and a seizure only on a quiet voyage.
+ *  - In Hong Kong the money is settled before the prices are looked at,
+ *    and the load chosen as for the bucket nearest what that leaves.
+ *  - Wu's bailout is never needed; the game starts with cash.
+ * ------------------------------------------------------------------------ */
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "engine.h"
+#include "mcts.h"
+#include "odds.h"
+#include "policy.h"
+#include "pool.h"
+#include "solve.h"
+#include "tool.h"
+
+#define HK 1
+
+/* The ways to load: nothing, or one good bought at one of its levels. */
+#define LEVELS  4  /* Cut by the good prices event, low, middling, high. */
+#define OPTIONS (1 + (4 * LEVELS))
+
+static const double levels[LEVELS] = { 0.2, 0.5, 1, 1.5 };
+
+/* set_prices()'s three prices for a good, as a part of the mean... */
+static const double draws[3] = { 0.5, 1, 1.5 };
+
+/* ...and what the good prices event makes of them on average: one good in
+ * 36 cut to a fifth, and one raised five to nine times. */
+#define JUMP (1 - (1.0 / 36) + ((0.2 + 7) / 72))
+
+/* What may come of a voyage from a bucket, in its month. */
+struct fight
+{
+    double calm,    /* No battle, or Li Yuen let us be. */
+           fought,  /* Won, or got away. */
+           lost,
+           booty,   /* Taken, on average over the battles fought. */
+           damage,  /* In percent, likewise. */
+           guns;    /* Lost, likewise. */
+};
+
+struct solver
+{
+    struct odds_table odds;
+    int               months,
+                      t,         /* The month being worked out. */
+                      bp;
+    long              states,
+                      rows;      /* Runs of states along the cash. */
+    int               n[SOLVE_AXES];
+    const double      *at[SOLVE_AXES];
+    long              stride[SOLVE_AXES];
+    double            mean[4][8],
+                      other[4][8];  /* The mean over the other ports. */
+
+    double            *value,    /* In month t + 1, then t. */
+                      *next,
+                      *arrive,   /* In t + 1, before the events in port. */
+                      *calm,     /* Reaching each port from month t, */
+                      *blown,    /* blown off course on the way there, */
+                      *fought,   /* or after a battle. */
+                      *stage[2]; /* Hong Kong once the money is settled,
+                                  * with the rest kept or banked. */
+    struct fight      *fights;   /* By guns, capacity, damage and Li. */
+
+    /* For the bands' months: the best of each option and its port, by
+     * state and stage, and the money settled in Hong Kong. */
+    double            *best;
+    uint8_t           *dest,
+                      *finance,
+                      *cells;
+};
+
+/* Retiring or sinking in month t, or being cut off: what final_stats()
+ * makes of the firm's net worth. */
+static double score(double worth, int t)
+{
+    return worth / 100 / t;
+}
+
+/* Where x falls along axis a: the point below it, and how far on to the
+ * next.  Money runs on past the last point; the rest stop there. */
+static int place(const struct solver *s, int a, double x, double *frac)
+{
+    const double *at = s->at[a];
+    int          n = s->n[a],
+                 i;
+
+    for (i = 0; (i < n - 2) && (x >= at[i + 1]); i++)
+    {
+    }
+
+    *frac = (x - at[i]) / (at[i + 1] - at[i]);
+    if (*frac < 0)
+    {
+        *frac = 0;
+    } else if ((*frac > 1) && (a != SOLVE_DEBT) && (a != SOLVE_BANK) &&
+               (a != SOLVE_CASH)) {
+        *frac = 1;
+    }
+    if (*frac == 1)
+    {
+        i++;
+        *frac = 0;
+    }
+
+    return i;
+}
+
+/* table at x[SOLVE_AXES], between the states around it. */
+static double lookup(const struct solver *s, const double *table,
+                     const double *x)
+{
+    double frac[SOLVE_AXES],
+           sum = 0,
+           f,
+           w;
+    long   base = ((long) x[SOLVE_PORT] - 1) * s->stride[SOLVE_PORT],
+           i;
+    int    off[SOLVE_AXES],
+           n = 0,
+           a,
+           corner,
+           j;
+
+    for (a = SOLVE_PORT + 1; a < SOLVE_AXES; a++)
+    {
+        base += place(s, a, x[a], &f) * s->stride[a];
+        if (f != 0)
+        {
+            off[n]    = a;
+            frac[n++] = f;
+        }
+    }
+
+    for (corner = 0; corner < (1 << n); corner++)
+    {
+        i = base;
+        w = 1;
+        for (j = 0; j < n; j++)
+        {
+            if (corner & (1 << j))
+            {
+                i += s->stride[off[j]];
+                w *= frac[j];
+            } else {
+                w *= 1 - frac[j];
+            }
+        }
+        sum += w * table[i];
+    }
+
+    return sum;
+}
+
+/* A run of states along the cash at cash, and the run off further along
+ * the bank, frac of the way. */
+static double along(const struct solver *s, const double *row, long off,
+                    double frac, double cash)
+{
+    const double *at = s->at[SOLVE_CASH];
+    double       f,
+                 v;
+    int          lo = 0,
+                 hi = s->n[SOLVE_CASH] - 1,
+                 mid;
+
+    if (cash <= 0)
+    {
+        cash = 0;
+    }
+    if (cash >= at[hi])
+    {
+        lo = hi - 1;
+    } else {
+        while (hi - lo > 1)
+        {
+            mid = (lo + hi) / 2;
+            if (cash < at[mid])
+            {
+                hi = mid;
+            } else {
+                lo = mid;
+            }
+        }
+    }
+
+    f = (cash - at[lo]) / (at[lo + 1] - at[lo]);
+    v = row[lo] + (f * (row[lo + 1] - row[lo]));
+    if (frac != 0)
+    {
+        row += off;
+        v += frac * (row[lo] + (f * (row[lo + 1] - row[lo])) - v);
+    }
+
+    return v;
+}
+
+/* The grid values of state i. */
+static void state(const struct solver *s, long i, double *x)
+{
+    int a;
+
+    for (a = 0; a < SOLVE_AXES; a++)
+    {
+        x[a] = s->at[a][(i / s->stride[a]) % s->n[a]];
+    }
+}
+
+static struct fight *fight_at(const struct solver *s, long i)
+{
+    int g = (i / s->stride[SOLVE_GUNS]) % s->n[SOLVE_GUNS],
+        c = (i / s->stride[SOLVE_CAPACITY]) % s->n[SOLVE_CAPACITY],
+        m = (i / s->stride[SOLVE_DAMAGE]) % s->n[SOLVE_DAMAGE],
+        l = (i / s->stride[SOLVE_LI]) % s->n[SOLVE_LI];
+
+    return &s->fights[(((((g * s->n[SOLVE_CAPACITY]) + c) *
+                         s->n[SOLVE_DAMAGE]) + m) * s->n[SOLVE_LI]) + l];
+}
+
+/* ------------------------------------------------------------------------ *
+ * The voyage, backwards: from month t + 1 in port to month t at sea.
+ * ------------------------------------------------------------------------ */
+
+/* A fleet of id, from first to last ships strong, fought as greedy fights
+ * it, on average over its size: won, fled, lost and interrupted into
+ * odds[], and the damage, guns lost and booty taken. */
+static void fleet(const struct solver *s, int t, const double *x, int id,
+                  int first, int last, double *odds, double *damage,
+                  double *guns, double *booty)
+{
+    struct odds_query q;
+    const struct odds *o;
+    int               n,
+                      k;
+
+    q.id       = id;
+    q.orders   = (x[SOLVE_GUNS] > 0) ? ORDERS_FIGHT : ORDERS_RUN;
+    q.guns     = x[SOLVE_GUNS];
+    q.capacity = x[SOLVE_CAPACITY];
+    q.damage   = x[SOLVE_DAMAGE] * q.capacity / 100;
+    q.ec       = 20 + (10 * ((t - 1) / 12));
+
+    for (k = 0; k < 4; k++)
+    {
+        odds[k] = 0;
+    }
+    *damage = *guns = *booty = 0;
+    for (n = first; n <= last; n++)
+    {
+        q.num_ships = n;
+        o = odds_lookup(&s->odds, &q);
+        odds[0] += (double) o->won / ODDS_ONE;
+        odds[1] += (double) o->fled / ODDS_ONE;
+        odds[2] += (double) o->lost / ODDS_ONE;
+        odds[3] += (double) o->interrupted / ODDS_ONE;
+        *damage += o->damage;
+        *guns   += o->guns_lost;
+        *booty  += (double) o->won / ODDS_ONE *
+            (((t / 4) * 1000.0 * n) + 750);
+    }
+
+    n = last - first + 1;
+    for (k = 0; k < 4; k++)
+    {
+        odds[k] /= n;
+    }
+    *damage /= n;
+    *guns   /= n;
+    *booty  /= n;
+}
+
+/* The pirates, one time in bp, and Li Yuen after them or instead: if he
+ * has been paid he lets us be, and if not his own fleet attacks. */
+static void voyage_odds(const struct solver *s, int t, const double *x,
+                        struct fight *f)
+{
+    double pirates = 1.0 / s->bp,
+           li = 0,
+           g[4],
+           l[4] = { 0, 0, 0, 0 },
+           gd,
+           gg,
+           gb,
+           ld = 0,
+           lg = 0,
+           lb = 0,
+           gf,
+           lf;
+    int    cap = x[SOLVE_CAPACITY],
+           guns = x[SOLVE_GUNS];
+
+    fleet(s, t, x, GENERIC, 1, (cap / 10) + guns, g, &gd, &gg, &gb);
+    if (x[SOLVE_LI] == 0)
+    {
+        li = ((1 - pirates) / 4) + (pirates * g[3]);
+        fleet(s, t, x, LI_YUEN, 5, (cap / 5) + guns + 4, l, &ld, &lg, &lb);
+    }
+
+    gf = pirates * (g[0] + g[1]);
+    lf = li * (l[0] + l[1] + l[3]);
+
+    f->lost   = (pirates * g[2]) + (li * l[2]);
+    f->fought = gf + lf;
+    f->calm   = 1 - f->lost - f->fought;
+    if (f->fought > 0)
+    {
+        f->booty  = ((pirates * gb) + (li * lb)) / f->fought;
+        f->damage = ((gf * gd) + (lf * ld)) / f->fought;
+        f->guns   = ((gf * gg) + (lf * lg)) / f->fought;
+    } else {
+        f->booty = f->damage = f->guns = 0;
+    }
+}
+
+/* A ship in port in month t, from step on through the events there as
+ * greedy answers them, to the value it comes to. */
+static double in_port(const struct solver *s, int t, const double *in,
+                      int step)
+{
+    double x[SOLVE_AXES],
+           y[SOLVE_AXES],
+           offer,
+           v;
+    int    hk = (in[SOLVE_PORT] == HK),
+           j;
+
+    memcpy(x, in, sizeof(x));
+    memcpy(y, in, sizeof(y));
+
+    switch (step)
+    {
+        case 0:
+            /* Li Yuen's demand, paid if it can be. */
+            if (hk && (x[SOLVE_LI] == 0) && (x[SOLVE_CASH] > 0))
+            {
+                for (v = 0, j = 1; j < 4; j += 2)
+                {
+                    offer = (t > 12) ? (1500.0 * t) + (x[SOLVE_CASH] * j / 4) :
+                        x[SOLVE_CASH] / 1.8 * j / 4;
+                    memcpy(y, x, sizeof(y));
+                    if (offer <= y[SOLVE_CASH])
+                    {
+                        y[SOLVE_CASH] -= offer;
+                        y[SOLVE_LI]    = 1;
+                    }
+                    v += in_port(s, t, y, 1) / 2;
+                }
+                return v;
+            }
+            /* Fall through. */
+
+        case 1:
+            /* McHenry, for no more than half the cash; then Wu, paid off
+             * if he can be; then the cutthroats, if he is owed too much. */
+            if (hk && (x[SOLVE_DAMAGE] > 0))
+            {
+                offer = ((60.0 * (t + 3) / 4 / 2) + (25.0 * (t + 3) / 4)) *
+                    floor(x[SOLVE_CAPACITY] / 50) *
+                    (x[SOLVE_DAMAGE] * x[SOLVE_CAPACITY] / 100) + 1;
+                if (offer <= x[SOLVE_CASH] / 2)
+                {
+                    x[SOLVE_CASH]  -= offer;
+                    x[SOLVE_DAMAGE] = 0;
+                }
+            }
+            if (hk && (x[SOLVE_DEBT] > 0) && (x[SOLVE_CASH] >= x[SOLVE_DEBT]))
+            {
+                x[SOLVE_CASH] -= x[SOLVE_DEBT];
+                x[SOLVE_DEBT]  = 0;
+            }
+            if (hk && (x[SOLVE_DEBT] > 20000) && (x[SOLVE_CASH] > 0))
+            {
+                memcpy(y, x, sizeof(y));
+                y[SOLVE_CASH] = 0;
+                return (0.2 * in_port(s, t, y, 2)) +
+                    (0.8 * in_port(s, t, x, 2));
+            }
+            /* Fall through. */
+
+        case 2:
+            /* A new ship, one time in eight, for no more than half the
+             * cash.  Greedy buys no guns. */
+            offer = (1000.0 * (t + 5) / 6 / 2 * floor(x[SOLVE_CAPACITY] / 50)) +
+                1000;
+            if (offer <= x[SOLVE_CASH] / 2)
+            {
+                memcpy(y, x, sizeof(y));
+                y[SOLVE_CASH]     -= offer;
+                y[SOLVE_CAPACITY] += 50;
+                y[SOLVE_DAMAGE]    = 0;
+                return (in_port(s, t, y, 3) / 8) +
+                    (in_port(s, t, x, 3) * 7 / 8);
+            }
+            /* Fall through. */
+
+        case 3:
+            if (x[SOLVE_LI] > 0)
+            {
+                y[SOLVE_LI] = 0;
+                return (in_port(s, t, y, 4) / 60) +
+                    (in_port(s, t, x, 4) * 59 / 60);
+            }
+            /* Fall through. */
+
+        case 4:
+            /* Robbery, one time in twenty, of a sizeable sum. */
+            if (x[SOLVE_CASH] > 25000)
+            {
+                memcpy(y, x, sizeof(y));
+                y[SOLVE_CASH] *= 1 - (0.5 / 1.4);
+                return (in_port(s, t, y, 5) / 20) +
+                    (in_port(s, t, x, 5) * 19 / 20);
+            }
+            /* Fall through. */
+
+        default:
+            return lookup(s, s->value, x);
+    }
+}
+
+/* Arriving in month t + 1, or cut off there. */
+static void arrive_row(long r, void *arg)
+{
+    struct solver *s = arg;
+    double        x[SOLVE_AXES];
+    long          i;
+
+    for (i = r * s->n[SOLVE_CASH]; i < (r + 1) * s->n[SOLVE_CASH]; i++)
+    {
+        state(s, i, x);
+        if (s->t + 1 >= s->months)
+        {
+            s->arrive[i] = score(x[SOLVE_CASH] + x[SOLVE_BANK] -
+                                 x[SOLVE_DEBT], s->months);
+        } else {
+            s->arrive[i] = in_port(s, s->t + 1, x, 0);
+        }
+    }
+}
+
+/* Sailing into each port: the month turns, and Wu and the bank with it. */
+static void calm_row(long r, void *arg)
+{
+    struct solver *s = arg;
+    double        x[SOLVE_AXES];
+    long          i;
+
+    for (i = r * s->n[SOLVE_CASH]; i < (r + 1) * s->n[SOLVE_CASH]; i++)
+    {
+        state(s, i, x);
+        x[SOLVE_DEBT] *= 1.1;
+        x[SOLVE_BANK] *= 1.005;
+        s->calm[i] = lookup(s, s->arrive, x);
+    }
+}
+
+/* Blown off course to any other port, or in after a battle. */
+static void side_row(long r, void *arg)
+{
+    struct solver      *s = arg;
+    const struct fight *f = fight_at(s, r * s->n[SOLVE_CASH]);
+    double             x[SOLVE_AXES],
+                       sum;
+    long               i,
+                       k,
+                       home;
+    int                p;
+
+    for (i = r * s->n[SOLVE_CASH]; i < (r + 1) * s->n[SOLVE_CASH]; i++)
+    {
+        state(s, i, x);
+        home = i - ((long) (x[SOLVE_PORT] - 1) * s->stride[SOLVE_PORT]);
+        for (sum = 0, p = 1; p <= 7; p++)
+        {
+            k = home + ((p - 1) * s->stride[SOLVE_PORT]);
+            sum += (p != x[SOLVE_PORT]) ? s->calm[k] : 0;
+        }
+        s->blown[i] = sum / 6;
+
+        x[SOLVE_GUNS]   -= f->guns;
+        x[SOLVE_DAMAGE] += f->damage;
+        s->fought[i] = lookup(s, s->calm, x);
+    }
+}
+
+/* ------------------------------------------------------------------------ *
+ * The move in port in month t.
+ * ------------------------------------------------------------------------ */
+
+/* Loading option o at state i (x), banking the rest if bank, and sailing
+ * for each port: the best of them into *value, and its port returned. */
+static int voyage(const struct solver *s, long i, const double *x, int o,
+                  int bank, double *value)
+{
+    const struct fight *f = fight_at(s, i);
+    double             cash = x[SOLVE_CASH],
+                       units = 0,
+                       price = 0,
+                       frac = 0,
+                       lost,
+                       sale,
+                       v,
+                       q;
+    long               row,
+                       off = 0,
+                       k;
+    int                p = x[SOLVE_PORT],
+                       item = (o - 1) / LEVELS,
+                       best = 0,
+                       d,
+                       j;
+
+    if (o > 0)
+    {
+        price = s->mean[item][p] * levels[(o - 1) % LEVELS];
+        units = floor(cash / price);
+        if (units > x[SOLVE_CAPACITY] - (10 * x[SOLVE_GUNS]))
+        {
+            units = x[SOLVE_CAPACITY] - (10 * x[SOLVE_GUNS]);
+        }
+        units = (units > 0) ? units : 0;
+        cash -= units * price;
+    }
+
+    /* Sunk, the firm keeps its cash and its bank, but not the cargo. */
+    lost = f->lost * score(cash + x[SOLVE_BANK] - x[SOLVE_DEBT], s->t);
+
+    row = i - ((p - 1) * s->stride[SOLVE_PORT]) -
+        ((i / s->stride[SOLVE_CASH]) % s->n[SOLVE_CASH]);
+    if (bank)
+    {
+        k = (row / s->stride[SOLVE_BANK]) % s->n[SOLVE_BANK];
+        j = place(s, SOLVE_BANK, x[SOLVE_BANK] + cash, &frac);
+        row += (j - k) * s->stride[SOLVE_BANK];
+        off  = s->stride[SOLVE_BANK];
+        cash = 0;
+    }
+
+    *value = -HUGE_VAL;
+    for (d = 1; d <= 7; d++)
+    {
+        if (d == p)
+        {
+            continue;
+        }
+        k = row + ((d - 1) * s->stride[SOLVE_PORT]);
+        sale = (o > 0) ? units * s->mean[item][d] * JUMP : 0;
+
+        for (v = 0, j = 0; j < 3; j++)
+        {
+            v += along(s, s->calm + k, off, frac, cash + (sale * draws[j]));
+        }
+        v = (v / 3 * 29 / 30) + (along(s, s->blown + k, off, frac, cash +
+                    ((o > 0) ? units * s->other[item][d] * JUMP : 0)) / 30);
+        if ((o > 0) && (item == 0) && (d != HK))
+        {
+            /* The opium seized, and a fine. */
+            v = (v * 17 / 18) + (along(s, s->calm + k, off, frac,
+                        cash * (1 - (0.5 / 1.8))) / 18);
+        }
+
+        q = (f->calm * v) + lost + (f->fought * along(s, s->fought + k, off,
+                    frac, cash + f->booty + sale));
+        if (q > *value)
+        {
+            *value = q;
+            best   = d;
+        }
+    }
+
+    return best;
+}
+
+/* What levels[] each good is at in pattern, as options. */
+static void pattern_options(int pattern, int *opt)
+{
+    int k;
+
+    for (k = 3; k >= 0; k--)
+    {
+        opt[k] = 1 + (k * LEVELS) + 1 + (pattern % 3);
+        pattern /= 3;
+    }
+}
+
+/* The best of nothing and each good's option in opt[] (-1 if none). */
+static int pick(const double *best, const int *opt)
+{
+    int o = 0,
+        k;
+
+    for (k = 0; k < 4; k++)
+    {
+        if ((opt[k] >= 0) && (best[opt[k]] > best[o]))
+        {
+            o = opt[k];
+        }
+    }
+
+    return o;
+}
+
+/* The best option on average over the prices, as set_prices() and the
+ * good prices event draw them: 8 times in 9 no event, and otherwise one
+ * good in four cut or raised. */
+static double expect(const double *best)
+{
+    double sum = 0,
+           event = 0;
+    int    opt[4],
+           pattern,
+           k,
+           cut;
+
+    for (pattern = 0; pattern < SOLVE_PATTERNS; pattern++)
+    {
+        pattern_options(pattern, opt);
+        sum += best[pick(best, opt)];
+
+        /* Only the patterns with good k middling stand for the others
+         * with k cut or raised. */
+        for (k = 0; k < 4; k++)
+        {
+            if (opt[k] != 1 + (k * LEVELS) + 2)
+            {
+                continue;
+            }
+            for (cut = 0; cut < 2; cut++)
+            {
+                opt[k] = cut ? 1 + (k * LEVELS) : -1;
+                event += best[pick(best, opt)];
+            }
+            opt[k] = 1 + (k * LEVELS) + 2;
+        }
+    }
+
+    return (sum * 8 / 9 / SOLVE_PATTERNS) + (event / 72 / 27);
+}
+
+/* The month band b's moves are kept from. */
+static int kept(const struct solver *s, int b)
+{
+    return (solve_month(b) < s->months) ? solve_month(b) : s->months - 1;
+}
+
+/* Whether month t's moves are kept for a band. */
+static int keeps(const struct solver *s, int t)
+{
+    int b;
+
+    for (b = 0; b < SOLVE_BANDS; b++)
+    {
+        if (t == kept(s, b))
+        {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+/* Every option at each state, and what the best of them is worth; in Hong
+ * Kong, once the money is settled either way. */
+static void trade_row(long r, void *arg)
+{
+    struct solver *s = arg;
+    double        x[SOLVE_AXES],
+                  best[OPTIONS];
+    long          i;
+    int           keep = keeps(s, s->t),
+                  stages,
+                  bank,
+                  o,
+                  d;
+
+    for (i = r * s->n[SOLVE_CASH]; i < (r + 1) * s->n[SOLVE_CASH]; i++)
+    {
+        state(s, i, x);
+        stages = (x[SOLVE_PORT] == HK) ? 2 : 1;
+        for (bank = 0; bank < stages; bank++)
+        {
+            for (o = 0; o < OPTIONS; o++)
+            {
+                d = voyage(s, i, x, o, bank, &best[o]);
+                if (keep)
+                {
+                    s->best[(((i * 2) + bank) * OPTIONS) + o] = best[o];
+                    s->dest[(((i * 2) + bank) * OPTIONS) + o] = d;
+                }
+            }
+            if (stages == 1)
+            {
+                s->next[i] = expect(best);
+            } else {
+                s->stage[bank][i] = expect(best);
+            }
+        }
+    }
+}
+
+/* In Hong Kong, where the money is settled first, the state the settling
+ * leaves and the stage it trades from; -1 if it will not do. */
+static int settle(const struct solver *s, const double *x, int finance,
+                  double *y)
+{
+    double pay;
+
+    memcpy(y, x, SOLVE_AXES * sizeof(*y));
+    switch (finance)
+    {
+        case MCTS_KEEP:
+            return 0;
+
+        case MCTS_BANK:
+            return 1;
+
+        case MCTS_REPAY:
+            y[SOLVE_CASH] += y[SOLVE_BANK];
+            y[SOLVE_BANK]  = 0;
+            pay = (y[SOLVE_CASH] < y[SOLVE_DEBT]) ? y[SOLVE_CASH] :
+                y[SOLVE_DEBT];
+            y[SOLVE_CASH] -= pay;
+            y[SOLVE_DEBT] -= pay;
+            return 1;
+
+        case MCTS_BORROW:
+        default:
+            /* No further than the grid goes. */
+            if (x[SOLVE_DEBT] + (2 * x[SOLVE_CASH]) >
+                    s->at[SOLVE_DEBT][s->n[SOLVE_DEBT] - 1])
+            {
+                return -1;
+            }
+            y[SOLVE_DEBT] += 2 * x[SOLVE_CASH];
+            y[SOLVE_CASH] *= 3;
+            return 0;
+    }
+}
+
+/* Retire, or settle with Wu and the bank one of four ways. */
+#define RETIRE 4
+
+static void finance_row(long r, void *arg)
+{
+    struct solver *s = arg;
+    double        x[SOLVE_AXES],
+                  y[SOLVE_AXES],
+                  v,
+                  most;
+    long          i;
+    int           how,
+                  stage,
+                  choice;
+
+    for (i = r * s->n[SOLVE_CASH]; i < (r + 1) * s->n[SOLVE_CASH]; i++)
+    {
+        state(s, i, x);
+        most   = -HUGE_VAL;
+        choice = MCTS_KEEP;
+        for (how = MCTS_KEEP; how <= MCTS_BORROW; how++)
+        {
+            if ((stage = settle(s, x, how, y)) < 0)
+            {
+                continue;
+            }
+            v = lookup(s, s->stage[stage], y);
+            if (v > most)
+            {
+                most   = v;
+                choice = how;
+            }
+        }
+        if ((x[SOLVE_CASH] + x[SOLVE_BANK] >= 1000000) &&
+                ((v = score(x[SOLVE_CASH] + x[SOLVE_BANK] - x[SOLVE_DEBT],
+                            s->t)) > most))
+        {
+            most   = v;
+            choice = RETIRE;
+        }
+        s->next[i]    = most;
+        s->finance[i] = choice;
+    }
+}
+
+/* The moves for a band, from what trade_row() and finance_row() kept. */
+static void write_row(long r, void *arg)
+{
+    struct solver    *s = arg;
+    struct mcts_move move;
+    double           x[SOLVE_AXES],
+                     y[SOLVE_AXES];
+    uint8_t          *cell;
+    long             i,
+                     j;
+    int              opt[4],
+                     pattern,
+                     stage,
+                     o;
+
+    for (i = r * s->n[SOLVE_CASH]; i < (r + 1) * s->n[SOLVE_CASH]; i++)
+    {
+        state(s, i, x);
+        cell = s->cells + (i * SOLVE_PATTERNS);
+
+        move.sell    = 1;
+        move.finance = MCTS_KEEP;
+        move.half    = 0;
+        j     = i;
+        stage = 0;
+        if (x[SOLVE_PORT] == HK)
+        {
+            if (s->finance[i] == RETIRE)
+            {
+                move.buy  = -1;
+                move.dest = 0;
+                memset(cell, solve_code(&move), SOLVE_PATTERNS);
+                continue;
+            }
+            move.finance = s->finance[i];
+            stage = settle(s, x, move.finance, y);
+            j = solve_state(y);
+        }
+
+        for (pattern = 0; pattern < SOLVE_PATTERNS; pattern++)
+        {
+            pattern_options(pattern, opt);
+            o = pick(s->best + (((j * 2) + stage) * OPTIONS), opt);
+            move.buy  = (o > 0) ? (o - 1) / LEVELS : -1;
+            move.dest = s->dest[(((j * 2) + stage) * OPTIONS) + o];
+            cell[pattern] = solve_code(&move);
+        }
+    }
+}
+
+void usage(void)
+{
+    fprintf(stderr,
+            "usage: taipan-solve [-j threads] [-m months] [-b odds] [-o file]\n"
+            "       taipan-solve -p games [-v] [-s seed] [-o file]\n");
+    exit(1);
+}
+
+static double *grab(long n)
+{
+    return malloc(n * sizeof(double));
+}
+
+/* Works the table out into s->cells; returns what a new game is worth, or
+ * HUGE_VAL if out of memory. */
+static double solve(struct solver *s, int threads)
+{
+    struct solver band;
+    double        x[SOLVE_AXES],
+                  *swap;
+    long          i;
+    int           a,
+                  b,
+                  k,
+                  p;
+
+    s->states = solve_states();
+    for (a = SOLVE_AXES - 1; a >= 0; a--)
+    {
+        s->n[a]      = solve_points(a, &s->at[a]);
+        s->stride[a] = (a == SOLVE_AXES - 1) ? 1 :
+            s->stride[a + 1] * s->n[a + 1];
+    }
+    s->rows = s->states / s->n[SOLVE_CASH];
+
+    for (k = 0; k < 4; k++)
+    {
+        for (p = 1; p <= 7; p++)
+        {
+            s->mean[k][p] = game_mean_price(k, p);
+        }
+        for (p = 1; p <= 7; p++)
+        {
+            s->other[k][p] = 0;
+            for (a = 1; a <= 7; a++)
+            {
+                s->other[k][p] += (a != p) ? s->mean[k][a] / 6 : 0;
+            }
+        }
+    }
+
+    s->value    = grab(s->states);
+    s->next     = grab(s->states);
+    s->arrive   = grab(s->states);
+    s->calm     = grab(s->states);
+    s->blown    = grab(s->states);
+    s->fought   = grab(s->states);
+    s->stage[0] = grab(s->states);
+    s->stage[1] = grab(s->states);
+    s->best     = grab(s->states * 2 * OPTIONS);
+    s->dest     = calloc(s->states * 2, OPTIONS);
+    s->finance  = calloc(s->states, 1);
+    s->fights   = calloc(s->stride[SOLVE_BANK] / s->stride[SOLVE_LI],
+                         sizeof(*s->fights));
+    s->cells    = calloc(solve_cells(), 1);
+    if ((s->value == NULL) || (s->next == NULL) || (s->arrive == NULL) ||
+            (s->calm == NULL) || (s->blown == NULL) || (s->fought == NULL) ||
+            (s->stage[0] == NULL) || (s->stage[1] == NULL) ||
+            (s->best == NULL) || (s->dest == NULL) || (s->finance == NULL) ||
+            (s->fights == NULL) || (s->cells == NULL))
+    {
+        return HUGE_VAL;
+    }
+
+    for (s->t = s->months - 1; s->t >= 1; s->t--)
+    {
+        /* The month's battles, for each state of the ship. */
+        for (i = 0; i < s->stride[SOLVE_BANK]; i += s->stride[SOLVE_LI])
+        {
+            state(s, i, x);
+            voyage_odds(s, s->t, x, fight_at(s, i));
+        }
+
+        if ((pool_run(threads, s->rows, arrive_row, s) != 0) ||
+                (pool_run(threads, s->rows, calm_row, s) != 0) ||
+                (pool_run(threads, s->rows, side_row, s) != 0) ||
+                (pool_run(threads, s->rows, trade_row, s) != 0) ||
+                (pool_run(threads, s->rows / 7, finance_row, s) != 0))
+        {
+            return HUGE_VAL;
+        }
+
+        for (b = 0; b < SOLVE_BANDS; b++)
+        {
+            band = *s;
+            band.cells += b * s->states * SOLVE_PATTERNS;
+            if ((s->t == kept(s, b)) &&
+                    (pool_run(threads, s->rows, write_row, &band) != 0))
+            {
+                return HUGE_VAL;
+            }
+        }
+
+        swap     = s->value;
+        s->value = s->next;
+        s->next  = swap;
+    }
+
+    /* A new game: in Hong Kong with the cash and Wu's loan. */
+    x[SOLVE_PORT]     = HK;
+    x[SOLVE_DEBT]     = 5000;
+    x[SOLVE_BANK]     = 0;
+    x[SOLVE_GUNS]     = 0;
+    x[SOLVE_CAPACITY] = 60;
+    x[SOLVE_DAMAGE]   = 0;
+    x[SOLVE_LI]       = 0;
+    x[SOLVE_CASH]     = 400;
+
+    return in_port(s, 1, x, 0);
+}
+
+static void release(struct solver *s)
+{
+    free(s->value);
+    free(s->next);
+    free(s->arrive);
+    free(s->calm);
+    free(s->blown);
+    free(s->fought);
+    free(s->stage[0]);
+    free(s->stage[1]);
+    free(s->best);
+    free(s->dest);
+    free(s->finance);
+    free(s->fights);
+    free(s->cells);
+}
+
+/* Plays games with the table at path, greedy answering everything but the
+ * moves in port, up to the horizon the table was worked out for. */
+static int play(const char *path, long games, uint64_t seed, int verbose)
+{
+    struct solve_table t;
+    struct game_state  g;
+    struct game_event  ev;
+    struct player      p;
+    struct mcts_move   move;
+    long               moves = 0,
+                       i;
+    int                count[5] = { 0 },
+                       cause,
+                       c;
+    long long          score = 0;
+    double             looking = 0,
+                       start;
+
+    if (solve_open(&t, path) != 0)
+    {
+        fprintf(stderr, "taipan-solve: no policy table in %s\n", path);
+        return 1;
+    }
+
+    if (verbose)
+    {
+        printf("%10s %12s %14s %7s  %s\n",
+               "seed", "score", "net worth", "months", "end");
+    }
+    for (i = 0; i < games; i++)
+    {
+        game_init(&g);
+        game_seed(&g, seed + i);
+        player_init(&p, policy_find("greedy"), ~(seed + i));
+        player_start(&p, &g);
+
+        cause = 0;  /* Cut off. */
+        for (;;)
+        {
+            if (game_step(&g, &ev) == EV_GAME_OVER)
+            {
+                cause = ev.n;
+                break;
+            }
+            if ((ev.type == EV_ARRIVING) && (game_months(&g) >= t.months))
+            {
+                break;
+            }
+            if (ev.type != EV_PORT)
+            {
+                player_answer(&p, &g, &ev);
+                continue;
+            }
+
+            start = seconds();
+            solve_move(&t, &g, &move);
+            looking += seconds() - start;
+            mcts_apply(&g, &move);
+            moves++;
+        }
+
+        if (verbose)
+        {
+            printf("%10llu %12lld %14lld %7d  %s\n",
+                   (unsigned long long) (seed + i), game_score(&g),
+                   game_net_worth(&g), game_months(&g), causes[cause]);
+        }
+        score += game_score(&g);
+        count[cause]++;
+    }
+
+    printf("%ld games from seed %llu, cut off at %d months\n\n", games,
+           (unsigned long long) seed, t.months);
+    printf("mean score %.1f\n", (double) score / games);
+    for (c = 1; c <= 5; c++)
+    {
+        int k = c % 5;  /* The cut-off games last. */
+
+        printf("%-10s %8d  %5.1f%%\n", causes[k], count[k],
+               100.0 * count[k] / games);
+    }
+    printf("\n%ld moves looked up, %.0f ns each\n", moves,
+           (moves > 0) ? looking * 1e9 / moves : 0);
+
+    solve_close(&t);
+
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    struct solver       s;
+    struct solve_header h;
+    char                *path = SOLVE_FILE,
+                        *odds = ODDS_FILE,
+                        tmp[4096];
+    uint64_t            seed = 1;
+    long                games = 0;
+    int                 threads = 0,
+                        verbose = 0,
+                        c;
+    double              value,
+                        elapsed;
+    FILE                *fp;
+
+    memset(&s, 0, sizeof(s));
+    s.months = 240;
+    s.bp     = 10;  /* Starting with cash, as the policies all do. */
+
+    while ((c = getopt(argc, argv, "j:m:b:o:p:vs:")) != -1)
+    {
+        switch (c)
+        {
+            case 'j':
+                threads = number(optarg);
+                break;
+
+            case 'm':
+                s.months = number(optarg);
+                break;
+
+            case 'b':
+                odds = optarg;
+                break;
+
+            case 'o':
+                path = optarg;
+                break;
+
+            case 'p':
+                games = number(optarg);
+                break;
+
+            case 'v':
+                verbose = 1;
+                break;
+
+            case 's':
+                seed = number(optarg);
+                break;
+
+            default:
+                usage();
+        }
+    }
+    if ((optind != argc) || (s.months < 2))
+    {
+        usage();
+    }
+    if (games > 0)
+    {
+        return play(path, games, seed, verbose);
+    }
+
+    if (odds_open(&s.odds, odds) != 0)
+    {
+        fprintf(stderr,
+                "taipan-solve: no battle odds in %s; build them with taipan-odds\n",
+                odds);
+        return 1;
+    }
+
+    elapsed = seconds();
+    if ((value = solve(&s, threads)) == HUGE_VAL)
+    {
+        fprintf(stderr, "taipan-solve: out of memory\n");
+        return 1;
+    }
+    elapsed = seconds() - elapsed;
+
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, "TAIPANPT", 8);
+    h.version = SOLVE_VERSION;
+    h.cells   = solve_cells();
+    h.months  = s.months;
+    h.value   = value;
+
+    /* Written aside and moved into place, as the battle odds are. */
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+    if (((fp = fopen(tmp, "wb")) == NULL) ||
+            (fwrite(&h, sizeof(h), 1, fp) != 1) ||
+            (fwrite(s.cells, 1, h.cells, fp) != h.cells) ||
+            (fclose(fp) != 0) ||
+            (rename(tmp, path) != 0))
+    {
+        perror(path);
+        return 1;
+    }
+
+    printf("%ld states in %d bands of months, by %d patterns of prices, "
+           "%d months ahead\n", s.states, SOLVE_BANDS, SOLVE_PATTERNS,
+           s.months);
+    printf("worked out in %.1f s and written to %s; a new game should "
+           "score %.0f\n", elapsed, path, value);
+
+    release(&s);
+    odds_close(&s.odds);
+
+    return 0;
+}
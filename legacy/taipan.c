@@ -12,54 +12,58 @@
  *   Ronald J. Berg
  * ------------------------------------------------------------------------ */
 
-#include <assert.h>  /* EJB */
+#ifdef TAIPAN_ANSI
+#include "ansi.h"
+#else
 #include <curses.h>
+#endif
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/ioctl.h>
 #include <unistd.h>
 
-#define GENERIC 1
-#define LI_YUEN 2
-
-#define BATTLE_NOT_FINISHED 0
-#define BATTLE_WON          1
-#define BATTLE_INTERRUPTED  2
-#define BATTLE_FLED         3
-#define BATTLE_LOST         4
+#include "engine.h"
+#include "journal.h"
+#ifndef TAIPAN_ANSI
+#include "advice.h"
+#include "search.h"
+#endif
+#include "taipan.h"
 
 void splash_intro(void);
 int get_one(void);
 long get_num(int maxlen);
 void name_firm(void);
 void cash_or_guns(void);
-void set_prices(void);
 void port_stats(void);
 int port_choices(void);
+void port_menu(void);
 void new_ship(void);
 void new_gun(void);
 void li_yuen_extortion(void);
 void elder_brother_wu(void);
-void good_prices(void);
+void good_prices(int i, int j);
 void buy(void);
 void sell(void);
 void visit_bank(void);
 void transfer(void);
 void quit(void);
+void captains_report(struct game_event *ev);
 void overload(void);
 void fancy_numbers(float num, char *fancy);
-int sea_battle(int id, int num_ships);
-void draw_lorcha(int x, int y);
-void clear_lorcha(int x, int y);
-void draw_blast(int x, int y);
-void sink_lorcha(int x, int y);
+void battle(struct game_event *ev);
+void quick_battle(void);
+void sea_battle(struct game_event *ev);
+int battle_orders(int input, int orders);
+void draw_sprite(int sprite, int slot);
+void sink_lorcha(int slot, int slow);
 void fight_stats(int ships, int orders);
 void mchenry(void);
 void retire(void);
-void final_stats(void);
+int final_stats(void);
 
-char    firm[23],
-        fancy_num[13];
+char    fancy_num[13];
 
 char    *item[] = { "Opium", "Silk", "Arms", "General Cargo" };
 
@@ -72,300 +76,310 @@ char    *months[] = { "Jan", "Feb", "Mar", "Apr", "May", "Jun",
 char    *st[] = { "Critical", "  Poor", "  Fair",
     "  Good", " Prime", "Perfect" };
 
-/* EJB: Why are all these floats? Most of them should be uints. */
+/* The game being played; the rules live in engine.c. */
+struct game_state game,
+                  *g = &game;
 
-uint
-#ifdef DEBUG
-        cash         = 100000,
-        bank         = 1000000,
-#else
-        cash         = 0,
-        bank         = 0,
-#endif
-        debt         = 0,
-        booty        = 0;
-float   ec           = 20,   /* Base health of enemies; grows over time. */
-        ed           = 0.5;  /* Damage dealt by enemies; grows over time. */
-
-long    price[4];
-
-int     base_price[4][8] = { {1000, 11, 16, 15, 14, 12, 10, 13},
-    {100,  11, 14, 15, 16, 10, 13, 12},
-    {10,   12, 16, 10, 11, 13, 14, 15},
-    {1,    10, 11, 12, 13, 14, 15, 16} };
-
-int     hkw_[4],
-        hold_[4];
-
-int     hold         = 0,
-        capacity     = 60,
-        guns         = 0,
-        bp           = 0,
-        damage       = 0,
-        month        = 1,
-        year         = 1860,
-        li           = 0,
-        port         = 1,
-        wu_warn      = 0,
-        wu_bailout   = 0;
-
-int main(void)
-{
-    int choice;
+int     quick = 0;  /* -q: settle sea battles at once, with no show. */
+
+/* -j: every key read is written here.  -r: every key read comes from here
+ * instead, with no waiting. */
+struct journal journal;
+int            replay = 0;
 
-    srand(getpid());
+static int  term_key(int wait);
+static void term_nap(long usec);
+static void term_flush(void);
+static int  term_behind(void);
 
-    initscr();
-    cbreak();
-    noecho();
-    curs_set(0);  // EJB: Set cursor to invisible - EJB: this is not working (and I would only want this done during battle anyway, not on user prompts.)
+struct ui_io term_io = { term_key, term_nap, term_flush, term_behind },
+             *io = &term_io;
+
+/* Plays g, set up by game_init() and game_seed(), and any games after it
+ * until the player will play no more. */
+void taipan(void)
+{
+    struct game_event ev;
 
     splash_intro();
     name_firm();
     cash_or_guns();
-    set_prices();
 
     for (;;)
     {
-        choice = 0;
+        switch (game_step(g, &ev))
+        {
+            case EV_IN_PORT:
+                port_stats();
+                break;
 
-        port_stats();
+            case EV_LI_YUEN_DEMAND:
+                li_yuen_extortion();
+                break;
 
-        if ((port == 1) && (li == 0) && (cash > 0))
-        {
-            li_yuen_extortion();
-        }
+            case EV_MCHENRY:
+                mchenry();
+                break;
 
-        if ((port == 1) && (damage > 0))
-        {
-            mchenry();
-        }
+            case EV_WU_WARNING:
+                move(16, 0);
+                clrtobot();
+                printw("Comprador's Report\n\n");
+                printw("Elder Brother Wu has sent %d braves\n", ev.n);
+                printw("to escort you to the Wu mansion, Taipan.\n");
 
-        if ((port == 1) && (debt >= 10000) && (wu_warn == 0))
-        {
-            int braves = rand()%100 + 50;
+                refresh();
+                get_key(3000);
 
-            move(16, 0);
-            clrtobot();
-            printw("Comprador's Report\n\n");
-            printw("Elder Brother Wu has sent %d braves\n", braves);
-            printw("to escort you to the Wu mansion, Taipan.\n");
+                move(18, 0);
+                clrtobot();
+                printw("Elder Brother Wu reminds you of the\n");
+                printw("Confucian ideal of personal worthiness,\n");
+                printw("and how this applies to paying one's\n");
+                printw("debts.\n");
 
-            refresh();
-            timeout(3000);
-            getch();
-            timeout(-1);
+                refresh();
+                get_key(3000);
 
-            move(18, 0);
-            clrtobot();
-            printw("Elder Brother Wu reminds you of the\n");
-            printw("Confucian ideal of personal worthiness,\n");
-            printw("and how this applies to paying one's\n");
-            printw("debts.\n");
+                move(18, 0);
+                clrtobot();
+                printw("He is reminded of a fabled barbarian\n");
+                printw("who came to a bad end, after not caring\n");
+                printw("for his obligations.\n\n");
+                printw("He hopes no such fate awaits you, his\n");
+                printw("friend, Taipan.\n");
 
-            refresh();
-            timeout(3000);
-            getch();
-            timeout(-1);
+                refresh();
+                get_key(5000);
+                break;
 
-            move(18, 0);
-            clrtobot();
-            printw("He is reminded of a fabled barbarian\n");
-            printw("who came to a bad end, after not caring\n");
-            printw("for his obligations.\n\n");
-            printw("He hopes no such fate awaits you, his\n");
-            printw("friend, Taipan.\n");
+            case EV_WU:
+                elder_brother_wu();
+                break;
 
-            refresh();
-            timeout(5000);
-            getch();
-            timeout(-1);
+            case EV_CUTTHROATS:
+                port_stats();
 
-            wu_warn = 1;
-        }
+                move(16, 0);
+                clrtobot();
+                printw("Comprador's Report\n\n");
+                printw("Bad joss!!\n");
+                printw("%d of your bodyguards have been killed\n", ev.n);
+                printw("by cutthroats and you have been robbed\n");
+                printw("of all of your cash, Taipan!!\n");
 
-        if (port == 1)
-        {
-            elder_brother_wu();
-        }
+                refresh();
+                get_key(5000);
+                break;
 
-        if (rand()%4 == 0)
-        {
-            if (rand()%2 == 0)
-            {
+            case EV_NEW_SHIP:
                 new_ship();
-            } else if (guns < 1000) {
+                break;
+
+            case EV_NEW_GUN:
                 new_gun();
-            }
-        }
+                break;
 
-        if ((port != 1) && (rand()%18 == 0) && (hold_[0] > 0))
-        {
-            float fine = ((cash / 1.8) * ((float) rand() / RAND_MAX)) + 1;
-            /* EJB: Prevent -1 cash */
-            if (cash == 0)
-            {
-                fine = 0;
-            }
+            case EV_OPIUM_SEIZED:
+                port_stats();
 
-            hold += hold_[0];
-            hold_[0] = 0;
-            cash -= fine;
+                fancy_numbers(ev.amount, fancy_num);
+                move(16, 0);
+                clrtobot();
+                printw("Comprador's Report\n\n");
+                printw("Bad Joss!!\n");
+                printw("The local authorities have seized your\n");
+                /* EJB */
+                if (ev.amount <= 0)
+                {
+                    printw("Opium cargo, Taipan!");
+                }
+                else
+                {
+                    printw("Opium cargo and have also fined you\n");
+                    printw("%s, Taipan!\n", fancy_num);
+                }
+                refresh();
+                get_key(5000);
+                break;
 
-            port_stats();
+            case EV_WAREHOUSE_THEFT:
+                port_stats();
 
-            fancy_numbers(fine, fancy_num);
-            move(16, 0);
-            clrtobot();
-            printw("Comprador's Report\n\n");
-            printw("Bad Joss!!\n");
-            printw("The local authorities have seized your\n");
-            /* EJB */
-            if (fine <= 0)
-            {
-                printw("Opium cargo, Taipan!");
-            }
-            else
-            {
-                printw("Opium cargo and have also fined you\n");
-                printw("%s, Taipan!\n", fancy_num);
-            }
-            refresh();
-            timeout(5000);
-            getch();
-            timeout(-1);
-        }
+                move(16, 0);
+                clrtobot();
+                printw("Comprador's Report\n\n");
+                printw("Messenger reports large theft\n");
+                printw("from warehouse, Taipan.\n");
 
-        if ((rand()%50 == 0) &&
-                ((hkw_[0] + hkw_[1] + hkw_[2] + hkw_[3]) > 0))
-        {
-            int i;
+                refresh();
+                get_key(5000);
+                break;
 
-            for (i = 0; i < 4; i++)
-            {
-                hkw_[i] = ((hkw_[i] / 1.8) * ((float) rand() / RAND_MAX));
-            }
+            case EV_LI_YUEN_SUMMONS:
+                move(16, 0);
+                clrtobot();
+                printw("Comprador's Report\n\n");
+                printw("Li Yuen has sent a Lieutenant,\n");
+                printw("Taipan.  He says his admiral wishes\n");
+                printw("to see you in Hong Kong, posthaste!\n");
 
-            port_stats();
+                refresh();
+                get_key(3000);
+                break;
 
-            move(16, 0);
-            clrtobot();
-            printw("Comprador's Report\n\n");
-            printw("Messenger reports large theft\n");
-            printw("from warehouse, Taipan.\n");
+            case EV_GOOD_PRICES:
+                good_prices(ev.n, ev.m);
+                break;
 
-            refresh();
-            timeout(5000);
-            getch();
-            timeout(-1);
-        }
+            case EV_ROBBERY:
+                port_stats();
 
-        if (rand()%20 == 0)
-        {
-            if (li > 0) { li++; }
-            if (li == 4) { li = 0; }
-        }
+                fancy_numbers(ev.amount, fancy_num);
+                move(16, 0);
+                clrtobot();
+                printw("Comprador's Report\n\n");
+                printw("Bad Joss!!\n");
+                printw("You've been beaten up and\n");
+                printw("robbed of %s in cash, Taipan!!\n", fancy_num);
 
-        if ((port != 1) && (li == 0) && (rand()%4 != 0))
-        {
-            move(16, 0);
-            clrtobot();
-            printw("Comprador's Report\n\n");
-            printw("Li Yuen has sent a Lieutenant,\n");
-            printw("Taipan.  He says his admiral wishes\n");
-            printw("to see you in Hong Kong, posthaste!\n");
+                refresh();
+                get_key(5000);
+                break;
 
-            refresh();
-            timeout(3000);
-            getch();
-            timeout(-1);
+            case EV_PORT:
+                port_menu();
+                break;
+
+            case EV_GAME_OVER:
+                if (ev.n == GAME_RETIRED)
+                {
+                    retire();
+                } else if (ev.n == GAME_FOUNDERED) {
+                    printw("We're going down, Taipan!!\n");
+                    refresh();
+                    get_key(5000);
+                }
+                if (!final_stats())
+                {
+                    return;
+                }
+                break;
+
+            default:
+                captains_report(&ev);
         }
+    }
+}
 
-        if (rand()%9 == 0)
+/* Every key the game reads comes through here.  Waits at most wait
+ * milliseconds (-1 for as long as it takes), and returns ERR if no key
+ * came. */
+int get_key(int wait)
+{
+    int input;
+
+    if (replay)
+    {
+        if (!journal_read(&journal, &input))
         {
-            good_prices();
+            replay_over();
         }
+        return input;
+    }
 
-        if ((cash > 25000) && (rand()%20 == 0))
-        {
-            float robbed = ((cash / 1.4) * ((float) rand() / RAND_MAX));
+    input = io->key(wait);
 
-            cash -= robbed;
-            port_stats();
+    if (journal.fp != NULL)
+    {
+        journal_write(&journal, input);
+    }
 
-            fancy_numbers(robbed, fancy_num);
-            move(16, 0);
-            clrtobot();
-            printw("Comprador's Report\n\n");
-            printw("Bad Joss!!\n");
-            printw("You've been beaten up and\n");
-            printw("robbed of %s in cash, Taipan!!\n", fancy_num);
+    return input;
+}
 
-            refresh();
-            timeout(5000);
-            getch();
-            timeout(-1);
-        }
+/* Pauses for the show; a replay doesn't. */
+void nap(long usec)
+{
+    if (!replay)
+    {
+        io->nap(usec);
+    }
+}
 
-        for (;;)
-        {
-            while ((choice != 'Q') && (choice != 'q'))
-            {
-                switch (choice = port_choices())
-                {
-                    case 'B':
-                    case 'b':
-                        buy();
-                        break;
+/* Shows what has been drawn as a frame of an animation, for usec.  If
+ * the terminal is behind, the frame is dropped instead: the animation
+ * runs on to its end unseen, and the next refresh() shows where it ended
+ * up.  The game goes the same either way. */
+static void animate(long usec)
+{
+    if (!io->behind())
+    {
+        refresh();
+        nap(usec);
+    }
+}
 
-                    case 'S':
-                    case 's':
-                        sell();
-                        break;
+/* Throws away keys typed ahead. */
+void flush_keys(void)
+{
+    if (!replay)
+    {
+        io->flush();
+    }
+}
 
-                    case 'V':
-                    case 'v':
-                        visit_bank();
-                        break;
+static int term_key(int wait)
+{
+    int input;
 
-                    case 'T':
-                    case 't':
-                        transfer();
-                        break;
-                    case 'W':
-                    case 'w':
-                        elder_brother_wu();
-                        break;
-                    case 'R':
-                    case 'r':
-                        retire();
-                }
+    timeout(wait);
+    input = getch();
+    timeout(-1);
 
-                port_stats();
-            }
+    return input;
+}
 
-            choice = 0;
-            if (hold >= 0)
-            {
-                quit();
-                break;
-            } else {
-                overload();
-            }
-        }
-    }
+static void term_nap(long usec)
+{
+    usleep(usec);
+}
+
+static void term_flush(void)
+{
+    flushinp();
+}
 
+/* What curses has written that the terminal (or the ssh or telnet session
+ * behind it) has not yet read. */
+static int term_behind(void)
+{
+    int queued;
+
+    return (ioctl(STDOUT_FILENO, TIOCOUTQ, &queued) == 0) &&
+           (queued > UI_BEHIND);
+}
+
+/* The end of a replay, or of a game being replayed: say how it stands. */
+void replay_over(void)
+{
     clear();
     refresh();
     nocbreak();
     endwin();
 
-    return EXIT_SUCCESS;
+    printf("%s: %s %d, %s, %d months, cash %u, bank %u, debt %u, "
+           "net worth %lld, score %lld, %s\n",
+           g->firm, months[g->month - 1], g->year, location[g->port],
+           game_months(g), g->cash, g->bank, g->debt, game_net_worth(g),
+           game_score(g), g->over ? "game over" : "still playing");
+
+    exit(0);
 }
 
 void splash_intro(void)
 {
-    flushinp();
+    flush_keys();
     clear();
     printw("\n");
     printw("         _____  _    ___ ____   _    _   _               ===============\n");
@@ -394,7 +408,7 @@ void splash_intro(void)
     curs_set(0);
     refresh();
 
-    getch();
+    get_key(-1);
     curs_set(1);
     return;
 }
@@ -405,7 +419,7 @@ int get_one(void)
         choice = 0,
         character = 0;
 
-    while ((input = getch()) != '\n')
+    while ((input = get_key(-1)) != '\n')
     {
         if (((input == 8) || (input == 127)) && (character == 0))
         {
@@ -419,7 +433,7 @@ int get_one(void)
         } else if (character >= 1) {
             refresh();
         } else if (input == '\33') {
-            flushinp();
+            flush_keys();
             refresh();
         } else {
             printw("%c", input);
@@ -441,7 +455,7 @@ long get_num(const int maxlen)
 
     long amount;
 
-    while ((input = getch()) != '\n')
+    while ((input = get_key(-1)) != '\n')
     {
         if (((input == 8) || (input == 127)) && (character == 0))
         {
@@ -456,7 +470,7 @@ long get_num(const int maxlen)
         } else if (character >= maxlen) {
             refresh();
         } else if (input == '\33') {
-            flushinp();
+            flush_keys();
             refresh();
         } else if (((input == 'A') || (input == 'a')) &&
                 (character == 0) && (maxlen > 1)) {
@@ -504,7 +518,7 @@ void name_firm(void)
     move(12, 12);
     refresh();
 
-    while (((input = getch()) != '\n') && (character < 22))
+    while (((input = get_key(-1)) != '\n') && (character < 22))
     {
         if (((input == 8) || (input == 127)) && (character == 0))
         {
@@ -513,21 +527,21 @@ void name_firm(void)
             printw("%c", 8);
             printw(" ");
             printw("%c", 8);
-            firm[character] = '\0';
+            g->firm[character] = '\0';
             character--;
             refresh();
         } else if (input == '\33') {
-            flushinp();
+            flush_keys();
             refresh();
         } else {
             printw("%c", input);
-            firm[character] = input;
+            g->firm[character] = input;
             character++;
             refresh();
         }
     }
 
-    firm[character] = '\0';
+    g->firm[character] = '\0';
 
     return;
 }
@@ -553,127 +567,158 @@ void cash_or_guns(void)
         choice = get_one();
     }
 
-    if (choice == '1')
+    game_start(g, (choice == '1'));
+
+    return;
+}
+
+/* The port screen's frame, from row 1 down.  It stays put while the
+ * player is in port; only the fields in it change. */
+static char *frame[] = {
+    " ______________________________________",
+    "|Hong Kong Warehouse                   |     Date",
+    "|   Opium           In Use:            |",
+    "|   Silk                               |",
+    "|   Arms            Vacant:            |   Location",
+    "|   General                            |",
+    "|______________________________________|",
+    "|Hold               Guns               |     Debt",
+    "|   Opium                              |",
+    "|   Silk                               |",
+    "|   Arms                               |  Ship Status",
+    "|   General                            |",
+    "|______________________________________|",
+    "Cash:               Bank:",
+    "________________________________________"
+};
+
+#define FRAME_ROWS ((int) (sizeof(frame) / sizeof(frame[0])))
+
+/* Whether the frame is still on screen, as far as its rules show: any
+ * other screen starts with a clear(), which takes them away. */
+static int frame_shown(void)
+{
+    static int rules[] = { 1, 7, 13, 15 };
+    char       line[41];
+    int        i;
+
+    for (i = 0; i < 4; i++)
     {
-        cash = 400;
-        debt = 5000;
-        hold = 60;
-        guns = 0;
-        li = 0;
-        bp = 10;
-    } else {
-        cash = 0;
-        debt = 0;
-        hold = 10;
-        guns = 5;
-        li = 1;
-        bp = 7;
+        char *rule = frame[rules[i] - 1];
+
+        mvinnstr(rules[i], 0, line, strlen(rule));
+        if (strcmp(line, rule) != 0)
+        {
+            return 0;
+        }
     }
 
-    return;
+    return 1;
 }
 
-void set_prices(void)
+/* Blanks a field of the frame and puts the cursor at its start; a width
+ * of 0 runs to the end of the line. */
+static void field(int y, int x, int width)
 {
-    price[0] = base_price[0][port] / 2 * (rand()%3 + 1) * base_price[0][0];
-    price[1] = base_price[1][port] / 2 * (rand()%3 + 1) * base_price[1][0];
-    price[2] = base_price[2][port] / 2 * (rand()%3 + 1) * base_price[2][0];
-    price[3] = base_price[3][port] / 2 * (rand()%3 + 1) * base_price[3][0];
-    return;
+    attrset(A_NORMAL);
+    move(y, x);
+    if (width == 0)
+    {
+        clrtoeol();
+    } else {
+        printw("%*s", width, "");
+        move(y, x);
+    }
 }
 
+/* Brings the port screen up to date.  The frame is drawn only when it is
+ * not already there, and is erase()d rather than clear()ed, so that curses
+ * sends the terminal only the characters that have changed: over a slow
+ * link, a few numbers rather than the whole screen after every trade. */
 void port_stats(void)
 {
     int  in_use,
-         status = 100 - (((float) damage / capacity) * 100),
+         status = game_status(g),
          spacer,
          i;
 
-    clear();
-    spacer = 12 - (strlen(firm) / 2);
-    for (i = 1; i <= spacer; i++)
+    if (!frame_shown())
     {
-        printw(" ");
+        erase();
+        spacer = 12 - (strlen(g->firm) / 2);
+        for (i = 1; i <= spacer; i++)
+        {
+            printw(" ");
+        }
+        printw("Firm: %s, Hong Kong\n", g->firm);
+        for (i = 0; i < FRAME_ROWS; i++)
+        {
+            printw("%s\n", frame[i]);
+        }
     }
-    printw("Firm: %s, Hong Kong\n", firm);
-    printw(" ______________________________________\n");
-    printw("|Hong Kong Warehouse                   |     Date\n");
-    printw("|   Opium           In Use:            |\n");
-    printw("|   Silk                               |\n");
-    printw("|   Arms            Vacant:            |   Location\n");
-    printw("|   General                            |\n");
-    printw("|______________________________________|\n");
-    printw("|Hold               Guns               |     Debt\n");
-    printw("|   Opium                              |\n");
-    printw("|   Silk                               |\n");
-    printw("|   Arms                               |  Ship Status\n");
-    printw("|   General                            |\n");
-    printw("|______________________________________|\n");
-    printw("Cash:               Bank:\n");
-    printw("________________________________________\n");
-
-    move(3, 12);
-    printw("%d", hkw_[0]);
-    move(4, 12);
-    printw("%d", hkw_[1]);
-    move(5, 12);
-    printw("%d", hkw_[2]);
-    move(6, 12);
-    printw("%d", hkw_[3]);
-    move(8, 6);
-    if (hold >= 0)
-    {
-        printw("%d", hold);
+
+    field(3, 12, 8);
+    printw("%d", g->hkw_[0]);
+    field(4, 12, 8);
+    printw("%d", g->hkw_[1]);
+    field(5, 12, 8);
+    printw("%d", g->hkw_[2]);
+    field(6, 12, 8);
+    printw("%d", g->hkw_[3]);
+    field(8, 6, 12);
+    if (g->hold >= 0)
+    {
+        printw("%d", g->hold);
     } else {
         attrset(A_REVERSE);
         printw("Overload");
         attrset(A_NORMAL);
     }
-    move(9, 12);
-    printw("%d", hold_[0]);
-    move(10, 12);
-    printw("%d", hold_[1]);
-    move(11, 12);
-    printw("%d", hold_[2]);
-    move(12, 12);
-    printw("%d", hold_[3]);
-
-    move(14, 5);
-    fancy_numbers(cash, fancy_num);
+    field(9, 12, 26);
+    printw("%d", g->hold_[0]);
+    field(10, 12, 26);
+    printw("%d", g->hold_[1]);
+    field(11, 12, 26);
+    printw("%d", g->hold_[2]);
+    field(12, 12, 26);
+    printw("%d", g->hold_[3]);
+
+    field(14, 5, 15);
+    fancy_numbers(g->cash, fancy_num);
     printw("%s", fancy_num);
 
-    in_use = hkw_[0] + hkw_[1] + hkw_[2] + hkw_[3];
-    move(4, 21);
+    in_use = game_in_use(g);
+    field(4, 21, 17);
     printw("%d", in_use);
-    move(6, 21);
+    field(6, 21, 17);
     printw("%d", (10000 - in_use));
 
-    move(8, 25);
-    printw("%d", guns);
+    field(8, 25, 13);
+    printw("%d", g->guns);
 
-    move(14, 25);
-    fancy_numbers(bank, fancy_num);
+    field(14, 25, 0);
+    fancy_numbers(g->bank, fancy_num);
     printw("%s", fancy_num);
 
-    move(3, 42);
+    field(3, 42, 0);
     printw("15 ");
     attrset(A_REVERSE);
-    printw("%s", months[month - 1]);
+    printw("%s", months[g->month - 1]);
     attrset(A_NORMAL);
-    printw(" %d", year);
+    printw(" %d", g->year);
 
-    move(6, 43);
-    spacer = (9 - strlen(location[port])) / 2;
+    field(6, 43, 0);
+    spacer = (9 - strlen(location[g->port])) / 2;
     for (i = 1; i <= spacer; i++)
     {
         printw(" ");
     }
     attrset(A_REVERSE);
-    printw("%s", location[port]);
+    printw("%s", location[g->port]);
     attrset(A_NORMAL);
 
-    move(9, 41);
-    fancy_numbers(debt, fancy_num);
+    field(9, 41, 0);
+    fancy_numbers(g->debt, fancy_num);
     spacer = (12 - strlen(fancy_num)) / 2;
     for (i = 1; i <= spacer; i++)
     {
@@ -683,7 +728,9 @@ void port_stats(void)
     printw("%s", fancy_num);
     attrset(A_NORMAL);
 
-    i = status / 20;
+    /* A ship can limp out of a battle worse than wrecked. */
+    i = (status > 0) ? status / 20 : 0;
+    field(12, 42, 0);
     if (i < 2)
     {
         attrset(A_REVERSE);
@@ -695,6 +742,137 @@ void port_stats(void)
     attrset(A_NORMAL);
 }
 
+#ifndef TAIPAN_ANSI
+/* 'A' at the port menu: the comprador's advice, from a look at the voyages
+ * ahead (search.h) of no more than ADVICE_USEC.  Not in the server's games,
+ * whose one thread plays them all. */
+#define ADVICE_USEC 300000
+#define ADVISE      "Advise, "  /* Offered at the port menu. */
+
+static void advise(void)
+{
+    static struct search     *s;
+    static struct odds_table odds;
+    static int               have_odds = -1;
+    struct plan              plan;
+
+    /* A replay goes on at once, as it does past consult(); only the key
+     * that put the advice away is read. */
+    if (replay)
+    {
+        get_key(5000);
+        return;
+    }
+
+    if (have_odds == -1)
+    {
+        have_odds = (odds_open(&odds, ODDS_FILE) == 0);
+    }
+    if (s == NULL)
+    {
+        s = search_new(20, 0, have_odds ? &odds : NULL);
+    }
+
+    move(22, 0);
+    clrtobot();
+    printw("Comprador's Report\n\n");
+    printw("Let me think, Taipan . . .");
+    refresh();
+
+    move(22, 0);
+    clrtobot();
+    if ((s == NULL) || (search_port(s, g, ADVICE_USEC, SEARCH_DEPTH,
+                                    &plan) != 0))
+    {
+        printw("Taipan, I cannot say.");
+    } else if (plan.dest == 0) {
+        printw("Taipan, I would retire now, a millionaire.");
+    } else {
+        if (plan.buy >= 0)
+        {
+            printw("Taipan, I would fill the hold with %s\n",
+                   item[plan.buy]);
+        } else {
+            printw("Taipan, I would buy nothing\n");
+        }
+        printw("and sail for %s, ", location[plan.dest]);
+        if (plan.depth == 1)
+        {
+            printw("looking one voyage ahead.");
+        } else {
+            printw("looking %d voyages ahead.", plan.depth);
+        }
+    }
+    refresh();
+
+    get_key(5000);
+}
+#else
+#define ADVISE ""
+#endif
+
+#ifndef TAIPAN_ANSI
+/* The comprador's running advice (advice.h), while the player thinks at
+ * a prompt: worked out on a thread of its own and shown on row every
+ * ADVICE_MS, until a key comes.  The key is left for the prompt to read,
+ * and journaled there as ever, and the work is stopped at once.  There is
+ * no thinking in a replay, and none in the server, whose one thread
+ * plays every game. */
+#define ADVICE_MS 100
+
+static struct advice *advisor;
+
+static void consult(int what, int row)
+{
+    struct advice_plan best;
+    int                y,
+                       x,
+                       input;
+
+    if (replay || ((advisor == NULL) && ((advisor = advice_new()) == NULL)) ||
+            (advice_start(advisor, g, what) != 0))
+    {
+        return;
+    }
+
+    getyx(stdscr, y, x);
+    while ((input = io->key(ADVICE_MS)) == ERR)
+    {
+        if (advice_best(advisor, &best))
+        {
+            move(row, 0);
+            clrtoeol();
+            if (what == ADVICE_PORT)
+            {
+                printw("Advice: %s to %s",
+                       (best.buy >= 0) ? item[best.buy] : "Nothing",
+                       location[best.dest]);
+            } else {
+                printw("Advice: %s", location[best.dest]);
+            }
+            printw(" %+.0f (pirates %.0f%%, storm %.0f%%, sunk %.0f%%)",
+                   best.profit, 100 * best.pirates, 100 * best.storm,
+                   100 * best.lost);
+            move(y, x);
+            refresh();
+        }
+    }
+    advice_stop(advisor);
+    ungetch(input);
+
+    move(row, 0);
+    clrtoeol();
+    move(y, x);
+}
+#else
+#define ADVICE_PORT 0
+#define ADVICE_SAIL 1
+
+static void consult(int what, int row)
+{
+}
+#endif
+
 int port_choices(void)
 {
     int choice = 0;
@@ -706,28 +884,29 @@ int port_choices(void)
     printw("   Opium:          Silk:\n");
     printw("   Arms:           General:\n");
     move(19, 11);
-    printw("%ld", price[0]);
+    printw("%ld", g->price[0]);
     move(19, 29);
-    printw("%ld", price[1]);
+    printw("%ld", g->price[1]);
     move(20, 11);
-    printw("%ld", price[2]);
+    printw("%ld", g->price[2]);
     move(20, 29);
-    printw("%ld", price[3]);
+    printw("%ld", g->price[3]);
 
     for (;;)
     {
         move (22, 0);
         clrtobot();
 
-        if (port == 1)
+        if (g->port == 1)
         {
             /* EJB: TODO: Refactor: The only difference is Retire */
-            if ((cash + bank) >= 1000000)
+            if ((g->cash + g->bank) >= 1000000)
             {
                 printw("Shall I Buy, Sell, Visit bank, Transfer\n");
-                printw("cargo, Wheedle Wu, Quit trading, or Retire? ");
+                printw("cargo, Wheedle Wu, " ADVISE "Quit trading, or Retire? ");
                 refresh();
 
+                consult(ADVICE_PORT, 21);
                 choice = get_one();
                 if ((choice == 'B') || (choice == 'b') ||
                         (choice == 'S') || (choice == 's') ||
@@ -741,9 +920,10 @@ int port_choices(void)
                 }
             } else {
                 printw("Shall I Buy, Sell, Visit bank, Transfer\n");
-                printw("cargo, Wheedle Wu, or Quit trading? ");
+                printw("cargo, Wheedle Wu, " ADVISE "or Quit trading? ");
                 refresh();
 
+                consult(ADVICE_PORT, 21);
                 choice = get_one();
                 if ((choice == 'B') || (choice == 'b') ||
                         (choice == 'S') || (choice == 's') ||
@@ -753,23 +933,86 @@ int port_choices(void)
                         (choice == 'Q') || (choice == 'q'))
                 {
                     break;
-                }
+                }
+            }
+        } else {
+            printw("Shall I Buy, Sell, " ADVISE "or Quit trading? ");
+            refresh();
+
+            consult(ADVICE_PORT, 21);
+            choice = get_one();
+            if ((choice == 'B') || (choice == 'b') ||
+                    (choice == 'S') || (choice == 's') ||
+                    (choice == 'Q') || (choice == 'q'))
+            {
+                break;
+            }
+        }
+
+#ifndef TAIPAN_ANSI
+        if ((choice == 'A') || (choice == 'a'))
+        {
+            advise();
+        }
+#endif
+    }
+
+    return choice;
+}
+
+void port_menu(void)
+{
+    int choice = 0;
+
+    for (;;)
+    {
+        while ((choice != 'Q') && (choice != 'q'))
+        {
+            switch (choice = port_choices())
+            {
+                case 'B':
+                case 'b':
+                    buy();
+                    break;
+
+                case 'S':
+                case 's':
+                    sell();
+                    break;
+
+                case 'V':
+                case 'v':
+                    visit_bank();
+                    break;
+
+                case 'T':
+                case 't':
+                    transfer();
+                    break;
+                case 'W':
+                case 'w':
+                    game_wheedle_wu(g);
+                    return;
+                case 'R':
+                case 'r':
+                    game_retire(g);
+                    return;
             }
-        } else {
-            printw("Shall I Buy, Sell, or Quit trading? ");
-            refresh();
 
-            choice = get_one();
-            if ((choice == 'B') || (choice == 'b') ||
-                    (choice == 'S') || (choice == 's') ||
-                    (choice == 'Q') || (choice == 'q'))
-            {
-                break;
-            }
+            port_stats();
+        }
+
+        choice = 0;
+        if (g->hold >= 0)
+        {
+            quit();
+            break;
+        } else {
+            overload();
         }
     }
 
-    return choice;
+    return;
 }
 
 void buy(void)
@@ -811,7 +1054,7 @@ void buy(void)
         move(21, 42);
         clrtobot();
 
-        afford = cash / price[choice];
+        afford = game_afford(g, choice);
         attrset(A_REVERSE);
         printw(" You can ");
         attrset(A_NORMAL);
@@ -843,20 +1086,12 @@ void buy(void)
         refresh();
 
         amount = get_num(9);
-        if (amount == -1)
-        {
-            amount = afford;
-        }
-        if (amount <= afford)
+        if (game_buy(g, choice, amount) == 0)
         {
             break;
         }
     }
 
-    cash -= (amount * price[choice]);
-    hold_[choice] += amount;
-    hold -= amount;
-
     return;
 }
 
@@ -902,20 +1137,12 @@ void sell(void)
 
         amount = get_num(9);
 
-        if (amount == -1)
-        {
-            amount = hold_[choice];
-        }
-        if (hold_[choice] >= amount)
+        if (game_sell(g, choice, amount) == 0)
         {
-            hold_[choice] -= amount;
             break;
         }
     }
 
-    cash += (amount * price[choice]);
-    hold += amount;
-
     return;
 }
 
@@ -932,26 +1159,18 @@ void visit_bank(void)
         refresh();
 
         amount = get_num(9);
-        if (amount == -1)
-        {
-            amount = cash;
-        }
-        if (amount <= cash)
+        if (game_deposit(g, amount) == 0)
         {
-            cash -= amount;
-            bank += amount;
             break;
         } else {
             move(18, 0);
             clrtobot();
-            fancy_numbers(cash, fancy_num);
+            fancy_numbers(g->cash, fancy_num);
             printw("Taipan, you only have %s\n", fancy_num);
             printw("in cash.\n");
 
             refresh();
-            timeout(5000);
-            getch();
-            timeout(-1);
+            get_key(5000);
         }
     }
     port_stats();
@@ -965,24 +1184,16 @@ void visit_bank(void)
         refresh();
 
         amount = get_num(9);
-        if (amount == -1)
-        {
-            amount = bank;
-        }
-        if (amount <= bank)
+        if (game_withdraw(g, amount) == 0)
         {
-            cash += amount;
-            bank -= amount;
             break;
         } else {
-            fancy_numbers(bank, fancy_num);
+            fancy_numbers(g->bank, fancy_num);
             printw("Taipan, you only have %s\n", fancy_num);
             printw("in the bank.");
 
             refresh();
-            timeout(5000);
-            getch();
-            timeout(-1);
+            get_key(5000);
         }
     }
     port_stats();
@@ -992,29 +1203,27 @@ void visit_bank(void)
 
 void transfer(void)
 {
-    int i, in_use;
+    int i, result;
 
     long amount = 0;
 
-    if ((hkw_[0] == 0) && (hold_[0] == 0) &&
-            (hkw_[1] == 0) && (hold_[1] == 0) &&
-            (hkw_[2] == 0) && (hold_[2] == 0) &&
-            (hkw_[3] == 0) && (hold_[3] == 0))
+    if ((g->hkw_[0] == 0) && (g->hold_[0] == 0) &&
+            (g->hkw_[1] == 0) && (g->hold_[1] == 0) &&
+            (g->hkw_[2] == 0) && (g->hold_[2] == 0) &&
+            (g->hkw_[3] == 0) && (g->hold_[3] == 0))
     {
         move(22, 0);
         clrtobot();
         printw("You have no cargo, Taipan.\n");
 
         refresh();
-        timeout(5000);
-        getch();
-        timeout(-1);
+        get_key(5000);
         return;
     }
 
     for (i = 0; i < 4; i++)
     {
-        if (hold_[i] > 0)
+        if (g->hold_[i] > 0)
         {
             for (;;)
             {
@@ -1026,47 +1235,33 @@ void transfer(void)
                 refresh();
 
                 amount = get_num(9);
-                if (amount == -1)
-                {
-                    amount = hold_[i];
-                }
-                if (amount <= hold_[i])
+                result = game_to_warehouse(g, i, amount);
+                if (result == 0)
                 {
-                    in_use = hkw_[0] + hkw_[1] + hkw_[2] + hkw_[3];
-                    if ((in_use + amount) <= 10000)
-                    {
-                        hold_[i] -= amount;
-                        hkw_[i] += amount;
-                        hold += amount;
-                        break;
-                    } else if (in_use == 10000) {
-                        move (21, 0);
-                        printw("Your warehouse is full, Taipan!");
-                    } else {
-                        move (21, 0);
-                        printw("Your warehouse will only hold an\n");
-                        printw("additional %d, Taipan!", (10000 - in_use));
+                    break;
+                } else if (result == ERR_FULL) {
+                    move (21, 0);
+                    printw("Your warehouse is full, Taipan!");
+                } else if (result == ERR_ROOM) {
+                    move (21, 0);
+                    printw("Your warehouse will only hold an\n");
+                    printw("additional %d, Taipan!", (10000 - game_in_use(g)));
 
-                        refresh();
-                        timeout(5000);
-                        getch();
-                        timeout(-1);
-                    }
+                    refresh();
+                    get_key(5000);
                 } else {
                     move(18, 0);
                     clrtobot();
-                    printw("You have only %d, Taipan.\n", hold_[i]);
+                    printw("You have only %d, Taipan.\n", g->hold_[i]);
 
                     refresh();
-                    timeout(5000);
-                    getch();
-                    timeout(-1);
+                    get_key(5000);
                 }
             }
             port_stats();
         }
 
-        if (hkw_[i] > 0)
+        if (g->hkw_[i] > 0)
         {
             for (;;)
             {
@@ -1078,25 +1273,16 @@ void transfer(void)
                 refresh();
 
                 amount = get_num(9);
-                if (amount == -1)
-                {
-                    amount = hkw_[i];
-                }
-                if (amount <= hkw_[i])
+                if (game_to_ship(g, i, amount) == 0)
                 {
-                    hold_[i] += amount;
-                    hkw_[i] -= amount;
-                    hold -= amount;
                     break;
                 } else {
                     move(18, 0);
                     clrtobot();
-                    printw("You have only %d, Taipan.\n", hkw_[i]);
+                    printw("You have only %d, Taipan.\n", g->hkw_[i]);
 
                     refresh();
-                    timeout(5000);
-                    getch();
-                    timeout(-1);
+                    get_key(5000);
                 }
             }
             port_stats();
@@ -1109,7 +1295,7 @@ void transfer(void)
 void quit(void)
 {
     int choice = 0,
-        result = BATTLE_NOT_FINISHED;
+        result;
 
     move(16, 0);
     clrtobot();
@@ -1125,17 +1311,16 @@ void quit(void)
         move(21, 13);
         clrtobot();
 
+        consult(ADVICE_SAIL, 23);
         choice = get_num(1);
 
-        if (choice == port)
+        result = game_quit(g, choice);
+        if (result == ERR_HERE)
         {
             printw("\n\nYou're already here, Taipan.");
             refresh();
-            timeout(5000);
-            getch();
-            timeout(-1);
-        } else if ((choice >= 1) && (choice <= 7)) {
-            port = choice;
+            get_key(5000);
+        } else if (result == 0) {
             break;
         }
     }
@@ -1151,223 +1336,153 @@ void quit(void)
     clrtobot();
     printw("  Captain's Report\n\n");
 
-    if (rand()%bp == 0)
-    {
-        int num_ships = rand()%((capacity / 10) + guns) + 1;
-
-        if (num_ships > 9999)
-        {
-            num_ships = 9999;
-        }
-        printw("%d hostile ships approaching, Taipan!\n", num_ships);
-        refresh();
-
-        timeout(3000);
-        getch();
-        timeout(-1);
-
-        result = sea_battle(GENERIC, num_ships);
-    }
-
-    if (result == BATTLE_INTERRUPTED)
-    {
-        port_stats();
-        move(6, 43);
-        printw(" ");
-        attrset(A_REVERSE);
-        printw("%s", location[0]);
-        attrset(A_NORMAL);
-        printw("  ");
-
-        move(16, 0);
-        clrtobot();
-        printw("  Captain's Report\n\n");
-        printw("Li Yuen's fleet drove them off!");
-        refresh();
-
-        timeout(3000);
-        getch();
-        timeout(-1);
-    }
+    return;
+}
 
-    if (((result == BATTLE_NOT_FINISHED) && (rand()%(4 + (8 * li))) == 0) || (result == BATTLE_INTERRUPTED))
+/* What happens at sea, until we arrive. */
+void captains_report(struct game_event *ev)
+{
+    switch (ev->type)
     {
-        move(18, 0);
-        clrtobot();
-        printw("Li Yuen's pirates, Taipan!!\n\n");
-        refresh();
-
-        timeout(3000);
-        getch();
-        timeout(-1);
-
-        if (li > 0)
-        {
-            printw("Good joss!! They let us be!!\n");
+        case EV_PIRATES:
+            printw("%d hostile ships approaching, Taipan!\n", ev->n);
             refresh();
 
-            timeout(3000);
-            getch();
-            timeout(-1);
+            get_key(3000);
 
-            return;
-        } else {
-            int num_ships = rand()%((capacity / 5) + guns) + 5;
+            battle(ev);
+            break;
 
-            printw("%d ships of Li Yuen's pirate\n", num_ships);
-            printw("fleet, Taipan!!\n");
+        case EV_LI_YUEN_PIRATES:
+            move(18, 0);
+            clrtobot();
+            printw("Li Yuen's pirates, Taipan!!\n\n");
             refresh();
 
-            timeout(3000);
-            getch();
-            timeout(-1);
-
-            // EJB: Um, we definitely want to update the result here.
-            // sea_battle(LI_YUEN, num_ships);
-            result = sea_battle(LI_YUEN, num_ships);
-        }
-    }
+            get_key(3000);
 
-    if (result > BATTLE_NOT_FINISHED)
-    {
-        port_stats();
-        move(6, 43);
-        printw(" ");
-        attrset(A_REVERSE);
-        printw("%s", location[0]);
-        attrset(A_NORMAL);
-        printw("  ");
+            if (ev->n == 0)
+            {
+                printw("Good joss!! They let us be!!\n");
+                refresh();
 
-        move(16, 0);
-        clrtobot();
-        printw("  Captain's Report\n\n");
-        if (result == BATTLE_WON)  // Victory!
-        {
-            fancy_numbers(booty, fancy_num);
-            printw("We captured some booty.\n");
-            printw("It's worth %s!", fancy_num);
-            cash += booty;
-        } else if (result == BATTLE_FLED) {  // Ran and got away.
-            printw("We made it!");
-        } else {  // result == BATTLE_LOST - ie. Ship lost!
-            // EJB: Is is possible to get result == BATTLE_INTERRUPTED here? Probably not *any more*, since I am now updating result with the return value from the sea_battle(_) with Li Yuen's pirates.
-            assert(result != BATTLE_INTERRUPTED); // EJB: a return value of 2 from sea_battle(_) means: interrupted by Li Yuen's pirates, which makes no sense when fighting Li Yuen's pirates.
-            printw("The buggers got us, Taipan!!!\n");
-            printw("It's all over, now!!!");
-            refresh();
+                get_key(3000);
+            } else {
+                printw("%d ships of Li Yuen's pirate\n", ev->n);
+                printw("fleet, Taipan!!\n");
+                refresh();
 
-            timeout(5000);
-            getch();
-            timeout(-1);
+                get_key(3000);
 
-            final_stats();
-            return;
-        }
+                battle(ev);
+            }
+            break;
 
-        refresh();
-        timeout(3000);
-        getch();
-        timeout(-1);
-    }
+        case EV_BATTLE_OVER:
+            if (ev->n != BATTLE_INTERRUPTED)
+            {
+                sea_battle(ev);
+                break;
+            }
 
-    if (rand()%10 == 0)
-    {
-        move(18, 0);
-        clrtobot();
-        printw("Storm, Taipan!!\n\n");
-        refresh();
-        timeout(3000);
-        getch();
-        timeout(-1);
+            port_stats();
+            move(6, 43);
+            printw(" ");
+            attrset(A_REVERSE);
+            printw("%s", location[0]);
+            attrset(A_NORMAL);
+            printw("  ");
 
-        if (rand()%30 == 0)
-        {
-            printw("   I think we're going down!!\n\n");
+            move(16, 0);
+            clrtobot();
+            printw("  Captain's Report\n\n");
+            printw("Li Yuen's fleet drove them off!");
             refresh();
-            timeout(3000);
-            getch();
-            timeout(-1);
 
-            if (((damage / capacity * 3) * ((float) rand() / RAND_MAX)) >= 1)
+            get_key(3000);
+            break;
+
+        case EV_BATTLE_RESULT:
+            port_stats();
+            move(6, 43);
+            printw(" ");
+            attrset(A_REVERSE);
+            printw("%s", location[0]);
+            attrset(A_NORMAL);
+            printw("  ");
+
+            move(16, 0);
+            clrtobot();
+            printw("  Captain's Report\n\n");
+            if (ev->n == BATTLE_WON)  // Victory!
             {
-                printw("We're going down, Taipan!!\n");
+                fancy_numbers(ev->amount, fancy_num);
+                printw("We captured some booty.\n");
+                printw("It's worth %s!", fancy_num);
+            } else if (ev->n == BATTLE_FLED) {  // Ran and got away.
+                printw("We made it!");
+            } else {  // result == BATTLE_LOST - ie. Ship lost!
+                printw("The buggers got us, Taipan!!!\n");
+                printw("It's all over, now!!!");
                 refresh();
-                timeout(5000);
-                getch();
-                timeout(-1);
 
-                final_stats();
+                get_key(5000);
+                break;
             }
-        }
 
-        printw("    We made it!!\n\n");
-        refresh();
-        timeout(3000);
-        getch();
-        timeout(-1);
+            refresh();
+            get_key(3000);
+            break;
 
-        if (rand()%3 == 0)
-        {
-            int orig = port;
+        case EV_STORM:
+            move(18, 0);
+            clrtobot();
+            printw("Storm, Taipan!!\n\n");
+            refresh();
+            get_key(3000);
+            break;
 
-            while (port == orig)
-            {
-                port = rand()%7 + 1;
-            }
+        case EV_GOING_DOWN:
+            printw("   I think we're going down!!\n\n");
+            refresh();
+            get_key(3000);
+            break;
+
+        case EV_STORM_SURVIVED:
+            printw("    We made it!!\n\n");
+            refresh();
+            get_key(3000);
+            break;
 
+        case EV_BLOWN_OFF_COURSE:
             move(18, 0);
             clrtobot();
             printw("We've been blown off course\n");
-            printw("to %s", location[port]);
+            printw("to %s", location[ev->n]);
             refresh();
-            timeout(3000);
-            getch();
-            timeout(-1);
-        }
-    }
-
-    month++;
-    if (month == 13)
-    {
-        month = 1;
-        year++;
-        ec += 10;
-        ed += 0.5;
-    }
+            get_key(3000);
+            break;
 
-    debt = debt + (debt * 0.1);
-    bank = bank + (bank * 0.005);
-    set_prices();
+        case EV_ARRIVING:
+            move(18, 0);
+            clrtobot();
+            printw("Arriving at %s...", location[ev->n]);
+            refresh();
+            get_key(3000);
+            break;
 
-    move(18, 0);
-    clrtobot();
-    printw("Arriving at %s...", location[port]);
-    refresh();
-    timeout(3000);
-    getch();
-    timeout(-1);
+        default:
+            sea_battle(ev);
+    }
 
     return;
 }
 
 void li_yuen_extortion(void)
 {
-    int time = ((year - 1860) * 12) + month,
-        choice = 0;
-
-    float i = 1.8,
-          j = 0,
-          amount = 0;
-
-    if (time > 12)
-    {
-        j = rand()%(1000 * time) + (1000 * time);
-        i = 1;
-    }
-
-    amount = ((cash / i) * ((float) rand() / RAND_MAX)) + j;
+    int choice = 0;
 
-    fancy_numbers(amount, fancy_num);
+    fancy_numbers(g->offer, fancy_num);
 
     move(16, 0);
     clrtobot();
@@ -1387,19 +1502,14 @@ void li_yuen_extortion(void)
 
     if ((choice == 'Y') || (choice == 'y'))
     {
-        if (amount <= cash)
+        if (game_li_yuen_pay(g) != 0)
         {
-            cash -= amount;
-            li = 1;
-        } else {
             move (18, 0);
             clrtobot();
             printw("Taipan, you do not have enough cash!!\n\n");
             refresh();
 
-            timeout(3000);
-            getch();
-            timeout(-1);
+            get_key(3000);
 
             printw("Do you want Elder Brother Wu to make up\n");
             printw("the difference for you? ");
@@ -1412,10 +1522,7 @@ void li_yuen_extortion(void)
 
             if ((choice == 'Y') || (choice == 'y'))
             {
-                amount -= cash;
-                debt += amount;
-                cash = 0;
-                li = 1;
+                game_li_yuen_wu(g, 1);
 
                 move (18, 0);
                 clrtobot();
@@ -1425,20 +1532,16 @@ void li_yuen_extortion(void)
                 printw("amount to your debt.\n");
 
                 refresh();
-                timeout(5000);
-                getch();
-                timeout(-1);
+                get_key(5000);
             } else {
-                cash = 0;
+                game_li_yuen_wu(g, 0);
 
                 printw("Very well. Elder Brother Wu will not pay\n");
                 printw("Li Yuen the difference.  I would be very\n");
                 printw("wary of pirates if I were you, Taipan.\n");
 
                 refresh();
-                timeout(5000);
-                getch();
-                timeout(-1);
+                get_key(5000);
             }
         }
     }
@@ -1450,10 +1553,13 @@ void li_yuen_extortion(void)
 
 void elder_brother_wu(void)
 {
-    int  choice = 0;
+    int  choice = 0,
+         result;
 
     long wu = 0;
 
+    uint owed;
+
     move(16, 0);
     clrtobot();
     printw("Comprador's Report\n\n");
@@ -1471,17 +1577,9 @@ void elder_brother_wu(void)
         {
             break;
         } else if ((choice == 'Y') || (choice == 'y')) {
-            if (((int)cash == 0) && ((int)bank == 0) && (guns == 0) &&
-                    (hold_[0] == 0) && (hkw_[0] == 0) &&
-                    (hold_[1] == 0) && (hkw_[1] == 0) &&
-                    (hold_[2] == 0) && (hkw_[2] == 0) &&
-                    (hold_[3] == 0) && (hkw_[3] == 0))
+            if (game_wu_broke(g))
             {
-                int i = rand()%1500 + 500,
-                    j;
-
-                wu_bailout++;
-                j = rand()%2000 * wu_bailout + 1500;
+                game_wu_bailout_offer(g);
 
                 for (;;)
                 {
@@ -1490,8 +1588,8 @@ void elder_brother_wu(void)
                     printw("Comprador's Report\n\n");
                     printw("Elder Brother is aware of your plight,\n");
                     printw("Taipan.  He is willing to loan you an\n");
-                    printw("additional %d if you will pay back\n", i);
-                    printw("%d. Are you willing, Taipan? ", j);
+                    printw("additional %d if you will pay back\n", g->loan);
+                    printw("%d. Are you willing, Taipan? ", g->repay);
                     refresh();
 
                     choice = get_one();
@@ -1503,14 +1601,12 @@ void elder_brother_wu(void)
                         printw("Very well, Taipan, the game is over!\n");
 
                         refresh();
-                        timeout(5000);
-                        getch();
-                        timeout(-1);
+                        get_key(5000);
 
-                        final_stats();
+                        game_wu_bailout(g, 0);
+                        return;
                     } else if ((choice == 'Y') || (choice == 'y')) {
-                        cash += i;
-                        debt += j;
+                        game_wu_bailout(g, 1);
                         port_stats();
 
                         move(16, 0);
@@ -1519,14 +1615,12 @@ void elder_brother_wu(void)
                         printw("Very well, Taipan.  Good joss!!\n");
 
                         refresh();
-                        timeout(5000);
-                        getch();
-                        timeout(-1);
+                        get_key(5000);
 
                         return;
                     }
                 }
-            } else if ((cash > 0) && (debt != 0)) {
+            } else if (game_wu_can_repay(g)) {
                 for (;;)
                 {
                     move(16, 0);
@@ -1536,44 +1630,29 @@ void elder_brother_wu(void)
                     printw("him? ");
                     refresh();
 
+                    owed = g->debt;
                     wu = get_num(9);
-                    if (wu == -1)
-                    {
-                        /* wu = cash; */
-                        /* Give Wu the *lesser* of your cash or your debt. */
-                        wu = (cash <= debt) ? cash : debt;
-                    }
-                    if (wu <= cash)
+                    result = game_wu_repay(g, wu);
+                    if (result >= 0)
                     {
-                        /* EJB: Don't allow overpayment */
-                        if (wu > debt)
+                        if (result == WU_PAID_IN_FULL)
                         {
-                            fancy_numbers(debt, fancy_num);
+                            fancy_numbers(owed, fancy_num);
                             printw("Taipan, you owe only %s.\n", fancy_num);
                             printw("Paid in full.\n");
                             refresh();
-                            timeout(5000);
-                            wu = debt;
-                        }
-                        cash -= wu;
-                        if ((wu > debt) && (debt > 0))
-                        {
-                            debt -= (wu + 1);
-                        } else {
-                            debt -= wu;
+                            get_key(5000);
                         }
                         break;
                     } else {
                         move(18, 0);
                         clrtobot();
-                        fancy_numbers(cash, fancy_num);
+                        fancy_numbers(g->cash, fancy_num);
                         printw("Taipan, you only have %s\n", fancy_num);
                         printw("in cash.\n");
 
                         refresh();
-                        timeout(5000);
-                        getch();
-                        timeout(-1);
+                        get_key(5000);
                     }
                 }
             }
@@ -1589,22 +1668,14 @@ void elder_brother_wu(void)
                 refresh();
 
                 wu = get_num(9);
-                if (wu == -1)
-                {
-                    wu = (cash * 2);
-                }
-                if (wu <= (cash * 2))
+                if (game_wu_borrow(g, wu) == 0)
                 {
-                    cash += wu;
-                    debt += wu;
                     break;
                 } else {
                     printw("\n\nHe won't loan you so much, Taipan!");
 
                     refresh();
-                    timeout(5000);
-                    getch();
-                    timeout(-1);
+                    get_key(5000);
                 }
             }
             port_stats();
@@ -1613,65 +1684,24 @@ void elder_brother_wu(void)
         }
     }
 
-    if ((debt > 20000) && (cash > 0) && (rand()%5 == 0))
-    {
-        int num = rand()%3 + 1;
-
-        cash = 0;
-        port_stats();
-
-        move(16, 0);
-        clrtobot();
-        printw("Comprador's Report\n\n");
-        printw("Bad joss!!\n");
-        printw("%d of your bodyguards have been killed\n", num);
-        printw("by cutthroats and you have been robbed\n");
-        printw("of all of your cash, Taipan!!\n");
-
-        refresh();
-        timeout(5000);
-        getch();
-        timeout(-1);
-    }
-
     return;
 }
 
-void good_prices(void)
+void good_prices(int i, int j)
 {
-    char item[14];
-
-    int i = rand()%4,
-        j = rand()%2;
-
-    if (i == 0)
-    {
-        strcpy(item, "Opium");
-    } else if (i == 1) {
-        strcpy(item, "Silk");
-    } else if (i == 2) {
-        strcpy(item, "Arms");
-    } else {
-        strcpy(item, "General Cargo");
-    }
-
     move(16, 0);
     clrtobot();
     printw("Comprador's Report\n\n");
-    printw("Taipan!!  The price of %s\n", item);
+    printw("Taipan!!  The price of %s\n", item[i]);
     if (j == 0)
     {
-        price[i] = price[i] / 5;
-        printw("has dropped to %ld!!\n", price[i]);
+        printw("has dropped to %ld!!\n", g->price[i]);
     } else {
-        price[i] = price[i] * (rand()%5 + 5);
-        printw("has risen to %ld!!\n", price[i]);
+        printw("has risen to %ld!!\n", g->price[i]);
     }
 
     refresh();
-    timeout(3000);
-    getch();
-    timeout(-1);
+    get_key(3000);
 }
 
 void overload(void)
@@ -1681,34 +1711,21 @@ void overload(void)
     printw("Comprador's Report\n\n");
     printw("Your ship is overloaded, Taipan!!");
     refresh();
-    timeout(5000);
-    getch();
-    timeout(-1);
+    get_key(5000);
     return;
 }
 
 void new_ship(void)
 {
-    int  choice = 0,
-         time;
-
-    float amount;
-
-    time = ((year - 1860) * 12) + month;
-    amount = rand()%(1000 * (time + 5) / 6) * (capacity / 50) + 1000;
-
-    if (cash < amount)
-    {
-        return;
-    }
+    int  choice = 0;
 
-    fancy_numbers(amount, fancy_num);
+    fancy_numbers(g->offer, fancy_num);
 
     move(16, 0);
     clrtobot();
     printw("Comprador's Report\n\n");
     printw("Do you wish to trade in your ");
-    if (damage > 0)
+    if (g->damage > 0)
     {
         attrset(A_REVERSE);
         printw("damaged");
@@ -1728,16 +1745,7 @@ void new_ship(void)
 
     if ((choice == 'Y') || (choice == 'y'))
     {
-        cash -= amount;
-        hold += 50;
-        capacity += 50;
-        damage = 0;
-    }
-
-    if ((rand()%2 == 0) && (guns < 1000))
-    {
-        port_stats();
-        new_gun();
+        game_buy_ship(g);
     }
 
     port_stats();
@@ -1747,20 +1755,9 @@ void new_ship(void)
 
 void new_gun(void)
 {
-    int choice = 0,
-        time;
-
-    float amount;
-
-    time = ((year - 1860) * 12) + month;
-    amount = rand()%(1000 * (time + 5) / 6) + 500;
-
-    if ((cash < amount) || (hold < 10))
-    {
-        return;
-    }
+    int choice = 0;
 
-    fancy_numbers(amount, fancy_num);
+    fancy_numbers(g->offer, fancy_num);
 
     move(16, 0);
     clrtobot();
@@ -1777,9 +1774,7 @@ void new_gun(void)
 
     if ((choice == 'Y') || (choice == 'y'))
     {
-        cash -= amount;
-        hold -= 10;
-        guns += 1;
+        game_buy_gun(g);
     }
 
     port_stats();
@@ -1827,369 +1822,332 @@ void fancy_numbers(float num, char *fancy)
     }
 }
 
-int sea_battle(int id, int num_ships)
+/* A battle begins: fight it blow by blow, or all at once with -q. */
+void battle(struct game_event *ev)
 {
-    int orders = 0,
-        num_on_screen = 0,
-        ships_on_screen[10],
-        time = ((year - 1860) * 12) + month,
-        s0 = num_ships,
-        ok = 0,
-        ik = 1,
-        x, y, i,
-        input,
-        status;
+    if (quick)
+    {
+        quick_battle();
+    } else {
+        sea_battle(ev);
+    }
+}
+
+void quick_battle(void)
+{
+    struct game_event ev;
+    int               choice = 0;
 
-    booty = (time / 4 * 1000 * num_ships) + rand()%1000 + 250;
+    printw("\nShall we Fight, Run, or Throw cargo? ");
+    refresh();
 
-    for (i = 0; i <= 9; i++)
+    while ((choice = battle_orders(get_one(), ORDERS_NONE)) == ORDERS_NONE)
     {
-        ships_on_screen[i] = 0;
+        ;
     }
 
-    clear();
-    flushinp();
-    fight_stats(num_ships, orders);
-
-    while (num_ships > 0)
+    ev.type   = EV_BATTLE_OVER;
+    ev.n      = game_battle_resolve(g, choice);
+    ev.m      = 0;
+    ev.amount = 0;
+    if (ev.n == BATTLE_INTERRUPTED)
     {
-        assert(capacity >= 0);  /* EJB */
-        status = 100 - (((float) damage / capacity) * 100);
-        if (status <= 0)
-        {
-            return BATTLE_LOST;  // Ship lost!
-        }
-        flushinp();
-        move(3, 0);
-        clrtoeol();
-        printw("Current seaworthiness: %s (%d%%)", st[(status / 20)], status);
-        refresh();
+        captains_report(&ev);
+    }
 
-        x = 10;
-        y = 6;
-        for (i = 0; i <= 9; i++)
-        {
-            if (i == 5)
-            {
-                x = 10;
-                y = 12;
-            }
+    return;
+}
+
+/* The battle's sprites: a lorcha, a blank, a blast, and a lorcha going
+ * down.  Each is four rows of eight characters, put into curses' own form
+ * once and then copied a row at a time into whichever slot it goes in. */
+enum
+{
+    SPRITE_LORCHA,
+    SPRITE_BLANK,
+    SPRITE_BLAST,
+    SPRITE_SINKING,  /* Three frames, the ship lower in each. */
+    SPRITES = SPRITE_SINKING + 3
+};
+
+static char *sprite_art[SPRITES][4] = {
+    { "-|-_|_  ", "-|-_|_  ", "_|__|__/", "\\_____/ " },
+    { "        ", "        ", "        ", "        " },
+    { "********", "********", "********", "********" },
+    { "        ", "-|-_|_  ", "-|-_|_  ", "_|__|__/" },
+    { "        ", "        ", "-|-_|_  ", "-|-_|_  " },
+    { "        ", "        ", "        ", "-|-_|_  " }
+};
+
+static chtype sprites[SPRITES][4][8];
+
+/* Draws a sprite in one of the ten slots: five across at x = 10 to 50,
+ * in two rows at y = 6 and 12. */
+void draw_sprite(int sprite, int slot)
+{
+    int x = ((slot % 5) + 1) * 10,
+        y = (slot < 5) ? 6 : 12,
+        s,
+        i,
+        j;
 
-            if (num_ships > num_on_screen)
+    if (sprites[0][0][0] == 0)
+    {
+        for (s = 0; s < SPRITES; s++)
+        {
+            for (i = 0; i < 4; i++)
             {
-                if (ships_on_screen[i] == 0)
+                for (j = 0; j < 8; j++)
                 {
-                    usleep(100000);
-                    ships_on_screen[i] =
-                        (int)((ec * ((float) rand() / RAND_MAX)) + 20);
-                    draw_lorcha(x, y);
-                    num_on_screen++;
-                    refresh();
+                    sprites[s][i][j] = (unsigned char) sprite_art[s][i][j];
                 }
+            }
+        }
+    }
+
+    for (i = 0; i < 4; i++)
+    {
+        mvaddchnstr(y + i, x, sprites[sprite][i], 8);
+    }
+    move(y + 3, x + 8);  /* Where printing it would leave the cursor. */
+}
+
+/* A screen of ch over the 24 by 79 a battle is drawn on, to be shown with
+ * wnoutrefresh() and doupdate() as one frame of the broadside flash.  A
+ * row is one call, and curses sends it as a character and a repeat
+ * count.  NULL if there is no memory for it, and then there is no flash. */
+static WINDOW *flash_frame(int ch)
+{
+    WINDOW *w = newwin(0, 0, 0, 0);
+    int    y;
+
+    for (y = 0; (w != NULL) && (y < 24); y++)
+    {
+        mvwhline(w, y, 0, ch, 79);
+    }
+
+    return w;
+}
+
+void sea_battle(struct game_event *ev)
+{
+    struct battle *b = &g->battle;
+
+    int i,
+        input,
+        orders;
+    WINDOW *stars,
+           *blank;
+
+    switch (ev->type)
+    {
+        case EV_PIRATES:
+        case EV_LI_YUEN_PIRATES:
+            clear();
+            flush_keys();
+            fight_stats(b->num_ships, b->orders);
+            break;
+
+        case EV_BATTLE_ROUND:
+            flush_keys();
+            move(3, 0);
+            clrtoeol();
+            printw("Current seaworthiness: %s (%d%%)", st[(ev->n / 20)], ev->n);
+            refresh();
+            break;
 
-                x += 10;
-            }
-        }
+        case EV_SHIP_SPAWN:
+            animate(100000);
+            draw_sprite(SPRITE_LORCHA, ev->n);
+            refresh();
+            break;
 
-        if (num_ships > num_on_screen)
-        {
-            move(11, 62);
-            printw("+");
-        } else {
+        case EV_BATTLE_ORDERS:
             move(11, 62);
-            printw(" ");
-        }
-
-        move(16, 0);
-        printw("\n");
-        refresh();
-        timeout(3000);
-        input = getch();
-        timeout(-1);
+            if (b->num_ships > b->num_on_screen)
+            {
+                printw("+");
+            } else {
+                printw(" ");
+            }
 
-        if ((input == 'F') || (input == 'f'))
-        {
-            orders = 1;
-        } else if ((input == 'R') || (input == 'r')) {
-            orders = 2;
-        } else if ((input == 'T') || (input == 't')) {
-            orders = 3;
-        }
+            move(16, 0);
+            printw("\n");
+            refresh();
+            input = get_key(3000);
 
-        if (orders == 0)
-        {
-            timeout(3000);
-            input = getch();
-            timeout(-1);
+            orders = battle_orders(input, b->orders);
 
-            if ((input == 'F') || (input == 'f'))
+            if (orders == ORDERS_NONE)
             {
-                orders = 1;
-            } else if ((input == 'R') || (input == 'r')) {
-                orders = 2;
-            } else if ((input == 'T') || (input == 't')) {
-                orders = 3;
-            } else {
-                move(3, 0);
-                clrtoeol();
-                printw("Taipan, what shall we do??    (f=Fight, r=Run, t=Throw cargo)");
-                refresh();
-                timeout(-1);
-                while ((input != 'F') && (input != 'f') &&
-                        (input != 'R') && (input != 'r') &&
-                        (input != 'T') && (input != 't'))
-                {
-                    input = getch();
-                }
-                if ((input == 'F') || (input == 'f'))
+                input = get_key(3000);
+
+                orders = battle_orders(input, orders);
+                if (orders == ORDERS_NONE)
                 {
-                    orders = 1;
-                } else if ((input == 'R') || (input == 'r')) {
-                    orders = 2;
-                } else {
-                    orders = 3;
+                    move(3, 0);
+                    clrtoeol();
+                    printw("Taipan, what shall we do??    (f=Fight, r=Run, t=Throw cargo)");
+                    refresh();
+                    while (orders == ORDERS_NONE)
+                    {
+                        orders = battle_orders(get_key(-1), orders);
+                    }
                 }
             }
-        }
 
-        fight_stats(num_ships, orders);
-        if ((orders == 1) && (guns > 0))
-        {
-            int targeted,
-                sk = 0;
+            game_battle_orders(g, orders);
+            fight_stats(b->num_ships, b->orders);
+            break;
 
-            ok = 3;
-            ik = 1;
+        case EV_VOLLEY:
             move(3, 0);
             clrtoeol();
             printw("Aye, we'll fight 'em, Taipan.");
             refresh();
-            timeout(3000);
-            input = getch();
-            timeout(-1);
+            input = get_key(3000);
 
             move(3, 0);
             clrtoeol();
             printw("We're firing on 'em, Taipan!");
-            timeout(1000);
-            input = getch();
-            timeout(-1);
+            input = get_key(1000);
             refresh();
+            break;
 
-            for (i = 1; i <= guns; i++)
+        case EV_SHOT:
+            move(11, 62);
+            if (b->num_ships > b->num_on_screen)
             {
-                if ((ships_on_screen[0] == 0) && (ships_on_screen[1] == 0) &&
-                        (ships_on_screen[2] == 0) && (ships_on_screen[3] == 0) &&
-                        (ships_on_screen[4] == 0) && (ships_on_screen[5] == 0) &&
-                        (ships_on_screen[6] == 0) && (ships_on_screen[7] == 0) &&
-                        (ships_on_screen[8] == 0) && (ships_on_screen[9] == 0))
-                {
-                    int j;
-
-                    x = 10;
-                    y = 6;
-                    for (j = 0; j <= 9; j++)
-                    {
-                        if (j == 5)
-                        {
-                            x = 10;
-                            y = 12;
-                        }
-
-                        if (num_ships > num_on_screen)
-                        {
-                            if (ships_on_screen[j] == 0)
-                            {
-                                usleep(100000);
-                                ships_on_screen[j] =
-                                    (int)((ec * ((float) rand() / RAND_MAX)) + 20);
-                                draw_lorcha(x, y);
-                                num_on_screen++;
-                            }
-
-                            x += 10;
-                        }
-                    }
-                }
+                printw("+");
+            } else {
+                printw(" ");
+            }
 
-                move(11, 62);
-                if (num_ships > num_on_screen)
-                {
-                    printw("+");
-                } else {
-                    printw(" ");
-                }
+            move(16, 0);
+            printw("\n");
+            refresh();
 
-                move(16, 0);
-                printw("\n");
-                refresh();
+            draw_sprite(SPRITE_BLAST, ev->n);
+            animate(100000);
 
-                targeted = rand()%10;
-                while (ships_on_screen[targeted] == 0)
-                {
-                    targeted = rand()%10;
-                }
+            draw_sprite(SPRITE_LORCHA, ev->n);
+            animate(100000);
 
-                x = (targeted < 5) ? ((targeted + 1) * 10) : ((targeted - 4) * 10);
-                y = (targeted < 5) ? 6 : 12;
+            draw_sprite(SPRITE_BLAST, ev->n);
+            animate(100000);
 
-                draw_blast(x, y);
-                refresh();
-                usleep(100000);
+            draw_sprite(SPRITE_LORCHA, ev->n);
+            animate(100000);
 
-                draw_lorcha(x, y);
-                refresh();
-                usleep(100000);
 
-                draw_blast(x, y);
-                refresh();
-                usleep(100000);
+            /* EJB */
+            animate(50000);
+            move(3, 30);
+            clrtoeol();
+            if (1 == g->guns - b->shot)
+            {
+                printw("(1 shot remaining.)");
+            }
+            else
+            {
+                printw("(%d shots remaining.)", g->guns - b->shot);
+            }
+            animate(100000);
 
-                draw_lorcha(x, y);
-                refresh();
-                usleep(100000);
+            if (ev->m)
+            {
+                animate(100000);
 
+                sink_lorcha(ev->n, (ev->m == 2));
 
-                /* EJB */
-                usleep(50000);
-                move(3, 30);
-                clrtoeol();
-                if (1 == guns - i)
+                if (b->num_ships == b->num_on_screen)
                 {
-                    printw("(1 shot remaining.)");
-                }
-                else
-                {
-                    printw("(%d shots remaining.)", guns - i);
+                    move(11, 62);
+                    printw(" ");
                 }
-                refresh();
-                usleep(100000);
-
-                ships_on_screen[targeted] -= rand()%30 + 10;
-
-                if (ships_on_screen[targeted] <= 0)
-                {
-                    num_on_screen--;
-                    num_ships--;
-                    sk++;
-                    ships_on_screen[targeted] = 0;
 
-                    usleep(100000);
-
-                    sink_lorcha(x, y);
-
-                    if (num_ships == num_on_screen)
-                    {
-                        move(11, 62);
-                        printw(" ");
-                    }
-
-                    fight_stats(num_ships, orders);
-                    refresh();
-                }
+                fight_stats(b->num_ships, b->orders);
+                refresh();
+            }
 
-                if (num_ships == 0)
-                {
-                    i += guns;
-                } else {
-                    usleep(500000);
-                }
+            if (b->num_ships != 0)
+            {
+                animate(500000);
             }
+            break;
+
+        case EV_VOLLEY_END:
             move(3, 0);
             clrtoeol();
-            if (sk > 0)
+            if (ev->n > 0)
             {
-                printw("Sunk %d of the buggers, Taipan!", sk);
+                printw("Sunk %d of the buggers, Taipan!", ev->n);
             } else {
                 printw("Hit 'em, but didn't sink 'em, Taipan!");
             }
             refresh();
-            timeout(3000);
-            input = getch();
-            timeout(-1);
+            input = get_key(3000);
+            break;
 
-            assert(s0 > 0); /* EJB: n%0 is NaN. */
-            if ((rand()%s0 > (num_ships * 0.6 / id)) && (num_ships > 2))
-            {
-                /* EJB: (num_ships / 3 / id) can be zero; n%0 is NaN. */
-                /*int ran = rand()%(num_ships / 3 / id) + 1; */
-                int divisor = num_ships / 3 / id;
-                if (0 == divisor) { divisor = 1; }
-                assert(divisor > 0); /* EJB: n%0 is NaN. */
-                int ran = rand()%divisor;
-                if (0 == ran) { ran = 1; }
-
-                num_ships -= ran;
-                fight_stats(num_ships, orders);
-                move(3, 0);
-                clrtoeol();
-                printw("%d ran away, Taipan!", ran);
+        case EV_RAN_AWAY:
+            fight_stats(b->num_ships, b->orders);
+            move(3, 0);
+            clrtoeol();
+            printw("%d ran away, Taipan!", ev->n);
+            break;
 
-                if (num_ships <= 10)
-                {
-                    for (i = 9; i >= 0; i--)
-                    {
-                        if ((num_on_screen > num_ships) && (ships_on_screen[i] > 0))
-                        {
-                            ships_on_screen[i] = 0;
-                            num_on_screen--;
+        case EV_ESCAPED_SOME:
+            fight_stats(b->num_ships, b->orders);
+            move(3, 0);
+            clrtoeol();
+            printw("But we escaped from %d of 'em!", ev->n);
+            break;
 
-                            x = (i < 5) ? ((i + 1) * 10) : ((i - 4) * 10);
-                            y = (i < 5) ? 6 : 12;
-                            clear_lorcha(x, y);
-                            refresh();
-                            usleep(100000);
-                        }
-                    }
-                    if (num_ships == num_on_screen)
-                    {
-                        move(11, 62);
-                        printw(" ");
-                        refresh();
-                    }
+        case EV_SHIP_CLEAR:
+            draw_sprite(SPRITE_BLANK, ev->n);
+            animate(100000);
+            break;
 
-                }
+        case EV_ORDERS_CHANGE:
+            if (b->num_ships == b->num_on_screen)
+            {
+                move(11, 62);
+                printw(" ");
+                refresh();
+            }
 
-                move(16, 0);
+            move(16, 0);
 
-                refresh();
-                timeout(3000);
-                input = getch();
-                timeout(-1);
+            refresh();
+            input = get_key(3000);
 
-                if ((input == 'F') || (input == 'f'))
-                {
-                    orders = 1;
-                } else if ((input == 'R') || (input == 'r')) {
-                    orders = 2;
-                } else if ((input == 'T') || (input == 't')) {
-                    orders = 3;
-                }
-            }
-        } else if ((orders == 1) && (guns == 0)) {
+            game_battle_orders(g, battle_orders(input, b->orders));
+            break;
+
+        case EV_NO_GUNS:
             move(3, 0);
             clrtoeol();
             printw("We have no guns, Taipan!!");
             refresh();
-            timeout(3000);
-            input = getch();
-            timeout(-1);
-        } else if (orders == 3) {
+            input = get_key(3000);
+            break;
+
+        case EV_THROW_CARGO:
+        {
             int  choice = 0;
 
-            long amount = 0,
-                 total = 0;
+            long amount = 0;
 
             move(18, 0);
             printw("You have the following on board, Taipan:");
             move(19, 4);
-            printw("Opium: %d", hold_[0]);
+            printw("Opium: %d", g->hold_[0]);
             move(19, 24);
-            printw("Silk: %d", hold_[1]);
+            printw("Silk: %d", g->hold_[1]);
             move(20, 5);
-            printw("Arms: %d", hold_[2]);
+            printw("Arms: %d", g->hold_[2]);
             move(20, 21);
-            printw("General: %d", hold_[3]);
+            printw("General: %d", g->hold_[3]);
 
             move(3, 0);
             clrtoeol();
@@ -2226,193 +2184,91 @@ int sea_battle(int id, int num_ships)
                 refresh();
 
                 amount = get_num(9);
-                if ((hold_[choice] > 0) && ((amount == -1) || (amount > hold_[choice])))
-                {
-                    amount = hold_[choice];
-                }
-                total = hold_[choice];
-            } else {
-                total = hold_[0] + hold_[1] + hold_[2] + hold_[3];
             }
 
-            if (total > 0)
+            move(3, 0);
+            clrtoeol();
+            if (game_battle_throw(g, choice, amount))
             {
-                move(3, 0);
-                clrtoeol();
                 printw("Let's hope we lose 'em, Taipan!");
-                if (choice < 4)
-                {
-                    hold_[choice] -= amount;
-                    hold += amount;
-                    ok += (amount / 10);
-                } else {
-                    hold_[0] = 0;
-                    hold_[1] = 0;
-                    hold_[2] = 0;
-                    hold_[3] = 0;
-                    hold += total;
-                    ok += (total / 10);
-                }
-                move(18, 0);
-                clrtobot();
-                refresh();
-
-                timeout(3000);
-                input = getch();
-                timeout(-1);
             } else {
-                move(3, 0);
-                clrtoeol();
                 printw("There's nothing there, Taipan!");
-                move(18, 0);
-                clrtobot();
-                refresh();
-
-                timeout(3000);
-                input = getch();
-                timeout(-1);
             }
+            move(18, 0);
+            clrtobot();
+            refresh();
+
+            input = get_key(3000);
+            break;
         }
 
-        if ((orders == 2) || (orders == 3))
-        {
-            if (orders == 2)
+        case EV_ESCAPE:
+            if (b->orders == ORDERS_RUN)
             {
                 move(3, 0);
                 clrtoeol();
                 printw("Aye, we'll run, Taipan.");
                 refresh();
-                timeout(3000);
-                input = getch();
-                timeout(-1);
+                input = get_key(3000);
             }
 
-            ok += ik++;
-            assert (ok > 0); /* EJB: n%0 is NaN. */
-            assert (ik > 0); /* EJB: n%0 is NaN. */
-            if (rand()%ok > rand()%num_ships)
+            if (ev->n)
             {
-                flushinp();
+                flush_keys();
                 move(3, 0);
                 clrtoeol();
                 printw("We got away from 'em, Taipan!");
                 refresh();
-                timeout(3000);
-                input = getch();
-                timeout(-1);
-                num_ships = 0;
+                input = get_key(3000);
             } else {
                 move(3, 0);
                 clrtoeol();
                 printw("Couldn't lose 'em.");
                 refresh();
-                timeout(3000);
-                input = getch();
-                timeout(-1);
-
-                if ((num_ships > 2) && (rand()%5 == 0))
-                {
-                    /* EJB: % and / have same precedence, so this should be safe. Esp. since num_ships > 2... */
-                    int lost = (rand()%num_ships / 2) + 1;
-
-                    num_ships -= lost;
-                    fight_stats(num_ships, orders);
-                    move(3, 0);
-                    clrtoeol();
-                    printw("But we escaped from %d of 'em!", lost);
-
-                    if (num_ships <= 10)
-                    {
-                        for (i = 9; i >= 0; i--)
-                        {
-                            if ((num_on_screen > num_ships) && (ships_on_screen[i] > 0))
-                            {
-                                ships_on_screen[i] = 0;
-                                num_on_screen--;
-
-                                x = (i < 5) ? ((i + 1) * 10) : ((i - 4) * 10);
-                                y = (i < 5) ? 6 : 12;
-                                clear_lorcha(x, y);
-                                refresh();
-                                usleep(100000);
-                            }
-                        }
-                        if (num_ships == num_on_screen)
-                        {
-                            move(11, 62);
-                            printw(" ");
-                            refresh();
-                        }
-                    }
-
-                    move(16, 0);
-
-                    refresh();
-                    timeout(3000);
-                    input = getch();
-                    timeout(-1);
-
-                    if ((input == 'F') || (input == 'f'))
-                    {
-                        orders = 1;
-                    } else if ((input == 'R') || (input == 'r')) {
-                        orders = 2;
-                    } else if ((input == 'T') || (input == 't')) {
-                        orders = 3;
-                    }
-                }
+                input = get_key(3000);
             }
-        }
+            break;
 
-        if (num_ships > 0)
-        {
+        case EV_ENEMY_FIRE:
             move(3, 0);
             clrtoeol();
             printw("They're firing on us, Taipan!");
 
             refresh();
-            timeout(3000);
-            input = getch();
-            timeout(-1);
-            flushinp();
-            for (i = 0; i < 3; i++)
+            input = get_key(3000);
+            flush_keys();
+            /* The broadside: the two frames are built once and shown
+             * whole, leaving the battle itself in stdscr to come back
+             * to.  A terminal that is behind sees only that. */
+            stars = flash_frame('*');
+            blank = flash_frame(' ');
+            for (i = 0; (i < 3) && (stars != NULL) && (blank != NULL) &&
+                    !io->behind(); i++)
             {
-                for (y = 0; y < 24; y++)
-                {
-                    for (x = 0; x < 79; x++)
-                    {
-                        move(y, x);
-                        printw("*");
-                    }
-                }
-                refresh();
-                usleep(200000);
-                clear();
-                refresh();
-                usleep(200000);
+                touchwin(stars);  /* Or curses sees nothing new to show. */
+                wnoutrefresh(stars);
+                doupdate();
+                nap(200000);
+                touchwin(blank);
+                wnoutrefresh(blank);
+                doupdate();
+                nap(200000);
             }
+            delwin(stars);
+            delwin(blank);
 
-            fight_stats(num_ships, orders);
-            x = 10;
-            y = 6;
-            for (i = 0; i <= 9; i++)
+            erase();
+            fight_stats(b->num_ships, b->orders);
+            for (i = 0; i < ON_SCREEN; i++)
             {
-                if (i == 5)
-                {
-                    x = 10;
-                    y = 12;
-                }
-
-                if (ships_on_screen[i] > 0)
+                if (b->hp[i] > 0)
                 {
-                    draw_lorcha(x, y);
+                    draw_sprite(SPRITE_LORCHA, i);
                 }
-
-                x += 10;
             }
 
             move(11, 62);
-            if (num_ships > num_on_screen)
+            if (b->num_ships > b->num_on_screen)
             {
                 printw("+");
             } else {
@@ -2424,147 +2280,60 @@ int sea_battle(int id, int num_ships)
             printw("We've been hit, Taipan!!");
 
             refresh();
-            timeout(3000);
-            input = getch();
-            timeout(-1);
+            input = get_key(3000);
+            break;
+
+        case EV_GUN_HIT:
+            fight_stats(b->num_ships, b->orders);
+            move(3, 0);
+            clrtoeol();
+            printw("The buggers hit a gun, Taipan!!");
+            fight_stats(b->num_ships, b->orders);
+
+            refresh();
+            input = get_key(3000);
+            break;
 
-            i = (num_ships > 15) ? 15 : num_ships;
-            if ((guns > 0) && ((rand()%100 < (((float) damage / capacity) * 100)) ||
-                        ((((float) damage / capacity) * 100) > 80)))
+        case EV_BATTLE_OVER:
+            if (ev->n == BATTLE_WON)
             {
-                i = 1;
-/* EJB: Don't lose guns when debugging. */
-#ifndef DEBUG
-                guns--;
-                hold += 10;
-#endif
-                fight_stats(num_ships, orders);
+                clear();
+                fight_stats(b->num_ships, b->orders);
                 move(3, 0);
                 clrtoeol();
-                printw("The buggers hit a gun, Taipan!!");
-                fight_stats(num_ships, orders);
-
+                printw("We got 'em all, Taipan!");
                 refresh();
-                timeout(3000);
-                input = getch();
-                timeout(-1);
-            }
-
-/* EJB: Don't lose guns when debugging. */
-#ifndef DEBUG
-            damage = damage + ((ed * i * id) * ((float) rand() / RAND_MAX)) + (i / 2);
-#endif
-            if ((id == GENERIC) && (rand()%20 == 0))
-            {
-                return BATTLE_INTERRUPTED;  // Battle interrupted by Li Yuen's pirates.
+                get_key(3000);
             }
-        }
-    }
-
-    if (orders == 1)
-    {
-        clear();
-        fight_stats(num_ships, orders);
-        move(3, 0);
-        clrtoeol();
-        printw("We got 'em all, Taipan!");
-        refresh();
-        timeout(3000);
-        getch();
-        timeout(-1);
-
-        return BATTLE_WON;  // Victory!
-    } else {
-        return BATTLE_FLED;  // Ran and got away.
+            break;
     }
-}
-
-void draw_lorcha(int x, int y)
-{
-    move (y, x);
-    printw("-|-_|_  ");
-    move ((y + 1), x);
-    printw("-|-_|_  ");
-    move ((y + 2), x);
-    printw("_|__|__/");
-    move ((y + 3), x);
-    printw("\\_____/ ");
-}
-
-void clear_lorcha(int x, int y)
-{
-    move (y, x);
-    printw("        ");
-    move ((y + 1), x);
-    printw("        ");
-    move ((y + 2), x);
-    printw("        ");
-    move ((y + 3), x);
-    printw("        ");
-}
 
-void draw_blast(int x, int y)
-{
-    move (y, x);
-    printw("********");
-    move ((y + 1), x);
-    printw("********");
-    move ((y + 2), x);
-    printw("********");
-    move ((y + 3), x);
-    printw("********");
+    return;
 }
 
-void sink_lorcha(int x, int y)
+/* The orders a key gives, or the orders we had. */
+int battle_orders(int input, int orders)
 {
-    int delay = rand()%20;
-
-    move (y, x);
-    printw("        ");
-    move ((y + 1), x);
-    printw("-|-_|_  ");
-    move ((y + 2), x);
-    printw("-|-_|_  ");
-    move ((y + 3), x);
-    printw("_|__|__/");
-    refresh();
-    usleep(500000);
-    if (delay == 0)
+    if ((input == 'F') || (input == 'f'))
     {
-        usleep(500000);
+        orders = ORDERS_FIGHT;
+    } else if ((input == 'R') || (input == 'r')) {
+        orders = ORDERS_RUN;
+    } else if ((input == 'T') || (input == 't')) {
+        orders = ORDERS_THROW;
     }
 
-    move ((y + 1), x);
-    printw("        ");
-    move ((y + 2), x);
-    printw("-|-_|_  ");
-    move ((y + 3), x);
-    printw("-|-_|_  ");
-    refresh();
-    usleep(500000);
-    if (delay == 0)
-    {
-        usleep(500000);
-    }
+    return orders;
+}
 
-    move ((y + 2), x);
-    printw("        ");
-    move ((y + 3), x);
-    printw("-|-_|_  ");
-    refresh();
-    usleep(500000);
-    if (delay == 0)
-    {
-        usleep(500000);
-    }
+void sink_lorcha(int slot, int slow)
+{
+    int frame;
 
-    move ((y + 3), x);
-    printw("        ");
-    refresh();
-    usleep(500000);
-    if (delay == 0)
+    for (frame = 0; frame < 4; frame++)
     {
-        usleep(500000);
+        draw_sprite((frame < 3) ? SPRITE_SINKING + frame : SPRITE_BLANK, slot);
+        animate(slow ? 1000000 : 500000);
     }
 }
 
@@ -2606,7 +2375,7 @@ void fight_stats(int ships, int orders)
     printw("|  We have");
     move(1, 50);
     clrtoeol();   /* EJB: fix "gunss" going from 10 to 9 guns */
-    printw("|  %d %s", guns, (1 == guns) ? "gun" : "guns");
+    printw("|  %d %s", g->guns, (1 == g->guns) ? "gun" : "guns");
     move(2, 50);
     printw("+---------");
     move(16, 0);
@@ -2635,14 +2404,10 @@ void mchenry(void)
 
     if ((choice == 'Y') || (choice == 'y'))
     {
-        int  percent = ((float) damage / capacity) * 100,
-             time = ((year - 1860) * 12) + month;
+        int  percent = ((float) g->damage / g->capacity) * 100;
 
-        long br = ((((60 * (time + 3) / 4) * (float) rand() / RAND_MAX) +
-                    25 * (time + 3) / 4) * capacity / 50),
-             repair_price = (br * damage) + 1,
-             amount,
-             diff = 0;  /* EJB */
+        long repair_price = game_mchenry_quote(g),
+             amount;
 
         move(18, 0);
         clrtobot();
@@ -2656,22 +2421,14 @@ void mchenry(void)
         {
             move(21, 24);
             amount = get_num(9);
-            if (amount == -1)
-            {
-                /* EJB 2015-04-20 See https://github.com/freebsd/freebsd-ports/blob/master/games/taipan/files/patch-taipan.c */
-                /*amount = cash; */
-                amount = repair_price;
-            }
-            if (amount > cash)  /* EJB: TODO: REFACTOR: This is identical to the li_yuen_extortion() block, except for the name in the strings and the variable that the money goes into; extract to own function. */
+            if (game_mchenry_short(g, amount))  /* EJB: TODO: REFACTOR: This is identical to the li_yuen_extortion() block, except for the name in the strings and the variable that the money goes into; extract to own function. */
             {
                 move (18, 0);
                 clrtobot();
                 printw("Taipan, you do not have enough cash!!\n\n");
                 refresh();
 
-                timeout(3000);
-                getch();
-                timeout(-1);
+                get_key(3000);
 
                 printw("Do you want Elder Brother Wu to make up\n");
                 printw("the difference for you? ");
@@ -2684,9 +2441,7 @@ void mchenry(void)
 
                 if ((choice == 'Y') || (choice == 'y'))
                 {
-                    diff = amount - cash;
-                    debt += diff;
-                    cash = 0;
+                    game_mchenry_wu(g, amount, 1);
 
                     move (18, 0);
                     clrtobot();
@@ -2696,30 +2451,22 @@ void mchenry(void)
                     printw("amount to your debt.\n");
 
                     refresh();
-                    timeout(5000);
-                    getch();
-                    timeout(-1);
+                    get_key(5000);
                 }
                 else
                 {
-                    cash = 0;
+                    game_mchenry_wu(g, amount, 0);
 
                     printw("Very well. Elder Brother Wu will not pay\n");
                     printw("McHenry the difference.  I would be very\n");
                     printw("wary of pirates if I were you, Taipan.\n");
 
                     refresh();
-                    timeout(5000);
-                    getch();
-                    timeout(-1);
+                    get_key(5000);
                 }
             }
-            if (amount <= cash + diff)
+            if (game_mchenry_pay(g, amount) == 0)
             {
-                cash = cash - amount + diff;
-                assert(br > 0);  /* EJB: Don't divide by zero */
-                damage -= (int)((amount / br) + 0.5);
-                damage = (damage < 0) ? 0 : damage;
                 port_stats();
                 refresh();
                 break;
@@ -2749,45 +2496,41 @@ void retire(void)
     printw("                         \n");
     attrset(A_NORMAL);
     refresh();
-    timeout(5000);
-    getch();
-    timeout(-1);
-
-    final_stats();
+    get_key(5000);
 }
 
-void final_stats(void)
+/* Returns 1 if the player will play again, with a new game started. */
+int final_stats(void)
 {
-    int years = year - 1860,
-        time = ((year - 1860) * 12) + month,
+    int years = g->year - 1860,
         choice = 0;
 
+    long long score = game_score(g);
+
     clear();
     printw("Your final status:\n\n");
-    cash = cash + bank - debt;
-    fancy_numbers(cash, fancy_num);
+    fancy_numbers(game_net_worth(g), fancy_num);
     printw("Net cash:  %s\n\n", fancy_num);
-    printw("Ship size: %d units with %d guns\n\n", capacity, guns);
+    printw("Ship size: %d units with %d guns\n\n", g->capacity, g->guns);
     printw("You traded for %d year", years);
     if (years != 1)
     {
         printw("s");
     }
-    printw(" and %d month", month);
-    if (month > 1)
+    printw(" and %d month", g->month);
+    if (g->month > 1)
     {
         printw("s");
     }
     printw("\n\n");
-    cash = cash / 100 / time;
     attrset(A_REVERSE);
-    printw("Your score is %.0f.\n", cash);
+    printw("Your score is %lld.\n", score);
     attrset(A_NORMAL);
     printw("\n");
-    if ((cash < 100) && (cash >= 0))
+    if ((score < 100) && (score >= 0))
     {
         printw("Have you considered a land based job?\n\n\n");
-    } else if (cash < 0) {
+    } else if (score < 0) {
         printw("The crew has requested that you stay on\n");
         printw("shore for their safety!!\n\n");
     } else {
@@ -2796,7 +2539,7 @@ void final_stats(void)
     printw("Your Rating:\n");
     printw(" _______________________________\n");
     printw("|");
-    if (cash > 49999)
+    if (score > 49999)
     {
         attrset(A_REVERSE);
     }
@@ -2804,7 +2547,7 @@ void final_stats(void)
     attrset(A_NORMAL);
     printw("         50,000 and over |\n");
     printw("|");
-    if ((cash < 50000) && (cash > 7999))
+    if ((score < 50000) && (score > 7999))
     {
         attrset(A_REVERSE);
     }
@@ -2812,7 +2555,7 @@ void final_stats(void)
     attrset(A_NORMAL);
     printw("   8,000 to 49,999|\n");
     printw("|");
-    if ((cash < 8000) && (cash > 999))
+    if ((score < 8000) && (score > 999))
     {
         attrset(A_REVERSE);
     }
@@ -2820,7 +2563,7 @@ void final_stats(void)
     attrset(A_NORMAL);
     printw("          1,000 to  7,999|\n");
     printw("|");
-    if ((cash < 1000) && (cash > 499))
+    if ((score < 1000) && (score > 499))
     {
         attrset(A_REVERSE);
     }
@@ -2828,7 +2571,7 @@ void final_stats(void)
     attrset(A_NORMAL);
     printw("        500 to    999|\n");
     printw("|");
-    if (cash < 500)
+    if (score < 500)
     {
         attrset(A_REVERSE);
     }
@@ -2849,36 +2592,16 @@ void final_stats(void)
 
     if ((choice == 'Y') || (choice == 'y'))
     {
-        bank         = 0;
-        hkw_[0]      = 0;
-        hkw_[1]      = 0;
-        hkw_[2]      = 0;
-        hkw_[3]      = 0;
-        hold_[0]     = 0;
-        hold_[1]     = 0;
-        hold_[2]     = 0;
-        hold_[3]     = 0;
-        hold         = 0;
-        capacity     = 60;
-        damage       = 0;
-        month        = 1;
-        year         = 1860;
-        port         = 1;
+        game_restart(g);
 
         splash_intro();
         name_firm();
         cash_or_guns();
-        set_prices();
 
-        return;
+        return 1;
     }
 
-    clear();
-    refresh();
-    nocbreak();
-    endwin();
-
-    exit(0);
+    return 0;
 }
 
 // EJB: Match existing indentation convention.
@@ -0,0 +1,44 @@
+/* ------------------------------------------------------------------------ *
+ * The curses game in taipan.c, for whatever runs it: main.c on the
+ * player's own terminal, or the server for each player connected to it.
+ * ------------------------------------------------------------------------ */
+
+#ifndef TAIPAN_TAIPAN_H
+#define TAIPAN_TAIPAN_H
+
+#include "engine.h"
+#include "journal.h"
+
+/* Where keys come from and how the game waits.  The terminal by default
+ * (term_io); the server puts in its own. */
+struct ui_io
+{
+    int  (*key)(int wait);     /* A key, or ERR after wait ms (-1: never). */
+    void (*nap)(long usec);
+    void (*flush)(void);       /* Forget keys typed ahead. */
+    int  (*behind)(void);      /* More than UI_BEHIND bytes drawn are still
+                                * on their way to the player. */
+};
+
+/* How far the player's terminal may fall behind before the battle's
+ * animations drop frames to catch up: about two seconds at 9600 baud. */
+#define UI_BEHIND 2048
+
+extern struct ui_io      term_io,
+                         *io;
+
+extern struct game_state game,
+                         *g;
+
+extern int               quick;
+
+extern struct journal    journal;
+extern int               replay;
+
+void taipan(void);
+int  get_key(int wait);
+void nap(long usec);
+void flush_keys(void);
+void replay_over(void);
+
+#endif /* TAIPAN_TAIPAN_H */
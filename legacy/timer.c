@@ -0,0 +1,249 @@
+/* ------------------------------------------------------------------------ *
+ * The timing wheel.  See timer.h.
+ *
+ * Level 0 has a slot for each of the next 64 ms; level 1 a slot for each
+ * of the next 64 blocks of 64 ms; and so on.  A timer goes in the lowest
+ * level that reaches it.  Whenever now crosses into a new block at some
+ * level, that block's slot is emptied into the levels below, where its
+ * timers now fit.
+ * ------------------------------------------------------------------------ */
+
+#include <stddef.h>
+#include <string.h>
+
+#include "timer.h"
+
+#define MASK   (WHEEL_SLOTS - 1)
+#define SHIFT(level) ((level) * WHEEL_BITS)
+#define REACH  ((uint64_t) 1 << SHIFT(WHEEL_LEVELS))  /* 2^24 ms */
+#define NEVER  UINT64_MAX
+
+void wheel_init(struct wheel *w, uint64_t now)
+{
+    memset(w, 0, sizeof(*w));
+    w->now = now;
+}
+
+void timer_init(struct timer *t, void (*fire)(void *arg), void *arg)
+{
+    memset(t, 0, sizeof(*t));
+    t->fire = fire;
+    t->arg  = arg;
+}
+
+int timer_pending(const struct timer *t)
+{
+    return t->prev != NULL;
+}
+
+static void unlink_timer(struct wheel *w, struct timer *t)
+{
+    *t->prev = t->next;
+    if (t->next != NULL)
+    {
+        t->next->prev = t->prev;
+    }
+    t->prev = NULL;
+
+    if (w->slots[t->level][t->slot] == NULL)
+    {
+        w->used[t->level] &= ~((uint64_t) 1 << t->slot);
+    }
+}
+
+/* Puts t in the lowest level that reaches it from now. */
+static void place(struct wheel *w, struct timer *t)
+{
+    uint64_t     at = t->expires,
+                 ahead;
+    struct timer **head;
+    int          level;
+
+    if (at < w->now)
+    {
+        at = w->now;  /* Overdue: run it next. */
+    }
+    ahead = at - w->now;
+    if (ahead >= REACH)
+    {
+        at = w->now + REACH - 1;  /* As far as we go; it will come round. */
+        ahead = REACH - 1;
+    }
+
+    for (level = 0; ahead >= ((uint64_t) 1 << SHIFT(level + 1)); level++)
+    {
+        ;
+    }
+
+    t->level = level;
+    t->slot  = (at >> SHIFT(level)) & MASK;
+
+    head = &w->slots[level][t->slot];
+    t->next = *head;
+    if (*head != NULL)
+    {
+        (*head)->prev = &t->next;
+    }
+    *head   = t;
+    t->prev = head;
+
+    w->used[level] |= (uint64_t) 1 << t->slot;
+}
+
+void timer_set(struct wheel *w, struct timer *t, uint64_t expires)
+{
+    timer_cancel(w, t);
+    t->expires = expires;
+    place(w, t);
+    w->pending++;
+}
+
+void timer_cancel(struct wheel *w, struct timer *t)
+{
+    if (t->prev != NULL)
+    {
+        unlink_timer(w, t);
+        w->pending--;
+    }
+}
+
+/* Takes a slot's timers out into a list of their own, which still links
+ * back as a slot does, so they can be unlinked from it one at a time. */
+static void take(struct wheel *w, int level, int slot, struct timer **list)
+{
+    *list = w->slots[level][slot];
+    w->slots[level][slot] = NULL;
+    w->used[level] &= ~((uint64_t) 1 << slot);
+    if (*list != NULL)
+    {
+        (*list)->prev = list;
+    }
+}
+
+/* Moves the slot for the block now has just entered at each level down,
+ * from level 1 up for as long as now is at the start of a block there
+ * too. */
+static void cascade(struct wheel *w)
+{
+    struct timer *list,
+                 *t;
+    int          level,
+                 slot;
+
+    for (level = 1; level < WHEEL_LEVELS; level++)
+    {
+        slot = (w->now >> SHIFT(level)) & MASK;
+        take(w, level, slot, &list);
+        while ((t = list) != NULL)
+        {
+            list = t->next;
+            place(w, t);
+        }
+        if (slot != 0)
+        {
+            break;
+        }
+    }
+}
+
+/* The first ms from w->now on with anything to do: a level 0 slot to run
+ * or a higher one to move down.  The higher levels' slots for the blocks
+ * now is in were moved down as it entered them. */
+static uint64_t next_tick(const struct wheel *w)
+{
+    uint64_t next = NEVER;
+    int      level;
+
+    if (w->pending == 0)
+    {
+        return NEVER;
+    }
+
+    for (level = 0; level < WHEEL_LEVELS; level++)
+    {
+        uint64_t block = w->now >> SHIFT(level),
+                 at,
+                 used;
+        int      here = block & MASK,
+                 ahead;
+
+        if ((used = w->used[level]) == 0)
+        {
+            continue;
+        }
+
+        /* Level 0's slot for now is still to run; anything in a higher
+         * level's slot for the current block is a full turn ahead. */
+        if (level == 0)
+        {
+            used = (used >> here) | (here ? used << (WHEEL_SLOTS - here) : 0);
+            ahead = __builtin_ctzll(used);
+        } else {
+            used = (here == MASK) ? used :
+                (used >> (here + 1)) | (used << (MASK - here));
+            ahead = __builtin_ctzll(used) + 1;
+        }
+
+        at = (level == 0) ? w->now + ahead : (block + ahead) << SHIFT(level);
+        if (at < next)
+        {
+            next = at;
+        }
+    }
+
+    return next;
+}
+
+/* Moves now on to at, first moving down whatever is in the blocks it
+ * enters.  Blocks it passes over on the way must be empty. */
+static void advance(struct wheel *w, uint64_t at)
+{
+    if (at != w->now)
+    {
+        w->now = at;
+        if ((at & MASK) == 0)
+        {
+            cascade(w);
+        }
+    }
+}
+
+void wheel_run(struct wheel *w, uint64_t now)
+{
+    struct timer *list,
+                 *t;
+    uint64_t     next;
+
+    while ((next = next_tick(w)) <= now)
+    {
+        advance(w, next);
+
+        /* Past this ms before running its timers, so that any they set
+         * for it (or before) go in the next slot to run, not this one. */
+        take(w, 0, w->now & MASK, &list);
+        advance(w, w->now + 1);
+        while ((t = list) != NULL)
+        {
+            unlink_timer(w, t);
+            w->pending--;
+            t->fire(t->arg);
+        }
+    }
+
+    if (w->now <= now)
+    {
+        advance(w, now + 1);
+    }
+}
+
+long wheel_timeout(const struct wheel *w, uint64_t now)
+{
+    uint64_t next = next_tick(w);
+
+    if (next == NEVER)
+    {
+        return -1;
+    }
+
+    return (next <= now) ? 0 : (long) (next - now);
+}
@@ -0,0 +1,65 @@
+/* ------------------------------------------------------------------------ *
+ * Timers, for whatever has a great many things to wake at once: the
+ * server, with a pause or a timed prompt pending in every session.
+ *
+ * A hierarchical timing wheel in milliseconds.  Setting and cancelling a
+ * timer cost the same however many are pending; the wheel only looks at
+ * a timer again when it comes due, or as it moves down a level (at most
+ * three times in its life).  Time is whatever the caller says it is, so
+ * long as it never goes backwards.
+ *
+ * The wheel runs timers no earlier than asked and, so long as the caller
+ * keeps up, within the millisecond.  A timer set further ahead than the
+ * wheel reaches (4.6 hours) comes round again until it is due.
+ * ------------------------------------------------------------------------ */
+
+#ifndef TAIPAN_TIMER_H
+#define TAIPAN_TIMER_H
+
+#include <stdint.h>
+
+#define WHEEL_BITS   6
+#define WHEEL_SLOTS  (1 << WHEEL_BITS)
+#define WHEEL_LEVELS 4
+
+struct timer
+{
+    struct timer *next,
+                 **prev;        /* NULL when not pending. */
+    uint64_t     expires;
+    int          level,
+                 slot;
+
+    void         (*fire)(void *arg);
+    void         *arg;
+};
+
+struct wheel
+{
+    uint64_t     now;           /* The first ms not yet run. */
+    long         pending;
+    uint64_t     used[WHEEL_LEVELS];  /* A bit for each slot in use. */
+    struct timer *slots[WHEEL_LEVELS][WHEEL_SLOTS];
+};
+
+void wheel_init(struct wheel *w, uint64_t now);
+
+/* A timer that calls fire(arg) when it runs.  Timers start out cancelled. */
+void timer_init(struct timer *t, void (*fire)(void *arg), void *arg);
+
+/* Sets t to run at expires, instead of whenever it was set for before. */
+void timer_set(struct wheel *w, struct timer *t, uint64_t expires);
+void timer_cancel(struct wheel *w, struct timer *t);
+int  timer_pending(const struct timer *t);
+
+/* Runs every timer due by now, in order of the ms they were due, and
+ * those they set that are due by now too.  A timer may set or cancel any
+ * timer, itself included, while it runs. */
+void wheel_run(struct wheel *w, uint64_t now);
+
+/* How many ms from now until wheel_run() next has something to do: 0 if
+ * timers are due, -1 if none are pending at all.  The wheel may want to
+ * run a little before the next timer is due, to move timers down. */
+long wheel_timeout(const struct wheel *w, uint64_t now);
+
+#endif /* TAIPAN_TIMER_H */
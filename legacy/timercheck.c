@@ -0,0 +1,279 @@
+/* ------------------------------------------------------------------------ *
+ * timer-check: set, cancel and run a great many timers on one wheel, at
+ * random, and check that each runs when timer.h says it will.
+ *
+ * A timer set while the wheel's first ms not yet run is n, for expires,
+ * must run in ms max(expires, n): never earlier, never later, once, and
+ * in order of the ms with the rest.  Timers re-arm themselves and set and
+ * cancel others while they run, and time goes on by a ms at a time, by
+ * whatever wheel_timeout() says, and by jumps past the wheel's reach.
+ * "make check" runs it.
+ * ------------------------------------------------------------------------ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "rng.h"
+#include "timer.h"
+#include "tool.h"
+
+#define TIMERS 4096
+
+struct entry
+{
+    struct timer timer;
+    uint64_t     runs;   /* The ms it should run in. */
+    int          armed;
+};
+
+static struct wheel wheel;
+static struct entry entries[TIMERS];
+static struct rng   dice;
+static uint64_t     last,   /* The ms the last timer ran in. */
+                    now,    /* As wheel_run() was last told. */
+                    set,
+                    fired,
+                    cancelled;
+static long         limit = 300000;
+
+void usage(void)
+{
+    fprintf(stderr, "usage: timer-check [-n timers] [-s seed]\n");
+    exit(1);
+}
+
+static void fail(const struct entry *e, const char *what)
+{
+    fprintf(stderr, "timer-check: timer %ld %s (due in ms %llu, now %llu)\n",
+            (long) (e - entries), what, (unsigned long long) e->runs,
+            (unsigned long long) now);
+    exit(1);
+}
+
+/* Some ms from the wheel's now: mostly soon, now and then overdue, and
+ * once in a while further than the wheel reaches. */
+static uint64_t when(void)
+{
+    uint64_t from = wheel.now;
+
+    switch (rng_below(&dice, 16))
+    {
+        case 0:
+            return (from > 100) ? from - rng_below(&dice, 100) : from;
+
+        case 1:
+            return from + rng_below(&dice, 1 << 26);
+
+        case 2:
+        case 3:
+            return from + rng_below(&dice, 1 << 18);
+
+        case 4:
+        case 5:
+        case 6:
+            return from + rng_below(&dice, 4096);
+
+        default:
+            return from + rng_below(&dice, 100);
+    }
+}
+
+static void arm(struct entry *e)
+{
+    uint64_t expires = when();
+
+    timer_set(&wheel, &e->timer, expires);
+    e->runs  = (expires > wheel.now) ? expires : wheel.now;
+    e->armed = 1;
+    set++;
+}
+
+static void disarm(struct entry *e)
+{
+    timer_cancel(&wheel, &e->timer);
+    cancelled += e->armed;
+    e->armed = 0;
+}
+
+static void fire(void *arg)
+{
+    struct entry *e = arg;
+    uint64_t     ms = wheel.now - 1;  /* Past it, as it runs. */
+
+    if (!e->armed)
+    {
+        fail(e, "ran twice, or when cancelled");
+    }
+    if (ms < e->runs)
+    {
+        fail(e, "ran early");
+    }
+    if (ms > e->runs)
+    {
+        fail(e, "ran late");
+    }
+    if (ms < last)
+    {
+        fail(e, "ran out of order");
+    }
+    last     = ms;
+    e->armed = 0;
+    fired++;
+
+    if (set >= (uint64_t) limit)
+    {
+        return;
+    }
+    switch (rng_below(&dice, 8))
+    {
+        case 0:
+        case 1:
+            arm(e);
+            break;
+
+        case 2:
+            disarm(&entries[rng_below(&dice, TIMERS)]);
+            break;
+
+        case 3:
+            arm(&entries[rng_below(&dice, TIMERS)]);
+            break;
+    }
+}
+
+/* Runs the wheel to at, and checks nothing due by then is left, and that
+ * wheel_timeout() would not sleep past anything. */
+static void run(uint64_t at)
+{
+    uint64_t first = UINT64_MAX;
+    long     timeout;
+    int      i;
+
+    now = at;
+    wheel_run(&wheel, now);
+
+    for (i = 0; i < TIMERS; i++)
+    {
+        if (entries[i].armed)
+        {
+            if (entries[i].runs <= now)
+            {
+                fail(&entries[i], "was not run");
+            }
+            if (entries[i].runs < first)
+            {
+                first = entries[i].runs;
+            }
+        }
+    }
+
+    timeout = wheel_timeout(&wheel, now);
+    if ((timeout < 0) != (first == UINT64_MAX))
+    {
+        fprintf(stderr, "timer-check: wheel_timeout() says %ld at %llu\n",
+                timeout, (unsigned long long) now);
+        exit(1);
+    }
+    if ((timeout >= 0) && (now + timeout > first))
+    {
+        fprintf(stderr,
+                "timer-check: wheel_timeout() sleeps past ms %llu at %llu\n",
+                (unsigned long long) first, (unsigned long long) now);
+        exit(1);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    uint64_t seed = 1;
+    long     timeout;
+    int      i,
+             c;
+
+    while ((c = getopt(argc, argv, "n:s:")) != -1)
+    {
+        switch (c)
+        {
+            case 'n':
+                limit = number(optarg);
+                break;
+
+            case 's':
+                seed = number(optarg);
+                break;
+
+            default:
+                usage();
+        }
+    }
+    if (optind != argc)
+    {
+        usage();
+    }
+
+    rng_seed(&dice, seed);
+    now = rng_next(&dice) >> 24;  /* Anywhere, not just at a turn. */
+    wheel_init(&wheel, now);
+    for (i = 0; i < TIMERS; i++)
+    {
+        timer_init(&entries[i].timer, fire, &entries[i]);
+    }
+
+    while (set < (uint64_t) limit)
+    {
+        switch (rng_below(&dice, 16))
+        {
+            case 0:
+            case 1:
+            case 2:
+            case 3:
+            case 4:
+            case 5:
+                arm(&entries[rng_below(&dice, TIMERS)]);
+                break;
+
+            case 6:
+                disarm(&entries[rng_below(&dice, TIMERS)]);
+                break;
+
+            case 7:
+            case 8:
+            case 9:
+                run(now + 1);
+                break;
+
+            case 10:
+                run(now);  /* Time need not move at all. */
+                break;
+
+            case 11:
+                run(now + rng_below(&dice, 1 << 20));
+                break;
+
+            default:
+                timeout = wheel_timeout(&wheel, now);
+                run(now + ((timeout > 0) ? timeout : 1));
+        }
+    }
+
+    /* Then everything left, as far as the wheel goes and round again. */
+    while ((timeout = wheel_timeout(&wheel, now)) != -1)
+    {
+        run(now + ((timeout > 0) ? timeout : 1));
+    }
+    for (i = 0; i < TIMERS; i++)
+    {
+        if (entries[i].armed)
+        {
+            fail(&entries[i], "was never run");
+        }
+    }
+
+    printf("%llu timers set, %llu run, %llu cancelled: all on time\n",
+           (unsigned long long) set, (unsigned long long) fired,
+           (unsigned long long) cancelled);
+
+    return 0;
+}
@@ -0,0 +1,33 @@
+/* ------------------------------------------------------------------------ *
+ * What the command-line tools share.  See tool.h.
+ * ------------------------------------------------------------------------ */
+
+#include <stdlib.h>
+#include <time.h>
+
+#include "tool.h"
+
+const char *causes[] = { "cut off", "retired", "sunk", "foundered",
+    "bankrupt" };
+
+long long number(const char *s)
+{
+    char      *end;
+    long long n = strtoll(s, &end, 0);
+
+    if ((*s == '\0') || (*end != '\0') || (n < 0))
+    {
+        usage();
+    }
+
+    return n;
+}
+
+double seconds(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
@@ -0,0 +1,23 @@
+/* ------------------------------------------------------------------------ *
+ * What the command-line tools (taipan-sim, taipan-odds and the rest, and
+ * the checks) share: reading their counts, timing themselves, and saying
+ * how a game ended.
+ * ------------------------------------------------------------------------ */
+
+#ifndef TAIPAN_TOOL_H
+#define TAIPAN_TOOL_H
+
+/* How a game ended, by GAME_*, with "cut off" for one that was stopped
+ * short of its end. */
+extern const char *causes[];
+
+/* Each tool's own: says how the tool is used, and exits. */
+void usage(void);
+
+/* s as a count, or usage() if it is not one. */
+long long number(const char *s);
+
+/* Seconds by a clock that only goes forward. */
+double seconds(void);
+
+#endif /* TAIPAN_TOOL_H */
@@ -0,0 +1,141 @@
+/* ------------------------------------------------------------------------ *
+ * taipan-vec: step a batch of games through venv.h with random actions,
+ * as an agent in training would, and report how fast it goes.
+ *
+ * Game i of the batch is seeded with seed + i and its actions are drawn
+ * from its own dice, so the same seed gives the same games on any number
+ * of threads.  A game that is done is started again from a new seed.
+ * ------------------------------------------------------------------------ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "rng.h"
+#include "tool.h"
+#include "venv.h"
+
+void usage(void)
+{
+    fprintf(stderr,
+            "usage: taipan-vec [-M] [-b batch] [-n steps] [-s seed] [-j threads]\n");
+    exit(1);
+}
+
+int main(int argc, char *argv[])
+{
+    struct venv        *v;
+    struct venv_action *actions;
+    struct rng         *dice;
+    uint64_t           seed = 1,
+                       next;
+    long               batch = 1024,
+                       steps = 1000,
+                       s,
+                       i,
+                       ended = 0;
+    int                threads = 0,
+                       months = 0,
+                       c;
+    double             reward = 0,
+                       elapsed;
+
+    while ((c = getopt(argc, argv, "Mb:n:s:j:")) != -1)
+    {
+        switch (c)
+        {
+            case 'M':
+                months = 1;  /* Turn months in batches. */
+                break;
+
+            case 'b':
+                batch = number(optarg);
+                break;
+
+            case 'n':
+                steps = number(optarg);
+                break;
+
+            case 's':
+                seed = number(optarg);
+                break;
+
+            case 'j':
+                threads = number(optarg);
+                break;
+
+            default:
+                usage();
+        }
+    }
+    if ((optind != argc) || (batch < 1) || (batch > INT32_MAX))
+    {
+        usage();
+    }
+
+    v       = venv_new(batch, threads);
+    actions = calloc(batch, sizeof(*actions));
+    dice    = calloc(batch, sizeof(*dice));
+    if ((v == NULL) || (actions == NULL) || (dice == NULL))
+    {
+        fprintf(stderr, "taipan-vec: out of memory\n");
+        return 1;
+    }
+    v->batch_months = months;
+
+    for (i = 0; i < batch; i++)
+    {
+        rng_seed(&dice[i], ~(seed + i));
+        venv_reset_one(v, i, seed + i);
+    }
+    next = seed + batch;
+
+    elapsed = seconds();
+    for (s = 0; s < steps; s++)
+    {
+        for (i = 0; i < batch; i++)
+        {
+            struct venv_action *a = &actions[i];
+            struct rng         *r = &dice[i];
+
+            a->sell   = 1;
+            a->repay  = 1;
+            a->borrow = (rng_below(r, 8) == 0);
+            a->buy    = (int) rng_below(r, 5) - 1;
+            a->bank   = rng_below(r, 2);
+            a->dest   = rng_below(r, 8);
+        }
+        if (venv_step(v, actions) != 0)
+        {
+            fprintf(stderr, "taipan-vec: out of memory\n");
+            return 1;
+        }
+
+        /* Start the games that are over afresh, between steps as a
+         * trainer would. */
+        for (i = 0; i < batch; i++)
+        {
+            reward += v->reward[i];
+            if (v->done[i])
+            {
+                ended++;
+                venv_reset_one(v, i, next++);
+            }
+        }
+    }
+    elapsed = seconds() - elapsed;
+
+    printf("%ld games, %ld steps from seed %llu\n\n", batch, steps,
+           (unsigned long long) seed);
+    printf("%ld games ended, mean reward %.1f a step\n", ended,
+           reward / ((double) batch * steps));
+    printf("%.0f steps a second, in %.3f s\n",
+           batch * steps / elapsed, elapsed);
+
+    venv_free(v);
+    free(actions);
+    free(dice);
+
+    return 0;
+}
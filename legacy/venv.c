@@ -0,0 +1,285 @@
+/* ------------------------------------------------------------------------ *
+ * Batches of games for training agents.  See venv.h.
+ * ------------------------------------------------------------------------ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "pool.h"
+#include "venv.h"
+
+/* Games to a job: enough to outweigh taking one from the pool, and to
+ * turn their months together. */
+#define CHUNK MONTH_BATCH
+
+/* What lies between ports, answered as taipan-sim's trader answers it
+ * (see policy.c), without going through a policy. */
+static void answer(struct game_state *g, const struct game_event *ev)
+{
+    switch (ev->type)
+    {
+        case EV_LI_YUEN_DEMAND:
+            if (g->offer <= g->cash)
+            {
+                game_li_yuen_pay(g);
+            }
+            break;
+
+        case EV_MCHENRY:
+            if (game_mchenry_quote(g) <= (long) g->cash / 2)
+            {
+                game_mchenry_pay(g, -1);
+            }
+            break;
+
+        case EV_WU:
+            if (game_wu_broke(g))
+            {
+                game_wu_bailout_offer(g);
+                game_wu_bailout(g, g->wu_bailout <= 3);
+            }
+            break;
+
+        case EV_NEW_SHIP:
+        case EV_NEW_GUN:
+            if (g->offer <= g->cash / 4)
+            {
+                if (ev->type == EV_NEW_SHIP)
+                {
+                    game_buy_ship(g);
+                } else {
+                    game_buy_gun(g);
+                }
+            }
+            break;
+
+        case EV_PIRATES:
+        case EV_LI_YUEN_PIRATES:
+            game_battle_resolve(g, (g->guns > 0) ? ORDERS_FIGHT : ORDERS_RUN);
+            break;
+    }
+}
+
+/* Plays game i on to its next port, or its end, or until the month is to
+ * be turned (if it is to be turned in a batch).  Returns where it
+ * stopped. */
+static int sail(struct venv *v, int i)
+{
+    struct game_state *g = &v->state[i];
+    struct game_event ev;
+
+    for (;;)
+    {
+        switch (game_step(g, &ev))
+        {
+            case EV_MONTH_DUE:
+                return ev.type;
+
+            case EV_PORT:
+            case EV_GAME_OVER:
+                v->done[i] = (ev.type == EV_GAME_OVER) ||
+                    (game_months(g) >= v->max_months);
+                return ev.type;
+        }
+        answer(g, &ev);
+    }
+}
+
+static void observe(struct venv *v, int i)
+{
+    const struct game_state *g = &v->state[i];
+    float                   *o = &v->obs[(long) i * VENV_OBS];
+    long long               worth = game_net_worth(g);
+    int                     k;
+
+    o[VENV_CASH] = g->cash;
+    o[VENV_BANK] = g->bank;
+    o[VENV_DEBT] = g->debt;
+    for (k = 0; k < 4; k++)
+    {
+        o[VENV_HOLD + k]  = g->hold_[k];
+        o[VENV_HKW + k]   = g->hkw_[k];
+        o[VENV_PRICE + k] = g->price[k];
+    }
+    o[VENV_PORT]     = g->port;
+    o[VENV_MONTH]    = game_months(g);
+    o[VENV_GUNS]     = g->guns;
+    o[VENV_DAMAGE]   = g->damage;
+    o[VENV_CAPACITY] = g->capacity;
+
+    v->reward[i] = worth - v->worth[i];
+    v->worth[i]  = worth;
+}
+
+static void act(struct game_state *g, const struct venv_action *a)
+{
+    int k;
+
+    if (a->sell)
+    {
+        for (k = 0; k < 4; k++)
+        {
+            game_sell(g, k, -1);
+        }
+    }
+    if ((g->port == 1) && a->repay)
+    {
+        game_withdraw(g, -1);
+        if (game_wu_can_repay(g))
+        {
+            game_wu_repay(g, -1);
+        }
+    }
+    if ((g->port == 1) && a->borrow)
+    {
+        game_wu_borrow(g, -1);
+    }
+    if ((a->buy >= 0) && (a->buy < 4) && (g->hold > 0))
+    {
+        long amount = game_afford(g, a->buy);
+
+        game_buy(g, a->buy, (amount < g->hold) ? amount : g->hold);
+    }
+    if ((g->port == 1) && a->bank)
+    {
+        game_deposit(g, -1);
+    }
+
+    if ((a->dest == 0) && (game_retire(g) == 0))
+    {
+        return;
+    }
+    if (game_quit(g, a->dest) != 0)
+    {
+        game_quit(g, (g->port % 7) + 1);
+    }
+}
+
+/* Steps games [CHUNK * n, CHUNK * (n + 1)): each to the end of its
+ * voyage, then all their months at once, then each into port. */
+static void step_chunk(long n, void *arg)
+{
+    struct venv        *v = arg;
+    struct month_batch months;
+    int                i,
+                       k,
+                       first = n * CHUNK,
+                       end = first + CHUNK;
+
+    if (end > v->games)
+    {
+        end = v->games;
+    }
+
+    game_months_begin(&months);
+    for (i = first; i < end; i++)
+    {
+        if (v->done[i])
+        {
+            v->reward[i] = 0;
+            continue;
+        }
+        act(&v->state[i], &v->actions[i]);
+        if (sail(v, i) == EV_MONTH_DUE)
+        {
+            game_months_add(&months, &v->state[i]);
+        } else {
+            observe(v, i);
+        }
+    }
+
+    n = months.n;
+    game_months_turn(&months);
+    for (k = 0; k < n; k++)
+    {
+        i = months.games[k] - v->state;
+        sail(v, i);
+        observe(v, i);
+    }
+}
+
+struct venv *venv_new(int games, int threads)
+{
+    struct venv *v = calloc(1, sizeof(*v));
+
+    if (v == NULL)
+    {
+        return NULL;
+    }
+
+    v->games      = games;
+    v->threads    = (threads > 0) ? threads : pool_cpus();
+    v->max_months = 1200;
+    v->state  = calloc(games, sizeof(*v->state));
+    v->obs    = calloc((long) games * VENV_OBS, sizeof(*v->obs));
+    v->reward = calloc(games, sizeof(*v->reward));
+    v->done   = malloc(games);
+    v->worth  = calloc(games, sizeof(*v->worth));
+    if ((v->state == NULL) || (v->obs == NULL) || (v->reward == NULL) ||
+            (v->done == NULL) || (v->worth == NULL))
+    {
+        venv_free(v);
+        return NULL;
+    }
+    memset(v->done, 1, games);
+
+    return v;
+}
+
+void venv_free(struct venv *v)
+{
+    if (v != NULL)
+    {
+        free(v->state);
+        free(v->obs);
+        free(v->reward);
+        free(v->done);
+        free(v->worth);
+        free(v);
+    }
+}
+
+void venv_reset(struct venv *v, const uint64_t *seeds)
+{
+    int i;
+
+    for (i = 0; i < v->games; i++)
+    {
+        venv_reset_one(v, i, seeds[i]);
+    }
+}
+
+void venv_reset_one(struct venv *v, int i, uint64_t seed)
+{
+    struct game_state *g = &v->state[i];
+
+    game_init(g);
+    game_seed(g, seed);
+    g->batch_months = v->batch_months;
+    game_start(g, 1);
+    while (sail(v, i) == EV_MONTH_DUE)
+    {
+        ;  /* Turned as it goes, unanswered. */
+    }
+    v->worth[i] = game_net_worth(g);
+    observe(v, i);
+    v->reward[i] = 0;
+}
+
+int venv_step(struct venv *v, const struct venv_action *actions)
+{
+    long chunks = (v->games + CHUNK - 1) / CHUNK,
+         n;
+
+    v->actions = actions;
+    if ((v->threads == 1) || (chunks == 1))
+    {
+        for (n = 0; n < chunks; n++)
+        {
+            step_chunk(n, v);
+        }
+        return 0;
+    }
+
+    return pool_run(v->threads, chunks, step_chunk, v);
+}
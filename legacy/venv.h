@@ -0,0 +1,91 @@
+/* ------------------------------------------------------------------------ *
+ * Many games stepped together, for training agents.
+ *
+ * A venv holds a batch of games, each parked at a port.  venv_step()
+ * takes one action for each game, plays every game on to its next port
+ * (or to its end), and leaves each game's observation, reward and done
+ * flag in arrays laid out game after game.  Everything between ports is
+ * answered as taipan-sim's trader answers it, by plain calls, and nothing
+ * is allocated after venv_new(), so a step costs the games' own work and
+ * no more; the batch is spread over threads in chunks.  With
+ * batch_months set, each chunk's months are turned together by
+ * game_months_turn(): the same games, and only faster where the compiler
+ * has vectors wide enough for its 64-bit sums (AVX-512, say).
+ *
+ * The games are the engine's, so they play exactly as main() and quit()
+ * do, and the same seeds and actions give the same games on any number
+ * of threads.
+ * ------------------------------------------------------------------------ */
+
+#ifndef TAIPAN_VENV_H
+#define TAIPAN_VENV_H
+
+#include <stdint.h>
+
+#include "engine.h"
+
+/* Where each figure is in a game's observation. */
+enum
+{
+    VENV_CASH,
+    VENV_BANK,
+    VENV_DEBT,
+    VENV_HOLD,                   /* hold_[4]: cargo aboard. */
+    VENV_HKW      = VENV_HOLD + 4,  /* hkw_[4]: in the warehouse. */
+    VENV_PRICE    = VENV_HKW + 4,   /* price[4] here. */
+    VENV_PORT     = VENV_PRICE + 4,
+    VENV_MONTH,                  /* Months since the game began, from 1. */
+    VENV_GUNS,
+    VENV_DAMAGE,
+    VENV_CAPACITY,
+    VENV_OBS
+};
+
+/* What to do at a port, in this order: */
+struct venv_action
+{
+    int32_t sell,    /* 1 to sell all the cargo aboard. */
+            repay,   /* In Hong Kong, 1 to take everything out of the bank
+                      * and pay Wu what we can. */
+            borrow,  /* In Hong Kong, 1 to borrow all Wu will lend. */
+            buy,     /* A good (0 to 3) to fill the hold with, or -1. */
+            bank,    /* In Hong Kong, 1 to bank the cash left over. */
+            dest;    /* The port to sail for, 1 to 7; or 0 to retire,
+                      * which only a millionaire in Hong Kong can.  Any
+                      * other port that will not do sails for the next. */
+};
+
+struct venv
+{
+    int               games,
+                      threads,
+                      max_months,    /* A game stops here, done; 1200. */
+                      batch_months;  /* Turn the months a chunk at a time
+                                      * (see engine.h), not a game at a
+                                      * time; 0.  Read by the resets. */
+
+    struct game_state *state;
+    float             *obs;        /* games * VENV_OBS */
+    float             *reward;     /* Net worth gained on the last step. */
+    uint8_t           *done;       /* The game has ended, or run out of
+                                    * months; it is not stepped again. */
+    long long         *worth;      /* Net worth as last observed. */
+
+    const struct venv_action *actions;  /* During venv_step(). */
+};
+
+/* A batch of games, stepped by threads threads (0 for one per CPU), none
+ * of them started.  NULL if we are out of memory. */
+struct venv *venv_new(int games, int threads);
+void        venv_free(struct venv *v);
+
+/* Starts every game i afresh from seeds[i], with cash, and plays it to
+ * its first port; or just game i, from seed.  Its reward is 0. */
+void venv_reset(struct venv *v, const uint64_t *seeds);
+void venv_reset_one(struct venv *v, int i, uint64_t seed);
+
+/* Carries out actions[i] in game i, for every game not done.  Returns 0,
+ * or -1 if the threads could not be had (and nothing was stepped). */
+int  venv_step(struct venv *v, const struct venv_action *actions);
+
+#endif /* TAIPAN_VENV_H */